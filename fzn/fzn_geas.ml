@@ -1513,7 +1513,19 @@ let print_stats fmt stats obj_val =
       Format.fprintf fmt "%.02f seconds.@." stats.Sol.time ;
       Format.fprintf fmt "%d learnts, average size %f@."
         stats.Sol.num_learnts
-        ((float_of_int stats.Sol.num_learnt_lits) /. (float_of_int stats.Sol.num_learnts))
+        ((float_of_int stats.Sol.num_learnt_lits) /. (float_of_int stats.Sol.num_learnts)) ;
+      Format.fprintf fmt "%d literals removed by minimization.@." stats.Sol.minimized_lits ;
+      Format.fprintf fmt "%d core, %d tier2 learnts; LBD histogram: %s@."
+        stats.Sol.num_core stats.Sol.num_tier2
+        (String.concat " " (Array.to_list (Array.map string_of_int stats.Sol.lbd_hist))) ;
+      Format.fprintf fmt "%d levels reused on restart; %.02f seconds replaying.@."
+        stats.Sol.reused_levels stats.Sol.replay_time ;
+      Format.fprintf fmt "%d learnt literals removed, %d learnts subsumed by inprocessing (%.02f seconds).@."
+        stats.Sol.inprocess_lits stats.Sol.inprocess_subsumed stats.Sol.inprocess_time ;
+      Format.fprintf fmt "%d watch nodes freed (%.02f MB).@."
+        stats.Sol.watches_freed stats.Sol.watch_mem_freed ;
+      Format.fprintf fmt "%d equivalent atoms, %d equivalent variables, %d failed literals.@."
+        stats.Sol.equiv_atoms stats.Sol.equiv_preds stats.Sol.failed_lits
     end
 
 let get_options () =
@@ -1522,6 +1534,17 @@ let get_options () =
   { defaults with
     Sol.one_watch = !Opts.one_watch ;
     Sol.global_diff = !Opts.global_diff ;
+    Sol.restart_reuse = !Opts.restart_reuse ;
+    Sol.adaptive_priority = !Opts.adaptive_priority ;
+    Sol.atom_branch = !Opts.atom_branch ;
+    Sol.learnt_minimize = !Opts.learnt_minimize ;
+    Sol.bin_equiv = !Opts.bin_equiv ;
+    Sol.prop_profile = !Opts.prop_profile ;
+    Sol.restart_policy = !Opts.restart_policy ;
+    Sol.inprocess_effort =
+      (match !Opts.inprocess_effort with
+      | Some e -> e
+      | None -> defaults.Sol.inprocess_effort) ;
     Sol.restart_limit =
       match rlimit with
       | Some r -> r
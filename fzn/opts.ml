@@ -31,6 +31,7 @@ let pol = ref true
 let half_reify = ref false
 
 let restart_limit = ref None
+let restart_policy = ref Solver.RESTART_AUTO
 (* let conflict_limit = ref 0 *)
 let limits = ref (Solver.unlimited ())
 
@@ -47,6 +48,13 @@ let core_factor_coeff = ref true
 
 let one_watch = ref true
 let global_diff = ref false
+let restart_reuse = ref true
+let prop_profile = ref false
+let adaptive_priority = ref true
+let atom_branch = ref false
+let learnt_minimize = ref true
+let inprocess_effort = ref None
+let bin_equiv = ref true
 
 let check = ref false
 
@@ -72,6 +80,36 @@ let (speclist:(Arg.key * Arg.spec * Arg.doc) list) =
       Arg.Unit (fun () -> print_stats := Verbose),
       " : report statistics in a more readable form."
      ) ;
+     (
+      "--adaptive-priority",
+      Arg.Bool (fun b -> adaptive_priority := b),
+      " : on restart, re-rank propagators by how much they prune (default: true)."
+     ) ;
+     (
+      "--atom-branch",
+      Arg.Set atom_branch,
+      " : branch on the most active bounds, rather than the most active variables."
+     ) ;
+     (
+      "--minimize-learnts",
+      Arg.Bool (fun b -> learnt_minimize := b),
+      " : remove literals implied by the rest of each learnt (default: true)."
+     ) ;
+     (
+      "--inprocess",
+      Arg.Float (fun e -> inprocess_effort := Some e),
+      "<float> : fraction of search time to spend strengthening learnts at restarts (0 to disable)."
+     ) ;
+     (
+      "--bin-equiv",
+      Arg.Bool (fun b -> bin_equiv := b),
+      " : merge equivalent atoms and probe for failed literals before search (default: true)."
+     ) ;
+     (
+      "--prop-profile",
+      Arg.Set prop_profile,
+      " : report the work done by each kind of propagator, after each search."
+     ) ;
      (*
      (
       "-o",
@@ -127,6 +165,11 @@ let (speclist:(Arg.key * Arg.spec * Arg.doc) list) =
       Arg.Bool (fun b -> global_diff := b),
       " : use global difference-logic propagator to handle (reified) inequalities (default: false)."
      ) ;
+     (
+      "--restart-reuse",
+      Arg.Bool (fun b -> restart_reuse := b),
+      " : on restart, keep decision levels the search would immediately re-create (default: true)."
+     ) ;
      (
       "--core-opt",
       Arg.Set core_opt,
@@ -184,6 +227,18 @@ let (speclist:(Arg.key * Arg.spec * Arg.doc) list) =
       Arg.Int (fun r -> restart_limit := Some r),
       "<int> : initial restart limit"
      ) ;
+     (
+      "--restarts",
+      Arg.Symbol (["auto" ; "geometric" ; "luby" ; "glucose" ; "inner-outer"], fun s ->
+        restart_policy := match s with
+          | "auto" -> Solver.RESTART_AUTO
+          | "geometric" -> Solver.RESTART_GEOMETRIC
+          | "luby" -> Solver.RESTART_LUBY
+          | "glucose" -> Solver.RESTART_GLUCOSE
+          | "inner-outer" -> Solver.RESTART_INNER_OUTER
+          | s -> failwith (Format.sprintf "ERROR: Unexpected restart policy \"%s\"" s)),
+      " : choose the restart policy (default: auto, glucose until the first solution)."
+     ) ;
      (
       "-c",
       Arg.Int (fun c -> limits := {!limits with Solver.max_conflicts = c }),
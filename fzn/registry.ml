@@ -419,25 +419,24 @@ let all_different_except_0 solver args anns =
   let xs = Pr.get_array (force_ivar solver) args.(0) in
   B.all_different_except_0 solver xs
 
+let regular solver args anns =
+  let xs = Pr.get_array (force_ivar solver) args.(0) in
+  let q = Pr.get_int args.(1) in
+  let syms = Pr.get_int args.(2) in
+  let d = Pr.get_array Pr.get_int args.(3) in
+  let q0 = Pr.get_int args.(4) in
+  let fs = match args.(5) with
+    | Pr.Set (Dom.Range (l, u)) -> Array.init (max 0 (u - l + 1)) (fun i -> l + i)
+    | Pr.Set (Dom.Set ks) -> Array.of_list ks
+    | _ -> failwith "Expected set of accepting states for regular." in
+  let r = B.build_regular solver q syms d q0 fs in
+  B.regular solver r xs
+
 let global_card solver args anns =
   let xs = Pr.get_array (force_ivar solver) args.(0) in
   let vals = Pr.get_array Pr.get_int args.(1) in
-  let count = Pr.get_array Pr.get_int args.(2) in
-  (* Check counts match up *)
-  let val_count = Array.fold_left (+) 0 count in
-  if val_count <> Array.length xs then
-    failwith "ERROR: global_card does not yet handle flexibility."
-  else
-    begin
-      let srcs = Array.map (fun _ -> 1) xs in
-      (* Construct the flows *)
-      let var_flows = Array.init (Array.length xs) (fun i ->
-        Array.init (Array.length vals) (fun j ->
-          (S.ivar_eq xs.(i) vals.(j), i, j)
-        )
-      ) in
-      B.bipartite_flow solver srcs count (Array.to_list var_flows |> Array.concat)
-    end
+  let counts = Pr.get_array (force_ivar solver) args.(2) in
+  B.global_cardinality solver xs vals counts
 
 let cumulative solver args anns =
   let xs = Pr.get_array (force_ivar solver) args.(0) in
@@ -465,6 +464,12 @@ let disjunctive s args anns =
   let ts = Array.init (Array.length xs) (fun ii -> xs.(ii), dur.(ii)) in
   B.disjunctive s ts
 
+let disjunctive_var s args anns =
+  let xs = Pr.get_array (force_ivar s) args.(0) in
+  let dur = Pr.get_array (force_ivar s) args.(1) in
+  let ts = Array.init (Array.length xs) (fun ii -> xs.(ii), dur.(ii), At.at_True) in
+  B.disjunctive_var s ts
+
 let array_var_int_element solver args anns =
   match Pr.get_ival args.(0), Pr.get_ival args.(2) with
   | Pr.Iv_int idx, Pr.Iv_int res ->
@@ -906,6 +911,7 @@ let initialize () =
      "fzn_cumulative_var", cumulative_var ;
      "fzn_disjunctive", disjunctive ;
      "geas_disjunctive", disjunctive ;
+     "geas_disjunctive_var", disjunctive_var ;
      "fzn_global_cardinality", global_card ;
      "geas_all_different_int", all_different_int ;
      "geas_all_different_except_0", all_different_except_0 ;
@@ -913,6 +919,7 @@ let initialize () =
      "geas_cumulative_var", cumulative_var ;
      "geas_disjunctive", disjunctive ;
      "geas_global_cardinality", global_card ;
+     "geas_regular", regular ;
      "value_precede_int", precede_int ;
      "geas_precede_chain", precede_chain_int ;
      "geas_value_precede_chain", value_precede_chain ;
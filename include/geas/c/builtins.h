@@ -71,8 +71,14 @@ int cumulative_float(solver s, ftask* ts, int sz, float cap);
 typedef struct { intvar start; int dur; } dtask;
 int disjunctive(solver s, dtask* ts, int sz);
 
+// Task i runs only if present holds.
+typedef struct { intvar start; intvar dur; atom present; } vdtask;
+int disjunctive_var(solver s, vdtask* ts, int sz);
+
 typedef struct { atom at; int src; int sink; } bp_flow;
 int bipartite_flow(solver s, int* srcs, int srcs_sz, int* sinks, int sinks_sz, bp_flow* flows, int flows_sz);
+int global_cardinality(solver s, intvar* xs, int xs_sz,
+  int* cover, int cover_sz, intvar* counts, int counts_sz);
 
 // Restricted form of int-value-precede-chain.
 int precede_int(solver s, int a, int b, intvar* xs, int sz);
@@ -87,8 +93,10 @@ table_id build_table(solver s, int arity, int* elts, int sz);
 int table(solver s, table_id t, intvar* xs, int sz, table_mode m);
 
 // Regular
-// typedef int reg_id;
-// reg_id build_regular(solver s, int num_states, 
+typedef int regular_id;
+regular_id build_regular(solver s, int num_states, int num_syms,
+  int* trans, int trans_sz, int start, int* accepts, int accepts_sz);
+int regular(solver s, regular_id r, intvar* xs, int sz);
 #ifdef __cplusplus
 }
 #endif
@@ -120,6 +120,19 @@ limits max_time(int s);
 limits max_conflicts(int c);
 int is_consistent(solver);
 result solve(solver, limits);
+// Branch-and-bound minimization of the intvar (see solver::minimize).
+// Each improving solution is passed to on_sol, if non-null; the
+// model is only valid for the duration of the call.
+result minimize(solver, intvar, limits, int probe_limit,
+  void (*on_sol)(void*, model, int), void* data);
+// Core-guided minimization of k + sum_i ks[i] * xs[i]
+// (see geas/solver/core_opt.h); otherwise as minimize.
+result minimize_core(solver, int* ks, intvar* xs, int sz, int k,
+  limits, core_options, void (*on_sol)(void*, model, int), void* data);
+// Large neighbourhood search over xs, minimizing the intvar
+// (see geas/solver/lns.h); otherwise as minimize.
+result minimize_lns(solver, intvar, intvar* xs, int sz,
+  limits, lns_options, void (*on_sol)(void*, model, int), void* data);
 void abort_solve(solver);
 void reset(solver);
 
@@ -156,6 +169,10 @@ pred_t new_pred(solver, int, int);
 atom pred_ge(pred_t, int);
 
 statistics get_statistics(solver);
+// Fills in up to sz kinds of propagator, most expensive first,
+// and returns the number of kinds. Names are static; explanations
+// are only counted with the prop_profile option set.
+int get_propagator_profile(solver, prop_profile* out, int sz);
 
 // Inspection
 void get_ivar_activities(solver, intvar*, int, double**);
@@ -33,6 +33,8 @@ bool var_int_element(solver_data* s, intvar x, intvar i, vec<intvar>& ys,
 // disjunctive.cc
 bool disjunctive_int(solver_data* s, vec<intvar>& st, vec<int>& du); 
 bool disjunctive_var(solver_data* s, vec<intvar>& st, vec<intvar>& du);
+// Task i runs only if ps[i] holds.
+bool disjunctive_opt(solver_data* s, vec<intvar>& st, vec<intvar>& du, vec<patom_t>& ps);
 
 // cumulative.cc
 bool cumulative(solver_data* s,
@@ -63,6 +65,10 @@ bool int_eq(solver_data* s, intvar x, intvar y, patom_t r = at_True);
 bool all_different_int(solver_data* s, const vec<intvar>& xs, patom_t r = at_True);
 bool all_different_except_0(solver_data* s, const vec<intvar>& xs, patom_t r = at_True);
 
+// flow/bipart.cc
+// counts[i] is the number of xs taking cover[i]; other values are free.
+bool global_cardinality(solver_data* s, vec<intvar>& xs, vec<int>& cover, vec<intvar>& counts);
+
 // values-precede.cc
 bool int_precede_chain(solver_data* s, vec<intvar>& xs, patom_t r = at_True);
 bool int_value_precede(solver_data* s, int pre, int post, vec<intvar>& xs);
@@ -75,5 +81,22 @@ namespace table {
   bool post(solver_data* s, table_id t, vec<intvar>& xs, TableMode mode = Table_Default);
 }
 
+// regular.cc
+typedef int regular_id;
+namespace regular {
+  // As in MiniZinc: states 1..num_states (0 is failure), symbols
+  // 1..num_syms, trans[(q-1)*num_syms + (c-1)] the successor of q on c.
+  struct dfa {
+    int num_states;
+    int num_syms;
+    vec<int> trans;
+    int start;
+    vec<int> accepts;
+  };
+  // Equal DFAs get the same id.
+  regular_id build(solver_data* s, const dfa& d);
+  bool post(solver_data* s, regular_id r, vec<intvar>& xs);
+}
+
 }
 #endif
@@ -2,6 +2,7 @@
 #define GEAS__MDD_H
 #include <geas/solver/solver_data.h>
 #include <geas/utils/bitset.h>
+#include <geas/vars/intvar.h>
 
 // Packed-bit representation of MDDs.
 namespace geas {
@@ -20,13 +21,110 @@ struct mdd_info {
   vec< vec<btset::support_set> > edge_TL;
 
   vec< vec<int> > edge_value_id;
+  // Endpoints of each edge: a node on its level, and on the next.
+  vec< vec<int> > edge_src;
+  vec< vec<int> > edge_dest;
 };
 
 typedef int mdd_id;
 
 mdd_id of_tuples(solver_data* s, vec< vec<int> >& tuples);
+// Unfolds a DFA over arity steps; -1 if it accepts no such string.
+mdd_id of_dfa(solver_data* s, int arity, int num_states, int num_syms,
+              const vec<int>& trans, int start, const vec<int>& accepts);
 mdd_info& lookup(solver_data* s, mdd_id m);
 
+// Propagates membership of xs in the MDD, which must have
+// one level per variable.
+bool post(solver_data* s, mdd_id m, vec<intvar>& xs);
+
+// Scratch space for explaining with an MDD.
+struct expl_space {
+  expl_space(void)
+    : available(1), reaching(1), reaching_succ(1) { }
+
+  void reserve(const mdd_info& m) {
+    unsigned int width = 1;
+    for(unsigned int e : m.num_edges)
+      width = std::max(width, e);
+    available.growTo(width);
+    reaching.growTo(width);
+    reaching_succ.growTo(width);
+    while(forbidden.size() < m.values.size())
+      forbidden.push(btset::p_sparse_bitset(1));
+    for(btset::p_sparse_bitset& f : forbidden)
+      f.growTo(width);
+  }
+
+  btset::p_sparse_bitset available;
+  btset::p_sparse_bitset reaching;
+  btset::p_sparse_bitset reaching_succ;
+  vec<btset::p_sparse_bitset> forbidden;
+};
+
+// Explaining why no path through the MDD survives. Values
+// (level l, value-id k) with avail(l, k) are still possible.
+// Walking back from the terminal, marks the edges which would
+// reach it, but for their own value being unavailable.
+template<class Avail>
+void mark_forbidden(const mdd_info& m, expl_space& x, Avail avail) {
+  int L = m.values.size();
+  x.reaching.clear();
+  x.reaching.fill(m.num_edges[L-1]);
+  for(int l = L-1; l >= 0; --l) {
+    x.available.clear();
+    for(int k = 0; k < m.values[l].size(); ++k) {
+      if(avail(l, k))
+        x.available.union_with(m.val_support[l][k]);
+    }
+    x.forbidden[l].set(x.reaching);
+    x.forbidden[l].remove(x.available);
+    if(l == 0)
+      break;
+    x.reaching.intersect_with(x.available);
+
+    x.reaching_succ.clear();
+    for(unsigned int ni = 0; ni < m.num_nodes[l]; ++ni) {
+      if(x.reaching.has_intersection(m.edge_HD[l][ni]))
+        x.reaching_succ.union_with(m.edge_TL[l][ni]);
+    }
+    std::swap(x.reaching, x.reaching_succ);
+  }
+}
+
+// Then walks forward from the root, calling blame(l, k) for
+// enough of the forbidden edges' values to cut every path.
+template<class Blame>
+void retrieve_expln(const mdd_info& m, expl_space& x, Blame blame) {
+  using btset::word_ty;
+  int L = m.values.size();
+  x.reaching.fill(m.num_edges[0]);
+  for(int l = 0; l < L; ++l) {
+    for(int w : x.forbidden[l].idx) {
+      if(!x.reaching.idx.elem(w))
+        continue;
+      word_ty f_bits(x.forbidden[l][w]);
+      // If there is some edge which must be blocked here, blame
+      // the corresponding value, and remove all matching edges.
+      while(x.reaching[w] & f_bits) {
+        int f_edge = btset::word_bits() * w + __builtin_ctzll(x.reaching[w] & f_bits);
+        int v_id = m.edge_value_id[l][f_edge];
+        x.reaching.remove(m.val_support[l][v_id]);
+        blame(l, v_id);
+      }
+    }
+    if(x.reaching.is_empty())
+      return;
+
+    assert(l+1 < L);
+    x.reaching_succ.clear();
+    for(unsigned int ni = 0; ni < m.num_nodes[l+1]; ++ni) {
+      if(x.reaching.has_intersection(m.edge_TL[l+1][ni]))
+        x.reaching_succ.union_with(m.edge_HD[l+1][ni]);
+    }
+    std::swap(x.reaching, x.reaching_succ);
+  }
+}
 
   }
 }
@@ -0,0 +1,192 @@
+#ifndef GEAS_CLAUSE_ARENA_H
+#define GEAS_CLAUSE_ARENA_H
+// Region-based storage for clauses.
+// Persistent clauses live in a single clause_arena, addressed
+// by 32-bit crefs (in 8-byte words, so up to 32GB). Temporary
+// explanations are bump-allocated in an expl_arena, and
+// released wholesale on backtracking.
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <geas/engine/infer-types.h>
+
+namespace geas {
+
+// Clause storage can't be recovered once exhausted; in any build.
+inline void arena_fail(const char* msg) {
+  fprintf(stderr, "ERROR: %s\n", msg);
+  abort();
+}
+
+class clause_arena {
+  clause_arena(const clause_arena& o);
+  clause_arena& operator=(const clause_arena& o);
+public:
+  clause_arena(void)
+    : mem(nullptr), sz(0), cap(0), wasted(0) { }
+  ~clause_arena(void) { free(mem); }
+
+  clause& operator[](cref r) { return *reinterpret_cast<clause*>(mem + r); }
+  clause* lea(cref r) { return reinterpret_cast<clause*>(mem + r); }
+  cref ref(const clause* c) const {
+    return reinterpret_cast<const uint64_t*>(c) - mem;
+  }
+  bool contains(const clause* c) const {
+    const uint64_t* p(reinterpret_cast<const uint64_t*>(c));
+    return mem <= p && p < mem + sz;
+  }
+
+  // May move the arena; any clause* into it must be
+  // re-derived afterwards (see infer_info::alloc_clause).
+  template<class T>
+  cref alloc(T& elts) {
+    cref r(take(clause::words(elts.size())));
+    new (mem + r) clause(elts);
+    return r;
+  }
+
+  // Copy c (which lives elsewhere) into the arena.
+  cref copy(clause& c) {
+    cref r(take(clause::words(c.size())));
+    clause* d(new (mem + r) clause());
+    d->extra = c.extra;
+    d->sz = c.size();
+    std::copy(c.begin(), c.end(), d->begin());
+    return r;
+  }
+
+  void release(cref r) { wasted += clause::words((*this)[r].size()); }
+  // Clause r has been shortened in place from old_sz elements.
+  void shrunk(cref r, int old_sz) {
+    wasted += clause::words(old_sz) - clause::words((*this)[r].size());
+  }
+
+  // Words in use, including released clauses.
+  size_t size(void) const { return sz; }
+  size_t wasted_words(void) const { return wasted; }
+  size_t capacity(void) const { return cap; }
+  // Worth compacting.
+  bool fragmented(void) const { return wasted > sz/5; }
+
+  uint64_t* base(void) const { return mem; }
+
+  void reserve(size_t words) {
+    if(words <= cap)
+      return;
+    // Beyond this, crefs would wrap.
+    if(words > ((size_t) UINT32_MAX))
+      arena_fail("clause arena exceeds 32-bit references");
+    size_t new_cap = cap ? cap : 1024;
+    while(new_cap < words)
+      new_cap += new_cap/2;
+    if(new_cap > ((size_t) UINT32_MAX))
+      new_cap = UINT32_MAX;
+    uint64_t* new_mem = static_cast<uint64_t*>(realloc(mem, sizeof(uint64_t) * new_cap));
+    if(!new_mem)
+      arena_fail("out of memory for clauses");
+    mem = new_mem;
+    cap = new_cap;
+  }
+
+  // Copy the clause at r into dest, leaving behind a forwarding
+  // address. Returns the new reference.
+  cref relocate(cref r, clause_arena& dest) {
+    clause& c((*this)[r]);
+    if(c.extra.reloced)
+      return c.reloc;
+    cref d(dest.copy(c));
+    c.extra.reloced = 1;
+    c.reloc = d;
+    return d;
+  }
+
+  void swap(clause_arena& o) {
+    std::swap(mem, o.mem);
+    std::swap(sz, o.sz);
+    std::swap(cap, o.cap);
+    std::swap(wasted, o.wasted);
+  }
+
+protected:
+  cref take(unsigned int words) {
+    reserve(sz + words);
+    cref r(sz);
+    sz += words;
+    return r;
+  }
+
+  uint64_t* mem;
+  size_t sz;
+  size_t cap;
+  size_t wasted;
+};
+
+// Bump allocator for temporary explanations. Blocks are never
+// moved or freed until destruction, so explanations stay put
+// until we backtrack past the level they were created at.
+class expl_arena {
+  enum { BLOCK_WORDS = 1<<13 };
+  struct block { uint64_t* mem; size_t cap; };
+  struct mark { int blk; size_t used; };
+
+  expl_arena(const expl_arena& o);
+  expl_arena& operator=(const expl_arena& o);
+public:
+  expl_arena(void)
+    : curr(-1), used(0) { }
+  ~expl_arena(void) {
+    for(block& b : blocks)
+      free(b.mem);
+  }
+
+  clause* alloc(int elts) {
+    size_t words = clause::words(elts);
+    if(curr < 0 || used + words > blocks[curr].cap)
+      next_block(words);
+    clause* c = new (blocks[curr].mem + used) clause();
+    c->sz = elts;
+    used += words;
+    return c;
+  }
+
+  void push_level(void) { lims.push(mark { curr, used }); }
+  void bt_to_level(int l) {
+    curr = lims[l].blk;
+    used = lims[l].used;
+    lims.shrink(lims.size() - l);
+  }
+  // Only at the root, when nothing refers to explanations.
+  void clear(void) {
+    assert(lims.size() == 0);
+    curr = -1;
+    used = 0;
+  }
+
+protected:
+  void next_block(size_t words) {
+    ++curr;
+    used = 0;
+    if(curr < blocks.size() && blocks[curr].cap >= words)
+      return;
+    size_t cap = std::max((size_t) BLOCK_WORDS, words);
+    uint64_t* mem = static_cast<uint64_t*>(malloc(sizeof(uint64_t) * cap));
+    if(!mem)
+      arena_fail("out of memory for explanations");
+    if(curr < blocks.size()) {
+      // Not currently in use, so safe to replace.
+      free(blocks[curr].mem);
+      blocks[curr] = block { mem, cap };
+    } else {
+      blocks.push(block { mem, cap });
+    }
+  }
+
+  vec<block> blocks;
+  int curr;
+  size_t used;
+  vec<mark> lims;
+};
+
+}
+
+#endif
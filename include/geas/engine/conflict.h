@@ -14,7 +14,7 @@ class conflict_info {
   };
 public:
   conflict_info(void)
-    : clevel(0), confl_num(0) { }
+    : clevel(0), confl_num(0), lbd_stamp(0), learnt_lbd(0) { }
   /*
   void new_bool(void) {
     bool_seen.push(false);
@@ -30,7 +30,7 @@ public:
     pred_seen.growTo(pred_eval.size());
     pred_eval.push(0);
     // pred_assval.push(0);
-    pred_hint.push(nullptr);
+    pred_hint.push(0);
     // pred_saved.push({0, 0});
   }
 
@@ -45,7 +45,7 @@ public:
   p_sparseset pred_seen;
   vec<pval_t> pred_eval;
   vec<pval_t> pred_assval;
-  vec<watch_node*> pred_hint;
+  vec<unsigned int> pred_hint; // Cached watch for pred_eval, or 0.
   
   vec<phase> pred_saved;
 
@@ -54,11 +54,32 @@ public:
   // Atoms at the current level
   int clevel;
   unsigned int confl_num;
+
+  // For counting distinct decision levels.
+  vec<unsigned int> level_stamp;
+  unsigned int lbd_stamp;
+  // LBD of the last learnt, from compute_learnt.
+  int learnt_lbd;
+
+  // For minimize_learnt: per trail position, the strongest value
+  // shown redundant and the weakest shown not to be, valid while
+  // min_stamp matches confl_num.
+  vec<unsigned int> min_stamp;
+  vec<pval_t> min_ok;
+  vec<pval_t> min_fail;
+  vec< vec<clause_elt> > min_bufs; // Explanations, by depth.
+  vec<pid_t> min_drop;
 };
 
 // Returns the appropriate backtrack level.
 int compute_learnt(solver_data* s, vec<clause_elt>& confl);
+// Decision level at which the (entailed) atom became true.
+int atom_level(solver_data* s, patom_t at);
 void reduce_db(solver_data* s);
+// Number of distinct non-root decision levels in c,
+// which must be unit or false.
+int clause_lbd(solver_data* s, clause& c);
+void compact_clauses(solver_data* s);
 
 bool confl_is_current(solver_data* s, vec<clause_elt>& confl);
 
@@ -157,6 +157,55 @@ protected:
   bool is_idempotent;
 };
 
+// Batched wakeups. Rather than a callback per watched variable,
+// a propagator can keep one batch_set: each change just marks the
+// variable's index, and once per propagation round the engine
+// makes a single call with the indices marked since the last.
+// At that point, wake_vals still holds the bounds last delivered.
+class batch_set {
+public:
+  typedef void (*fun)(void*, vec<int>&);
+
+  batch_set(fun _f, void* _obj, vec<batch_set*>& _queue, bool _is_idem = false)
+    : f(_f), obj(_obj), queue(_queue), is_idempotent(_is_idem), queued(false)
+  { }
+
+  void add(int id) { marked.growTo(id+1, false); }
+
+  forceinline void mark(int id, void* origin) {
+    if(marked[id] || (is_idempotent && origin == obj))
+      return;
+    marked[id] = true;
+    changed.push(id);
+    if(!queued) {
+      queued = true;
+      queue.push(this);
+    }
+  }
+
+  void deliver(void) {
+    f(obj, changed);
+    for(int id : changed)
+      marked[id] = false;
+    changed.clear();
+    queued = false;
+  }
+
+protected:
+  fun f;
+  void* obj;
+  vec<batch_set*>& queue;
+  bool is_idempotent;
+  bool queued;
+  vec<bool> marked;
+  vec<int> changed;
+};
+
+struct batch_watch {
+  batch_set* set;
+  int id;
+};
+
 // For other events -- on new_pred, solution, branch or conflict.
 // GKG: Perhaps pass in the solver_data?
 class event_callback {
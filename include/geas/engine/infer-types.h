@@ -3,7 +3,10 @@
 /* Types for the inference engine */
 
 #include <stdint.h>
+#include <cstdlib>
+#include <cstring>
 #include <vector>
+#include <algorithm>
 #include <geas/mtl/Vec.h>
 #include <geas/mtl/int-triemap.h>
 
@@ -11,7 +14,6 @@
 #include <geas/engine/geas-types.h>
 
 // #define DEBUG_CLAUSE
-// #define SPARSE_WATCHES
 
 // #define CHECK_EXPLNS
 // #define TRACK_ORIGIN
@@ -28,30 +30,33 @@ class solver_data;
 
 class watch_node;
 
+// A clause literal. We also cache a reference to the watch node
+// for its negation (an index into infer_info::watch_refs, or 0),
+// packed alongside the atom so elements stay at 16 bytes.
 class clause_elt {
 public:
   clause_elt(patom_t _at)
-    : atom(_at)
-#ifdef CACHE_WATCH
-    , watch(nullptr)
-#endif
+    : val(_at.val), pid(_at.pid), watch(0)
   { }
-#ifdef CACHE_WATCH
-  clause_elt(patom_t _at, watch_node* _watch)
-    : atom(_at), watch(_watch)
+  clause_elt(patom_t _at, unsigned int _watch)
+    : val(_at.val), pid(_at.pid), watch(_watch)
   { }
-#endif
 
-  patom_t atom;
-  // We cache the appropriate watch-list
-#ifdef CACHE_WATCH
-  watch_node* watch;
-#endif
+  patom_t atom(void) const { return patom_t(pid, val); }
+
+  pval_t val;
+  pid_t pid;
+  unsigned int watch;
 };
+static_assert(sizeof(clause_elt) == 16, "clause_elt: unexpected padding");
 
 struct clause_extra {
+  // Retention tiers for learnts, by LBD.
+  enum Tier { T_Local = 0, T_Tier2 = 1, T_Core = 2 };
+
   clause_extra(void)
-    : depth(0), one_watch(0), is_learnt(0), act(0)
+    : depth(0), one_watch(0), is_learnt(0), reloced(0),
+      lbd(0), ternary(0), tier(T_Local), used(0), vivified(0), act(0)
   {
 #ifdef DEBUG_CLAUSE 
     static unsigned int num_clauses = 0;
@@ -64,9 +69,16 @@ struct clause_extra {
   unsigned int clause_id;
 #endif
 
-  int depth : 30;
+  int depth : 29;
   unsigned one_watch : 1;
   unsigned is_learnt : 1;
+  unsigned reloced : 1; // Moved by clause_arena::relocate
+
+  unsigned lbd : 27;
+  unsigned ternary : 1; // Watched inline on all three literals
+  unsigned tier : 2;
+  unsigned used : 1; // Involved in a conflict since the last reduce_db
+  unsigned vivified : 1; // Vivification already tried (shortened or not)
 
   double act;
 #ifdef PROOF_LOG
@@ -74,6 +86,10 @@ struct clause_extra {
 #endif
 };
 
+// Reference to a clause in the clause_arena.
+typedef uint32_t cref;
+enum { CRef_Undef = UINT32_MAX };
+
 class clause {
 public:
   // Empty constructor, for temporary explanations
@@ -95,53 +111,197 @@ public:
   
   range_t<clause_elt> tail(void) { return range(&data[1], &data[sz]); }
 
+  // Memory needed for a clause of sz elements,
+  // rounded up to 8-byte words.
+  static unsigned int words(int sz) {
+    return (sizeof(clause) + sizeof(clause_elt)*sz + 7)/8;
+  }
+
   clause_extra extra;
 
-  int sz;
+  union {
+    int sz;
+    cref reloc; // Forwarding address, once extra.reloced is set.
+  };
 protected:
   clause_elt data[0];
 };
 
-// Use this instead
-template<class T>
-clause* clause_new(T& elts) {
-  void* mem = malloc(sizeof(clause) + sizeof(clause_elt)*elts.size());
-  return new (mem) clause(elts);
-}
+// The watched literal e0 is stored unpacked, so a clause_head
+// fits in 16 bytes.
+class clause_head {
+public: 
+  clause_head(patom_t _e0, cref _c)
+    : e0_val(_e0.val), e0_pid(_e0.pid), c(_c) { }
 
-inline clause* alloc_clause_mem(int sz) {
-  void* mem = malloc(sizeof(clause) + sizeof(clause_elt)*sz);
-  clause* c = new (mem) clause();
-  c->sz = sz;
-  return c;
-}
+  patom_t e0(void) const { return patom_t(e0_pid, e0_val); } // We can stop if e0 is true.
+  void set_e0(patom_t at) { e0_val = at.val; e0_pid = at.pid; }
 
-template<typename... Es>
-clause* make_clause(clause_elt e, Es... rest) {
-  vec<clause_elt> v;
-  v.push(e);
-  vec_push(v, rest...);
-  return clause_new(v);
-}
+  pval_t e0_val;
+  pid_t e0_pid;
+  cref c;
+};
 
-// If c == NULL, the clause is binary -- e0 is the 'other' literal
-class clause_head {
-public: 
-  clause_head(patom_t _e0)
-    : e0(_e0), c(nullptr) { }
-  clause_head(patom_t _e0, clause* _c)
-    : e0(_e0), c(_c) { }
+// Ternary clauses are watched on all three literals, with the
+// other two stored inline. The clause itself is only touched
+// when it propagates.
+class tern_watch {
+public:
+  tern_watch(patom_t _x, patom_t _y, cref _c)
+    : x_val(_x.val), y_val(_y.val), x_pid(_x.pid), y_pid(_y.pid), c(_c) { }
+
+  patom_t x(void) const { return patom_t(x_pid, x_val); }
+  patom_t y(void) const { return patom_t(y_pid, y_val); }
 
-  patom_t e0; // We can stop if e0 is true.
-  clause* c;
+  pval_t x_val;
+  pval_t y_val;
+  pid_t x_pid;
+  pid_t y_pid;
+  cref c;
 };
 
+// The clause watches on a node, packed in one buffer: binary
+// implications, then ternary clauses, then long clauses. Entries
+// are measured in 16-byte units (ternary entries take two).
+// Order within a section doesn't matter, so long watches are
+// added and removed at the end; adding or removing binary and
+// ternary watches shifts the sections after them, but only
+// happens when clauses are added or deleted.
+class watch_buf {
+  struct unit { uint64_t w[2]; };
+  watch_buf(const watch_buf& o);
+  watch_buf& operator=(const watch_buf& o);
+public:
+  watch_buf(void)
+    : mem(nullptr), nbin(0), ntern(0), nlong(0), cap(0) { }
+  ~watch_buf(void) { free(mem); }
+
+  patom_t* bin_begin(void) const { return reinterpret_cast<patom_t*>(mem); }
+  patom_t* bin_end(void) const { return bin_begin() + nbin; }
+  tern_watch* tern_begin(void) const { return reinterpret_cast<tern_watch*>(mem + nbin); }
+  tern_watch* tern_end(void) const { return tern_begin() + ntern; }
+  clause_head* long_begin(void) const {
+    return reinterpret_cast<clause_head*>(mem + long_start());
+  }
+  clause_head* long_end(void) const { return long_begin() + nlong; }
+
+  range_t<patom_t> bin(void) const { return range(bin_begin(), bin_end()); }
+  range_t<tern_watch> tern(void) const { return range(tern_begin(), tern_end()); }
+  range_t<clause_head> longs(void) const { return range(long_begin(), long_end()); }
+
+  unsigned int num_long(void) const { return nlong; }
+  clause_head& long_at(unsigned int ii) { return long_begin()[ii]; }
+  bool empty(void) const { return nbin + ntern + nlong == 0; }
+  size_t mem_size(void) const { return cap * sizeof(unit); }
+
+  void push_bin(patom_t at) {
+    open(nbin, 1);
+    new (mem + nbin) patom_t(at);
+    ++nbin;
+  }
+  void push_tern(const tern_watch& t) {
+    open(long_start(), 2);
+    new (mem + long_start()) tern_watch(t);
+    ++ntern;
+  }
+  void push_long(const clause_head& h) {
+    grow(used() + 1);
+    new (mem + used()) clause_head(h);
+    ++nlong;
+  }
+
+  // Drop all but the first sz long watches.
+  void shrink_long(unsigned int sz) { nlong = sz; }
+
+  bool remove_long(cref c) {
+    for(clause_head& h : longs()) {
+      if(h.c == c) {
+        h = *(long_end()-1);
+        --nlong;
+        return true;
+      }
+    }
+    return false;
+  }
+  bool remove_tern(cref c) {
+    for(tern_watch& t : tern()) {
+      if(t.c == c) {
+        t = *(tern_end()-1);
+        close(long_start()-2, 2);
+        --ntern;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Move everything from o into this.
+  // Only the ternary and long watches.
+  void append_long(watch_buf& o) {
+    for(const tern_watch& t : o.tern())
+      push_tern(t);
+    for(const clause_head& h : o.longs())
+      push_long(h);
+  }
+  void append(watch_buf& o) {
+    for(patom_t at : o.bin())
+      push_bin(at);
+    for(const tern_watch& t : o.tern())
+      push_tern(t);
+    for(const clause_head& h : o.longs())
+      push_long(h);
+    o.nbin = o.ntern = o.nlong = 0;
+  }
+
+protected:
+  unsigned int long_start(void) const { return nbin + 2*ntern; }
+  unsigned int used(void) const { return long_start() + nlong; }
+
+  void grow(unsigned int req) {
+    if(req <= cap)
+      return;
+    cap = std::max(req, cap ? 2*cap : 4);
+    mem = static_cast<unit*>(realloc(mem, sizeof(unit) * cap));
+  }
+
+  // Open a gap of k units at pos (before the long section). Long
+  // watches are unordered, so we only move as many as we need to.
+  void open(unsigned int pos, unsigned int k) {
+    grow(used() + k);
+    unsigned int l = long_start();
+    if(nlong >= k)
+      memcpy(mem + l + nlong, mem + l, sizeof(unit) * k);
+    else
+      memmove(mem + l + k, mem + l, sizeof(unit) * nlong);
+    memmove(mem + pos + k, mem + pos, sizeof(unit) * (l - pos));
+  }
+  // Remove k units at pos (before the long section).
+  void close(unsigned int pos, unsigned int k) {
+    unsigned int l = long_start();
+    memmove(mem + pos, mem + pos + k, sizeof(unit) * (l - pos - k));
+    if(nlong >= k)
+      memcpy(mem + l - k, mem + l + nlong - k, sizeof(unit) * k);
+    else
+      memmove(mem + l - k, mem + l, sizeof(unit) * nlong);
+  }
+
+  unit* mem;
+  unsigned int nbin;
+  unsigned int ntern;
+  unsigned int nlong;
+  unsigned int cap;
+};
+
+static_assert(sizeof(patom_t) == 16 && sizeof(clause_head) == 16
+  && sizeof(tern_watch) == 32, "watch_buf: unexpected entry size");
+
 struct watch_extra {
   watch_extra(void)
-    : act(0), refs(0) { }
+    : act(0), refs(0), ref(0) { }
 
   double act;
   int refs;
+  unsigned int ref; // Index in infer_info::watch_refs, or 0.
 };
 
 // Watches for a given atom.
@@ -157,8 +317,7 @@ public:
   pval_t succ_val;
   watch_extra extra;
   watch_node* succ;  
-  vec<patom_t> bin_ws;
-  vec<clause_head> ws;
+  watch_buf ws;
   vec<watch_callback> callbacks;
 };
 
@@ -183,301 +342,177 @@ struct MakeWNode {
   }
 };
 
-// For a given pid_t, map values to the corresponding
-// watches.
-#ifndef SPARSE_WATCHES
-// typedef std::map<pval_t, watch_node*> watch_map;
-typedef uint64_triemap<uint64_t, watch_node*, UIntOps> watch_map;
-#else
 typedef uint64_triemap<uint64_t, watch_node*, UIntOps> watch_trie;
-class watch_map {
-private:
-  watch_map& operator=(watch_map& o) { return *this; }
-  watch_map(watch_map& o)
-    : kind(W_EAGER), nodes(nullptr) {
-      e.base = 0;
-  }
 
+// For a given pid_t, map values to the corresponding
+// watches. Predicates with a narrow domain keep a contiguous
+// array of nodes: nodes[0] is the head, covering everything up
+// to lo, and nodes[i] is the node for base+i (for a fresh map,
+// lo = base). A sentinel at the end stands for everything above
+// the upper bound, which can never become true. Wide predicates
+// create nodes lazily in a trie. Either way, the map owns its
+// nodes.
+class watch_map {
+  watch_map(const watch_map& o);
+  watch_map& operator=(const watch_map& o);
 public:
-  enum Kind { W_EAGER, W_SPARSE, W_LAZY };   
-  enum { EAGER_LIMIT = 10 };
+  enum Kind { W_DENSE, W_TRIE };
+  enum { DENSE_LIMIT = 32 };
 
-  Kind kind;
-  union {
-    struct {
-      pval_t base;
-      unsigned int sz;
-    } e;
-    struct {
-      pval_t base;
-      unsigned int sz;
-    } s;
-    watch_trie l;
-  };
-  watch_node* nodes;
+  static bool is_narrow(pval_t lb, pval_t ub) {
+    return lb <= ub && ub - lb < DENSE_LIMIT;
+  }
 
+  // A lazy map, with the head at 0.
   watch_map(void)
-    : kind(W_LAZY) {
-      nodes = nullptr;
-      MakeWNode m;
-      new (&l) watch_trie;
-      l.add(0, m(0));
+    : kind(W_TRIE), nodes(nullptr), lo(0), base(0), sz(0) {
+    MakeWNode m;
+    trie.find_or_add(m, 0);
   }
 
   watch_map(pval_t lb, pval_t ub)
-    : kind(ub - lb < EAGER_LIMIT ? W_EAGER : W_LAZY) {
-    if(kind == W_EAGER) {
-      unsigned int sz = (ub - lb + 1);
-      nodes = (watch_node*) malloc(sizeof(watch_node) * (sz+1));
-      e.base = lb;
-      e.sz = sz;
-      watch_node* n = nodes;
-      for(; lb <= ub; ++lb, ++n) {
-        new (n) watch_node;
-        n->succ_val = lb+1;
-        n->succ = n+1;
-      }
-      new (n) watch_node;
-      n->succ_val = pval_err;
-      n->succ = nullptr;
+    : kind(W_TRIE), nodes(nullptr), lo(0), base(0), sz(0) {
+    if(is_narrow(lb, ub)) {
+      set_dense(lb, lb, ub);
     } else {
-      nodes = nullptr;
       MakeWNode m;
-      new (&l) watch_trie;
-      l.add(lb, m(lb));
-    }
-  }
-  
-  // PRE: xs is ascending.
-  // Drop any nodes which aren't present in xs.
-  void migrate_watches(watch_node* dest, watch_node* src) {
-    if(dest == src)
-      return;
-    for(patom_t p : src->bin_ws)
-      dest->bin_ws.push(p);
-    for(clause_head w : src->ws)
-      dest->ws.push(w);
-    for(watch_callback c : src->callbacks)
-      dest->callbacks.push(c);
-    src->bin_ws.clear();
-    src->ws.clear();
-    src->callbacks.clear();
-  }
-
-  void shrink(pid_t p, vec<pval_t>& xs) {
-    watch_node* pn(nodes);
-    watch_node* en(nodes);
-
-    watch_node* curr(nodes);
-
-    pval_t* px = xs.begin();
-    pval_t* ex = xs.end();
-    pval_t implied = curr->succ_val-1;
-    while(pn != en && px != ex) {
-      if(*px + 1 < pn->succ_val) {
-        ++px;
-      } else if(*px + 1 > pn->succ_val) {
-        migrate_watches(curr, pn);
-        ++pn; 
-      } else {
-        migrate_watches(curr, pn); 
-        curr->succ_val = pn->succ_val;
-        if(implied < *px) // FIXME: May have dupes here.
-          curr->bin_ws.push(ge_atom(p, *px));
-        ++pn;
-        ++px;
-        ++curr;
-        implied = pn->succ_val;
-      }
-    }
-    s.base = 0;
-    s.sz = curr - nodes;
-    // Call destructors on anything we'll skip
-    for(; curr != en; ++curr)
-      curr->~watch_node();
-  }
-
-  // FIXME: Given values [x1, ..., x_n], we _actually_ need
-  // watches on each xi+1, not xi.
-  // We need the p parameter so we know which binary clauses to add.
-  void make_sparse(pid_t p, vec<pval_t>& xs) {
-    switch(kind) {
-      case W_EAGER: 
-        // Only sparsify if it's worthwhile.
-        if(2 * xs.size() < e.sz) {
-          kind = W_SPARSE;
-          s = { e.base, e.sz };
-          shrink(p, xs);
-        }
-        break;
-      case W_SPARSE:
-        // Already sparse; drop any values
-        // which are no longer feasible.
-        shrink(p, xs);
-        break;
-      case W_LAZY:
-        // Allocate the sparse nodes, then
-        // migrate everything from the lazy.
-        {
-          kind = W_SPARSE;
-          unsigned int sz = xs.size();
-          nodes = (watch_node*) malloc(sizeof(watch_node) * (sz+1));
-          
-          watch_node* curr(nodes);
-          auto lnode(l.begin());
-          for(int ii : irange(xs.size())) {
-            new (curr) watch_node;
-            curr->succ_val = xs[ii]+1;
-            curr->succ = curr+1;
-            
-            if(ii > 0 && xs[ii] > xs[ii-1]+1) {
-              // Non-contiguous.
-              curr->bin_ws.push(ge_atom(p, xs[ii]));
-            }
-
-            while(lnode != l.end() && (*lnode).key <= xs[ii]) {
-              migrate_watches(curr, (*lnode).value);  
-              delete (*lnode).value;
-              ++lnode;
-            }
-            ++curr;
-          }
-          new (curr) watch_node;
-          curr->succ_val = pval_err;
-          curr->succ = nullptr;
-
-          l.~watch_trie();
-
-          s.base = xs[0];
-          s.sz = sz;
-        }
-        break;
-      default:
-        GEAS_NEVER;
+      trie.find_or_add(m, 0);
     }
   }
-  watch_map(vec<pval_t>& xs)
-    : kind(W_SPARSE) {
-    unsigned int sz = xs.size();
-    s.sz = sz;
-
-    s.base = xs[0];
-    nodes = (watch_node*) malloc(sizeof(watch_node) * (sz+1));
-    for(int ii = 1; ii <= sz; ++ii) {
-      new (&nodes[ii-1]) watch_node;
-      nodes[ii-1].succ_val = xs[ii];
-      nodes[ii-1].succ = &nodes[ii];
-    }
-    new (&nodes[sz]) watch_node;
-    nodes[sz].succ_val = pval_err;
-    nodes[sz].succ = nullptr;
-  }
 
   watch_map(watch_map&& o)
-    : kind(o.kind), nodes(o.nodes) {
-      switch(o.kind) {
-        case W_EAGER:
-          e = o.e;
-          o.e.sz = 0;
-          break;
-        case W_SPARSE:
-          s = o.s;
-          o.s.sz = 0;
-          break;
-        case W_LAZY:
-          l = std::move(o.l);
-          break;
-      }
-      o.nodes = nullptr;
+    : kind(o.kind), nodes(o.nodes), lo(o.lo), base(o.base), sz(o.sz),
+      trie(std::move(o.trie)) {
+    o.nodes = nullptr;
+    o.sz = 0;
   }
-
   watch_map& operator=(watch_map&& o) {
+    release();
     kind = o.kind;
     nodes = o.nodes; o.nodes = nullptr;
-    switch(o.kind) {
-      case W_EAGER:
-        e = o.e;
-        o.e.sz = 0;
-        break;
-      case W_SPARSE:
-        s = o.s;
-        o.s.sz = 0;
-        break;
-      case W_LAZY:
-        l = std::move(o.l);
-    }
+    lo = o.lo;
+    base = o.base;
+    sz = o.sz; o.sz = 0;
+    trie = std::move(o.trie);
     return *this;
   }
 
-  ~watch_map(void) {
-
-    switch(kind) {
-      case W_LAZY:
-        l.~watch_trie();
-        break;
-      case W_EAGER:
-        for(watch_node* p = nodes; p != nodes+e.sz; ++p)
-          p->~watch_node();
-        break;
-      case W_SPARSE:
-        for(watch_node* p = nodes; p != nodes+s.sz; ++p)
-          p->~watch_node();
-        break;
-      default:
-        break;
-    }
-    if(nodes)
-      free(nodes);
-  }
-
-  watch_node& find_sparse(pval_t k) {
-    if(k <= s.base)
-      return nodes[0];
-
-    // FIXME
-#if 0
-    unsigned int pre = 0;
-    unsigned int high = s.sz;
-
-    while(pre < high) {
-      unsigned int mid = pre + (high - pre)/2;
-      if(nodes[mid].succ_val < k)
-        pre = mid+1;
-      else if(nodes[mid].succ_val > k)
-        high = mid; 
-      else
-        return nodes[mid+1];
+  ~watch_map(void) { release(); }
+
+  // The node for the smallest value; it is never woken.
+  watch_node* head(void) const {
+    return kind == W_DENSE ? nodes : (*trie.begin()).value;
+  }
+  pval_t head_val(void) const {
+    return kind == W_DENSE ? lo : (*trie.begin()).key;
+  }
+
+  // Dense over exactly [lb, ub].
+  bool spans(pval_t lb, pval_t ub) const {
+    return kind == W_DENSE && lo == base && base == lb && base + sz == ub + 1;
+  }
+
+  // Find or create the node for [p >= k].
+  watch_node* get(pval_t k) {
+    if(kind == W_DENSE)
+      return nodes + index(k);
+    MakeWNode m;
+    return trie.find_or_add(m, k);
+  }
+
+  // Drop the trie entry for [p >= k]; the caller unlinks and
+  // frees the node. Never the head.
+  void forget(pval_t k) {
+    assert(kind == W_TRIE && k != head_val());
+    trie.rem(k);
+  }
+
+  // As get, but the node must already exist.
+  watch_node* find(pval_t k) const {
+    if(kind == W_DENSE)
+      return nodes + index(k);
+    watch_trie::iterator it(trie.find(k));
+    return it ? (*it).value : nullptr;
+  }
+
+  // Rebuild as a dense array over [lb, ub], moving the watches
+  // across from the current node list (starting at w, with value
+  // w_val). Everything up to w_lim has already been woken, and
+  // is merged into the head. Values in (w_lim, lb] are merged
+  // into the node for lb, so [p >= lb] must be posted before
+  // propagating; those above ub go to the sentinel. Only safe at
+  // the root.
+  // Cached references to the old nodes are redirected via refs.
+  void make_dense(pval_t w_lim, pval_t lb, pval_t ub,
+                  pval_t w_val, watch_node* w, vec<watch_node*>& refs) {
+    watch_map old(std::move(*this));
+    set_dense(w_lim, std::max(w_lim, lb-1), ub);
+    for(; w; w_val = w->succ_val, w = w->succ)
+      migrate(nodes + index(w_val), w, refs);
+  }
+
+  Kind kind;
+protected:
+  unsigned int index(pval_t k) const {
+    if(k <= lo)
+      return 0;
+    if(k <= base)
+      return 1;
+    return std::min(k - base, (pval_t) sz);
+  }
+
+  // Nodes 0..ub-base, plus the sentinel at sz.
+  void set_dense(pval_t _lo, pval_t _base, pval_t ub) {
+    kind = W_DENSE;
+    lo = _lo;
+    base = _base;
+    sz = ub - base + 1;
+    nodes = new watch_node[sz+1];
+    for(unsigned int ii = 0; ii < sz; ++ii) {
+#ifdef DEBUG_WMAP
+      nodes[ii].curr_val = base + ii;
+#endif
+      nodes[ii].succ_val = base + ii + 1;
+      nodes[ii].succ = nodes + ii + 1;
     }
-    return nodes[high];
-#else
-    watch_node* p(nodes);
-    while(p->succ_val < k)
-      ++p;
-    return *(p+1);
+#ifdef DEBUG_WMAP
+    nodes[sz].curr_val = ub + 1;
 #endif
+    nodes[sz].succ_val = pval_err;
+    nodes[sz].succ = nullptr;
   }
 
-  watch_node* find_lazy(pval_t k) {
-    MakeWNode m;
-    return l.find_or_add(m, k);
+  static void migrate(watch_node* dest, watch_node* src, vec<watch_node*>& refs) {
+    if(src->extra.ref) {
+      refs[src->extra.ref] = dest;
+      if(!dest->extra.ref)
+        dest->extra.ref = src->extra.ref;
+    }
+    dest->ws.append(src->ws);
+    for(const watch_callback& c : src->callbacks)
+      dest->callbacks.push(c);
   }
-  
-  watch_node* get(pval_t k) {
-    switch(kind) {
-      case W_EAGER:
-        {
-          unsigned int idx = std::min(k - e.base, (pval_t) e.sz);
-          return &(nodes[idx]);
-        }
-      case W_SPARSE:
-        return &(find_sparse(k));
-      case W_LAZY:
-      default:
-        return find_lazy(k);
+
+  void release(void) {
+    if(kind == W_DENSE) {
+      delete[] nodes;
+      nodes = nullptr;
+      sz = 0;
+    } else {
+      for(watch_trie::iterator it(trie.begin()); it != trie.end(); ++it)
+        delete (*it).value;
     }
+    // Anything left is a moved-from trie.
+    kind = W_TRIE;
+    trie = watch_trie();
   }
+
+  watch_node* nodes;
+  pval_t lo;
+  pval_t base;
+  unsigned int sz;
+  watch_trie trie;
 };
-#endif
 
 // One of: a clause, a an atom, or a thunk
 
@@ -2,11 +2,11 @@
 #define GEAS_INFER__H
 #include <map>
 #include <vector>
+#include <algorithm>
 
 #include <geas/mtl/int-triemap.h>
 #include <geas/engine/infer-types.h>
-
-// #define SPARSE_WATCHES
+#include <geas/engine/clause-arena.h>
 
 namespace geas {
 
@@ -16,28 +16,16 @@ public:
 
   // Predicates 0 and 1 are placeholders, and always
   // exist.
-  infer_info(void) {
+  infer_info(void)
+    : num_imps(0) {
     // Done by solver_data constructor
     // new_pred();
+    watch_refs.push(nullptr);
   }
 
   ~infer_info(void) {
-    // Clear watches
-    watch_maps.clear();
-    for(watch_head h : pred_watch_heads) {
-      watch_node* p = h.ptr;
-      while(p) {
-        watch_node* s = p->succ;
-        delete p;
-        p = s;
-      }
-    }
-    
-    // Then clauses and learnts
-    for(clause* c : clauses)
-      free(c);
-    for(clause* l : learnts)
-      free(l);
+    // Watch nodes are owned by the watch maps, and clauses
+    // and learnts are released with the arena.
   }
 
   // Predicates should only be added in pairs.
@@ -61,123 +49,207 @@ public:
   }
 
   void root_simplify(void) {
-    trail.clear();
+    shrink_trail(0);
     trail_lim.clear();
   }
 
 protected:
   pid_t new_half_pred(void) {
     pid_t pid = watch_maps.size();
-    // Create the root watch-node
-#if 1
-    watch_node* w(new watch_node); 
-    // w->atom = patom_t(pid, 0);
-#ifdef DEBUG_WMAP
-    w->curr_val = 0;
-#endif
-    // w->succ_val = pval_max;
-    w->succ_val = pval_err;
-    pred_watches.push(w);
-    pred_watch_heads.push(watch_head {0, w});
-//    pred_act.push(0.0);
-
+    pred_tpos.push(-1);
     pred_ineqs.push();
 
     watch_maps.push();
-    watch_maps.last().add(0, w);
-#else
-    pred_ineqs.push();
-    watch_maps.push();
-    watch_node* w(watch_maps.last().get(0));
+    watch_node* w(watch_maps.last().head());
     pred_watches.push(w);
     pred_watch_heads.push(watch_head {0, w});
-#endif
     return pid;
   }
 
   pid_t new_half_pred(pval_t lb, pval_t ub) {
     pid_t pid = watch_maps.size();
+    pred_tpos.push(-1);
     pred_ineqs.push();
-#ifndef SPARSE_WATCHES
-    watch_node* w(new watch_node); 
-#ifdef DEBUG_WMAP
-    w->curr_val = 0;
-#endif
-    w->succ_val = pval_err;
-    pred_watches.push(w);
-    pred_watch_heads.push(watch_head {0, w});
 
-    pred_ineqs.push();
-    watch_maps.push();
-    watch_maps.last().add(0, w);
-#else
+    // Narrow predicates get a dense watch map.
     watch_maps.push(watch_map(lb, ub));
-    watch_node* w(watch_maps.last().get(lb));
+    watch_map& m(watch_maps.last());
+    watch_node* w(m.head());
     pred_watches.push(w);
-    pred_watch_heads.push(watch_head {lb, w});
-#endif
-
+    pred_watch_heads.push(watch_head {m.head_val(), w});
     return pid;
   }
 
 public:
   // Get the watch for an atom, knowing it exists.
   watch_node* lookup_watch(pid_t p, pval_t val) {
-    uint64_t key = (uint64_t) val;
-    watch_map::iterator it = watch_maps[p].find(key);
-    if(it == watch_maps[p].end())
+    watch_node* w(watch_maps[p].find(val));
+    if(!w)
       GEAS_ERROR;
-    return (*it).value;
+    return w;
   }
 
   // Find the appropriate watch for an atom.
   watch_node* get_watch(pid_t p, pval_t val) {
-#ifdef SPARSE_WATCHES
-    /*
-    MakeWNode m;
-    return (*(watch_maps[p].find_or_add(m, key))).value;
-    */
     return watch_maps[p].get(val);
-#else
-    uint64_t key = (uint64_t) val;
-    watch_map::iterator it = watch_maps[p].find(key);
-    if(it != watch_maps[p].end()) 
-      return (*it).value;
-    watch_node* w(new watch_node);
-    // w->atom = patom_t(p, val);
-
-    // This repeats the lookup performed by
-    // find. Modify to avoid this.
-    it = watch_maps[p].add(key, w);
-    --it;
-    watch_node* pred = (*it).value;
-#ifdef DEBUG_WMAP
-    w->curr_val = val;
-    assert(pred->curr_val < val);
-#endif
-    w->succ_val = pred->succ_val;
-    w->succ = pred->succ;
-    pred->succ_val = val;
-    pred->succ = w;
-    return w;
-#endif
   }
 
+  // Compact references to watch nodes, cached in clause_elts.
+  // Nodes are registered on demand; if a node is replaced, its
+  // entry is redirected, so cached references stay valid.
+  unsigned int watch_ref(watch_node* w) {
+    if(!w->extra.ref) {
+      w->extra.ref = watch_refs.size();
+      watch_refs.push(w);
+    }
+    return w->extra.ref;
+  }
+  watch_node* deref_watch(unsigned int r) const { return watch_refs[r]; }
+
+  // The root values of p have been restricted to vs (ascending),
+  // and [p >= vs[0]] is about to be posted. If the remaining range
+  // is narrow, rebuild p's watches as a dense map. Only safe at
+  // decision level 0.
   void make_sparse(pid_t p, vec<pval_t>& vs) {
-#ifdef SPARSE_WATCHES
-    // Only safe at decision level 0.
-    watch_maps[p].make_sparse(p, vs); 
-    watch_node* w(watch_maps[p].nodes);
-    pred_watches[p] = w;
-    pred_watch_heads[p] = watch_head { 0, w };
-#endif
+    if(trail_lim.size() > 0 || vs.size() == 0)
+      return;
+    // Nodes up to the current watch have already been woken.
+    pval_t w_lim = pred_watch_heads[p].val;
+    for(watch_node* w = pred_watch_heads[p].ptr; w != pred_watches[p]; w = w->succ)
+      w_lim = w->succ_val;
+    pval_t lb = vs[0];
+    pval_t ub = vs.last();
+    watch_map& m(watch_maps[p]);
+    if(!watch_map::is_narrow(std::max(w_lim, lb-1), ub) || m.spans(lb, ub))
+      return;
+
+    m.make_dense(w_lim, lb, ub, pred_watch_heads[p].val, pred_watch_heads[p].ptr, watch_refs);
+    pred_watches[p] = m.head();
+    pred_watch_heads[p] = watch_head { m.head_val(), m.head() };
+    if(p < (pid_t) head_refs.size()) {
+      for(unsigned int r : head_refs[p])
+        watch_refs[r] = m.head();
+    }
+  }
+
+  // Garbage-collect p's watch nodes, at the root. Those between
+  // the head and the current watch are for atoms fixed at the root,
+  // so are never woken again: any clause watches move to the head,
+  // and binary watches and callbacks (already run) are dropped. If
+  // sweep is set, later nodes with nothing attached are freed too,
+  // unless some clause caches a reference to them. Dense maps are
+  // allocated in one piece, so are left alone.
+  // Returns the number of nodes freed, adding their size to bytes.
+  int collect_watches(pid_t p, bool sweep, size_t& bytes) {
+    watch_map& m(watch_maps[p]);
+    if(m.kind != watch_map::W_TRIE)
+      return 0;
+    watch_node* head(m.head());
+    watch_node* curr(pred_watches[p]);
+    assert(pred_watch_heads[p].ptr == head);
+    int freed = 0;
+
+    pval_t w_val = head->succ_val;
+    watch_node* w = head->succ;
+    if(head != curr) {
+      while(w != curr) {
+        head->ws.append_long(w->ws);
+        pval_t next_val = w->succ_val;
+        watch_node* next = w->succ;
+        release_watch(p, w_val, w, head, bytes);
+        ++freed;
+        w_val = next_val;
+        w = next;
+      }
+      head->succ_val = w_val;
+      head->succ = curr;
+      w_val = curr->succ_val;
+      w = curr->succ;
+    }
+
+    if(sweep) {
+      watch_node* prev = curr;
+      while(w) {
+        pval_t next_val = w->succ_val;
+        watch_node* next = w->succ;
+        if(w->ws.empty() && w->callbacks.size() == 0 && !w->extra.ref) {
+          release_watch(p, w_val, w, head, bytes);
+          ++freed;
+          prev->succ_val = next_val;
+          prev->succ = next;
+        } else {
+          prev = w;
+        }
+        w_val = next_val;
+        w = next;
+      }
+    }
+    return freed;
+  }
+
+protected:
+  // Free w, the node for [p >= val], redirecting any cached
+  // reference to the head.
+  void release_watch(pid_t p, pval_t val, watch_node* w, watch_node* head, size_t& bytes) {
+    if(w->extra.ref) {
+      watch_refs[w->extra.ref] = head;
+      if((pid_t) head_refs.size() <= p)
+        head_refs.growTo(p+1);
+      head_refs[p].push(w->extra.ref);
+    }
+    bytes += sizeof(watch_node) + w->ws.mem_size()
+      + w->callbacks.size() * sizeof(watch_callback);
+    watch_maps[p].forget(val);
+    delete w;
   }
 
+public:
+
   struct entry {
     pid_t pid;
+    int prev; // Previous entry for pid, or -1.
     pval_t old_val;
     reason expl;
   };
+
+  void push_trail(pid_t p, pval_t old_val, reason r) {
+    trail.push(entry { p, pred_tpos[p], old_val, r });
+    pred_tpos[p] = trail.size()-1;
+  }
+  void shrink_trail(int pos) {
+    for(int ii = trail.size()-1; ii >= pos; --ii)
+      pred_tpos[trail[ii].pid] = trail[ii].prev;
+    trail.shrink_(trail.size() - pos);
+  }
+
+  // Decision level of trail position pos.
+  int level_of(int pos) const {
+    return std::upper_bound(trail_lim.begin(), trail_lim.end(), pos) - trail_lim.begin();
+  }
+
+  // Allocate a persistent clause. Growing the arena may move
+  // it, so reasons on the trail are redirected.
+  template<class T>
+  cref alloc_clause(T& elts) {
+    uint64_t* old_base(arena.base());
+    size_t old_sz(arena.size());
+    cref r(arena.alloc(elts));
+    if(arena.base() != old_base)
+      rebase_reasons(old_base, old_sz, arena.base());
+    return r;
+  }
+
+  void rebase_reasons(uint64_t* old_base, size_t old_sz, uint64_t* new_base) {
+    uintptr_t lo = (uintptr_t) old_base;
+    uintptr_t hi = (uintptr_t) (old_base + old_sz);
+    for(entry& e : trail) {
+      if(e.expl.kind != reason::R_Clause)
+        continue;
+      uintptr_t p = (uintptr_t) e.expl.cl;
+      if(lo <= p && p < hi)
+        e.expl.cl = reinterpret_cast<clause*>(new_base + (p - lo)/sizeof(uint64_t));
+    }
+  }
   
   struct watch_head {
     pval_t val;
@@ -187,20 +259,33 @@ public:
   // Tracking watch lists for predicates
   vec<watch_map> watch_maps; // (pid_t -> pval_t -> watch_node*)
   vec<watch_node*> pred_watches;
+  vec<watch_node*> watch_refs; // See watch_ref; 0 is unused.
+  // References redirected to the head of each predicate by
+  // collect_watches, so make_dense can move them along.
+  vec< vec<unsigned int> > head_refs;
   vec<watch_head> pred_watch_heads; // Watches for [| pid >= min_val |].
   vec<double> pred_act;
 
   vec< vec<bin_le> > pred_ineqs; // Primitive binary inequalities
+  int num_imps; // Binary clauses and pred_ineqs added so far
 
   // Inference graph and backtracking
   vec<int> trail_lim;
   vec<entry> trail;
+  vec<int> pred_tpos; // Last trail entry for each pid, or -1.
 
   // Temporary storage for the conflict
   vec<clause_elt> confl;  
 
-  vec<clause*> clauses;
-  vec<clause*> learnts;
+  clause_arena arena;
+  vec<cref> clauses;
+  // Learnts are tiered by LBD; see add_learnt and reduce_db.
+  vec<cref> learnts; // Local: reduced by activity.
+  vec<cref> learnts_tier2; // Kept while in use.
+  vec<cref> learnts_core; // Kept permanently.
+
+  // Learnts which count against learnt_dbmax.
+  int num_reducible(void) const { return learnts.size() + learnts_tier2.size(); }
 };
 
 }
@@ -6,6 +6,8 @@
 // is dealt with in infer.h
 #include <geas/engine/geas-types.h>
 #include <geas/engine/infer-types.h>
+#include <geas/engine/clause-arena.h>
+#include <geas/utils/cast.h>
 
 namespace geas {
 
@@ -36,12 +38,32 @@ public:
     watch_node* node;
   } pwatch_entry;
 
-  typedef struct {
-    void* ptr;
-    char sz;
-    uint64_t val;
-  } data_entry;
+  // The data trail is split by width, so each segment
+  // restores with a plain fixed-size store.
+  enum { DT_8, DT_16, DT_32, DT_64, DT_WIDTHS };
+
+  template<class T>
+  struct data_entry {
+    T* ptr;
+    T val;
+  };
+
+  // A point in the data trail: one offset per segment.
+  struct dtrail_pos {
+    unsigned int pos[DT_WIDTHS];
+  };
   
+  dtrail_pos data_pos(void) const {
+    dtrail_pos d = { { (unsigned int) data8.size(), (unsigned int) data16.size(),
+                       (unsigned int) data32.size(), (unsigned int) data64.size() } };
+    return d;
+  }
+
+  vec< data_entry<uint8_t> >& data_trail(uint8_t*) { return data8; }
+  vec< data_entry<uint16_t> >& data_trail(uint16_t*) { return data16; }
+  vec< data_entry<uint32_t> >& data_trail(uint32_t*) { return data32; }
+  vec< data_entry<uint64_t> >& data_trail(uint64_t*) { return data64; }
+
   void new_pred(void) {
     pred_touched.push(false);
     pred_touched.push(false);
@@ -59,16 +81,18 @@ public:
 
     pred_ltrail.clear();
     pred_ltrail_lim.clear();
-    data_trail.clear();
+    data8.clear();
+    data16.clear();
+    data32.clear();
+    data64.clear();
     dtrail_lim.clear();
     pwatch_trail.clear();
     pwatch_lim.clear();
+    expl_mem.clear();
   }
 
   clause* alloc_expl(unsigned int sz) {
-    clause* c = alloc_clause_mem(sz);
-    expl_trail.push(c);
-    return c;
+    return expl_mem.alloc(sz);
   }
 
   template<class... Es>
@@ -90,13 +114,15 @@ public:
   vec<pred_entry> pred_ltrail;
   vec<int> pred_ltrail_lim;
 
-  // Temporary explanations
-  vec<clause*> expl_trail;
-  vec<int> expl_trail_lim;
+  // Temporary explanations; reset on backtracking.
+  expl_arena expl_mem;
 
   // Trail for other data
-  vec<data_entry> data_trail;
-  vec<int> dtrail_lim;
+  vec< data_entry<uint8_t> > data8;
+  vec< data_entry<uint16_t> > data16;
+  vec< data_entry<uint32_t> > data32;
+  vec< data_entry<uint64_t> > data64;
+  vec<dtrail_pos> dtrail_lim;
 
   // Watch heads
   vec<pwatch_entry> pwatch_trail;
@@ -114,7 +140,13 @@ void bt_to_level(solver_data* s, unsigned int l);
 
 // If we need to restore the data-trail for explanation.
 // Worth taking care, since we don't normally store intra-level checkpoints.
-void bt_data_to_pos(solver_data* s, unsigned int data_pos);
+void bt_data_to_pos(solver_data* s, const persistence::dtrail_pos& data_pos);
+
+template<int Sz> struct dtrail_word { };
+template<> struct dtrail_word<1> { typedef uint8_t T; };
+template<> struct dtrail_word<2> { typedef uint16_t T; };
+template<> struct dtrail_word<4> { typedef uint32_t T; };
+template<> struct dtrail_word<8> { typedef uint64_t T; };
    
 // When we backtrack beyond the current point, it will be
 // restored to val.
@@ -122,17 +154,16 @@ template<class T>
 inline void trail_fake(persistence& p, T& elt, T val) {
   static_assert(sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8,
     "sizeof(T) must be 2^k, k <- [0, 3]");
-  persistence::data_entry e = { (void*) &elt, sizeof(T), (uint64_t) val };
-  p.data_trail.push(e); 
+  // Copy the bits, so floating-point values survive the round-trip.
+  typedef typename dtrail_word<sizeof(T)>::T W;
+  persistence::data_entry<W> e = { (W*) &elt, cast::conv<W, T>(val) };
+  p.data_trail((W*) nullptr).push(e); 
 }
 
 // Save the current value of elt
 template<class T>
 inline void trail_push(persistence& p, T& elt) {
-  static_assert(sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8,
-    "sizeof(T) must be 2^k, k <- [0, 3]");
-  persistence::data_entry e = { (void*) &elt, sizeof(T), (uint64_t) elt };
-  p.data_trail.push(e); 
+  trail_fake(p, elt, elt);
 }
 
 // Save elt, and update
@@ -1,14 +1,27 @@
 #ifndef GEAS_PROPAGATOR__H
 #define GEAS_PROPAGATOR__H
+#include <string>
 #include <geas/engine/infer-types.h>
 #include <geas/engine/state.h>
 #include <geas/engine/persist.h>
 
-#define TRACK_EXEC_COUNT
-
 namespace geas {
 class solver_data;
 
+// Per-propagator work counters (see solver::get_propagator_profile).
+struct prop_counters {
+  prop_counters(void)
+    : wakeups(0), execs(0), cycles(0),
+      prunings(0), conflicts(0), explains(0) { }
+
+  uint64_t wakeups;   // calls to queue_prop
+  uint64_t execs;     // calls to propagate
+  uint64_t cycles;    // ticks spent in propagate (if profiling)
+  uint64_t prunings;  // atoms set by propagate
+  uint64_t conflicts; // calls to propagate which failed
+  uint64_t explains;  // explanations requested
+};
+
 // Lifting actual function pointers to avoid
 // vtable lookups
 struct prop_t {
@@ -82,15 +95,20 @@ public:
   void queue_prop(void);
 
   unsigned char priority;
+  // The priority given at construction; priority may be
+  // moved a level either side (see reprioritize).
+  unsigned char base_priority;
   bool is_idempotent;
   bool is_queued;
 // #ifdef PROOF_LOG
   int cons_id;
 // #endif
   int prop_id;
-#ifdef TRACK_EXEC_COUNT
-  int exec_count;
-#endif
+  prop_counters prof;
+  prop_counters prof_mark; // prof, as of the last reprioritize
+  // The class name, for the profile; set by prop_inst.
+  const char* (*kind)(void);
+
 protected:
   solver_data* s;
 };
@@ -106,6 +124,11 @@ protected:
 
 typedef void (*expl_fun)(void*, int , pval_t, vec<clause_elt>&);
 
+// Strips the enclosing signature (and namespaces) from
+// the __PRETTY_FUNCTION__ of prop_inst<T>::kind_name,
+// leaving the name of T.
+std::string prop_kind_name(const char* pretty);
+
 // Each propagator class should be an instance of this.
 template<class T>
 class prop_inst {
@@ -122,6 +145,16 @@ public:
   enum { Wt_IDEM = 1 };
   typedef T P;
 
+  // Tag the propagator with its kind (we don't rely on RTTI).
+  prop_inst(void) {
+    static_cast<propagator*>(static_cast<T*>(this))->kind = kind_name;
+  }
+
+  static const char* kind_name(void) {
+    static const std::string name(prop_kind_name(__PRETTY_FUNCTION__));
+    return name.c_str();
+  }
+
 #ifdef PVAL_32
   static inline val_t to_int(pval_t v) { return (((pval_t) INT32_MIN) + v); }
 #else
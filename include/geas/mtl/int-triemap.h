@@ -113,6 +113,8 @@ public:
   }
 
   uint64_triemap& operator=(uint64_triemap<Key, Val, Ops>&& o) {
+    if(root)
+      free_node(root);
     root = o.root; o.root = nullptr;
     head = o.head; o.head = nullptr;
     tail = o.tail; o.tail = nullptr;
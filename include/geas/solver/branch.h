@@ -10,6 +10,10 @@ public:
   virtual ~brancher(void) { }
   virtual patom_t branch(solver_data* s) = 0;
   virtual bool is_fixed(solver_data* s) = 0;
+  // Lowest level (at least lim) a restart must backtrack to,
+  // if this brancher would re-make the decisions below it.
+  // By default, nothing is reused.
+  virtual unsigned int reusable_level(solver_data* s, unsigned int lim) { return lim; }
 };
 
 // Standard branchers
@@ -18,7 +22,11 @@ enum ValChoice { Val_Min, Val_Max, Val_Split, Val_Saved, Val_Pol, Val_Default };
 
 brancher* default_brancher(solver_data* s);
 brancher* pred_act_branch(solver_data* s);
+// Branches on the most active atom [x >= v]. Atoms are bumped
+// by bump_touched, at the bounds the touched preds reached.
 brancher* atom_act_branch(solver_data* s);
+class atom_act_brancher;
+void bump_atoms(solver_data* s, double mult, int touched_start);
 
 brancher* basic_brancher(VarChoice var_choice, ValChoice val_choice, vec<pid_t>& preds);
 brancher* seq_brancher(vec<brancher*>& branchers);
@@ -30,5 +38,9 @@ brancher* toggle_brancher(vec<brancher*>& bs);
   
 patom_t branch(solver_data* s);
 
+// Decision level (at least lim) a restart needs to backtrack to;
+// levels below it would be re-created unchanged.
+unsigned int reusable_level(solver_data* s, unsigned int lim);
+
 }
 #endif
@@ -0,0 +1,25 @@
+#ifndef GEAS_SOLVER_CORE_OPT_H
+#define GEAS_SOLVER_CORE_OPT_H
+// Core-guided (OLL) minimization of linear objectives.
+#include <geas/solver/solver.h>
+
+namespace geas {
+
+// Minimize k + sum_i ks[i] * xs[i].
+// Each term is assumed to be at its lower bound. Each unsat core
+// then raises the objective lower bound, and the terms in it
+// are merged into a new penalty variable. Cores are collected until
+// a fraction o.core_ratio of the limits is used up. After that,
+// the objective is rebuilt from the remaining terms and solved by
+// branch-and-bound (as solver::minimize).
+// Each improving solution is passed to on_sol. On return,
+// get_model() gives the best solution found. The return value
+// follows solver::minimize. Any assumptions are cleared.
+solver::result minimize_core(solver& s, vec<int>& ks, vec<intvar>& xs, int k,
+                             limits l = no_limit,
+                             const core_options& o = default_core_options,
+                             solver::solution_fn on_sol = nullptr, void* ptr = nullptr);
+
+}
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef GEAS_SOLVER_LNS_H
+#define GEAS_SOLVER_LNS_H
+// Large neighbourhood search over assumptions.
+#include <geas/solver/solver.h>
+
+namespace geas {
+
+// Minimize obj by large neighbourhood search. Starts from the
+// last solution found by s, or else solves for one.
+// Each step fixes a share of xs to their incumbent values (as
+// assumptions), and looks for a solution with obj below the
+// incumbent within a small conflict budget. The share shrinks
+// when a neighbourhood holds no better solution, and grows when
+// the budget runs out; the budget also grows then. Once nothing
+// is fixed, search is complete, and runs to the end of the limits.
+// Each improving solution is passed to on_sol. On return,
+// get_model() gives the best solution found. The return value
+// follows solver::minimize. Any assumptions are cleared.
+solver::result minimize_lns(solver& s, intvar obj, vec<intvar>& xs,
+                            limits l = no_limit,
+                            const lns_options& o = default_lns_options,
+                            solver::solution_fn on_sol = nullptr, void* ptr = nullptr);
+
+}
+
+#endif
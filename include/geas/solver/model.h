@@ -17,7 +17,7 @@ struct model {
   }
 
   template<class T>
-  typename T::val_t operator[](const T& v) {
+  typename T::val_t operator[](const T& v) const {
     return v.model_val(*this);
   }
 
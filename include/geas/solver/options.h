@@ -19,6 +19,21 @@ extern "C" {
   { } 
   */
 
+// When solve restarts (options::restart_policy).
+typedef enum {
+  // Glucose until a solution has been found, then geometric.
+  RESTART_AUTO,
+  // After restart_limit conflicts, growing by restart_growthrate.
+  RESTART_GEOMETRIC,
+  // After restart_limit times the Luby sequence.
+  RESTART_LUBY,
+  // When the LBD of recent learnts is well above the average.
+  RESTART_GLUCOSE,
+  // A geometric inner limit, reset whenever it reaches the
+  // (also geometric) outer limit.
+  RESTART_INNER_OUTER
+} restart_kind;
+
 typedef struct {
   int learnt_dbmax; 
   double learnt_growthrate;
@@ -31,11 +46,51 @@ typedef struct {
 
   int restart_limit;
   double restart_growthrate;
+  restart_kind restart_policy;
 
   int one_watch;
   int global_diff;
 
   int eager_threshold;
+
+  // Learnts with LBD at most lbd_core are kept permanently;
+  // up to lbd_tier2, while they keep being used.
+  int lbd_core;
+  int lbd_tier2;
+
+  // Remove literals implied by the rest of the learnt, following
+  // reasons back through the trail (see minimize_learnt).
+  int learnt_minimize;
+
+  // On restart, keep the decision levels the search would
+  // immediately re-create (decisions on preds more active
+  // than the next branching candidate). Not applied when
+  // solving under assumptions.
+  int restart_reuse;
+
+  // On restart, re-rank propagators by recent yield (see
+  // reprioritize in solver.cc).
+  int adaptive_priority;
+
+  // Branch on individual atoms [x >= v] by activity (see
+  // atom_act_branch), rather than on whole predicates.
+  int atom_branch;
+
+  // At restarts, strengthen the learnts by vivification and
+  // subsumption (see inprocess in solver.cc). Each pass may take
+  // this fraction of the time searched since the last; 0 disables.
+  double inprocess_effort;
+
+  // At the start of each solve, merge equivalent atoms and preds
+  // found in the binary implications, and probe for failed
+  // literals (see bin_equiv in solver.cc).
+  int bin_equiv;
+
+  // Print the propagator profile (see print_propagator_profile)
+  // to stderr at the end of each call to solve. Time spent and
+  // explanations are only counted towards the profile when this
+  // is set.
+  int prop_profile;
 } options;
 
 typedef struct {
@@ -43,9 +98,43 @@ typedef struct {
   int conflicts;
 } limits;
 
+// Core-guided minimization (see geas/solver/core_opt.h).
+typedef struct {
+  // Fraction of the limits spent on finding cores, before
+  // switching to branch-and-bound.
+  double core_ratio;
+  // Conflicts allowed per check when trimming a core (0: no trimming).
+  int trim_limit;
+  // Conflicts allowed per step when raising the bound of
+  // a new objective term (0: no exhaustion).
+  int probe_limit;
+  // Only assume terms with the largest remaining coefficients,
+  // relaxing the threshold as cores run out.
+  int stratify;
+  // Tighten variable bounds with each new incumbent.
+  int harden;
+} core_options;
+
+// Large neighbourhood search (see geas/solver/lns.h).
+typedef struct {
+  // Conflicts allowed per neighbourhood, to begin with.
+  int conflicts;
+  // Fraction of the variables fixed, to begin with.
+  double fix_ratio;
+  // Change to fix_ratio after a neighbourhood is exhausted
+  // (fix fewer) or runs out of conflicts (fix more).
+  double fix_step;
+  // Fix variables one at a time, counting those fixed by
+  // propagation, rather than a random subset.
+  int guided;
+  unsigned int seed;
+} lns_options;
+
 // static const options default_options = options();
 extern options default_options;
 extern limits no_limit;
+extern core_options default_core_options;
+extern lns_options default_lns_options;
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,94 @@
+#ifndef GEAS_SOLVER_PARALLEL_H
+#define GEAS_SOLVER_PARALLEL_H
+// Portfolio front-end: runs several independent solver
+// instances on the same model, exchanging short learnts.
+#include <atomic>
+#include <geas/solver/solver.h>
+
+namespace geas {
+
+// Lock-free exchange of learnt clauses. Each worker publishes into
+// its own ring (so each ring has a single producer), and every
+// other worker reads it through a private cursor. Slots are guarded
+// by a sequence number (seqlock-style): readers discard anything
+// torn or overwritten, so a slow reader just misses clauses.
+class learnt_exchange {
+public:
+  enum { RING_SZ = 1024, MAX_LITS = 16 };
+
+  learnt_exchange(int workers);
+  ~learnt_exchange(void);
+
+  // Only called by worker w.
+  void publish(int w, const vec<patom_t>& lits);
+
+  // Retrieve clauses from the other workers published since
+  // the last call by w.
+  void collect(int w, vec< vec<patom_t> >& out);
+
+protected:
+  struct slot {
+    std::atomic<uint64_t> seq;
+    std::atomic<uint32_t> sz;
+    std::atomic<uint32_t> pids[MAX_LITS];
+    std::atomic<uint64_t> vals[MAX_LITS];
+  };
+  struct ring {
+    std::atomic<uint64_t> head;
+    slot slots[RING_SZ];
+  };
+
+  int num_workers;
+  ring* rings;
+  uint64_t* cursors; // cursors[reader * num_workers + writer]
+};
+
+struct parallel_options {
+  int num_workers;
+  // Learnts with at most this many literals are exported.
+  int share_size;
+};
+extern parallel_options default_parallel_options;
+
+class parallel_solver {
+public:
+  // Each worker constructs its own copy of the model. The
+  // builder must post the same variables and constraints, in
+  // the same order, for every worker; worker_id may be used
+  // to vary search annotations. Returns false on failure.
+  typedef bool (*model_builder)(solver& s, int worker_id, void* data);
+
+  parallel_solver(model_builder build, void* data,
+    const parallel_options& popts = default_parallel_options,
+    const options& opts = default_options);
+  ~parallel_solver(void);
+
+  // Runs all workers; the first to finish decides the result.
+  solver::result solve(limits l = no_limit);
+  void abort(void);
+
+  // Model from the worker which last reported SAT.
+  model get_model(void);
+  int winner(void) const { return win; }
+
+  int num_workers(void) const { return workers.size(); }
+  solver& worker(int wi);
+
+  // Summed over the workers.
+  statistics get_statistics(void) const;
+  // Learnts published to, and added from, the exchange.
+  int num_exported(void) const;
+  int num_imported(void) const;
+
+  struct worker_t;
+  learnt_exchange& get_exchange(void) { return exchange; }
+protected:
+  vec<worker_t*> workers;
+  learnt_exchange exchange;
+  std::atomic<bool> finished;
+  int win;
+};
+
+}
+
+#endif
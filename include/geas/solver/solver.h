@@ -1,10 +1,13 @@
 #ifndef GEAS_SOLVER__H
 #define GEAS_SOLVER__H
 
+#include <cstdio>
+
 #include <geas/engine/geas-types.h>
 #include <geas/solver/expr.h>
 #include <geas/solver/model.h>
 #include <geas/solver/options.h>
+#include <geas/solver/stats.h>
 #include <geas/vars/intvar.h>
 #include <geas/vars/fpvar.h>
 
@@ -38,8 +41,28 @@ public:
   result solve(limits l = no_limit);
   void abort(void);
 
+  // Branch-and-bound minimization of obj. After each solution, the
+  // bound is tightened in place, backtracking only as far as needed;
+  // each improving solution is passed to on_sol. If probe_limit > 0,
+  // we also try speculative bounds (with that many conflicts apiece).
+  // Returns SAT if the last solution is optimal, UNSAT if there
+  // are none, and UNKNOWN if the limits are reached.
+  // The bound obj < best has an empty explanation, so clauses
+  // learnt under it hold unconditionally, and stay after minimize
+  // returns: the solver no longer represents the original
+  // problem. Once optimality is proven it is inconsistent, so
+  // don't call solve() or minimize() on it again.
+  typedef void (*solution_fn)(void* ptr, const model& m, intvar::val_t obj);
+  result minimize(intvar obj, limits l = no_limit, int probe_limit = 0,
+                  solution_fn on_sol = nullptr, void* ptr = nullptr);
+
   bool is_aborted(void) const;
 
+  // Work done by each kind of propagator so far, most expensive
+  // first. Time and explanations are only counted with
+  // opts.prop_profile.
+  void get_propagator_profile(vec<prop_profile>& out);
+
   // Retrieve a model
   model get_model(void);
 
@@ -65,6 +88,10 @@ public:
 //  intvar_manager ivar_man;
 };
 
+// Write the propagator profile to f, one line per kind:
+//   %%%geas-prop: kind=K count=N wakeups=W execs=E cycles=C ...
+void print_propagator_profile(solver& s, FILE* f);
+
 }
 
 #endif
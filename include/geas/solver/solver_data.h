@@ -1,6 +1,8 @@
 #ifndef GEAS_SOLVER_IMPL__H
 #define GEAS_SOLVER_IMPL__H
 #include <signal.h>
+#include <atomic>
+#include <unordered_map>
 #include <geas/mtl/Vec.h>
 #include <geas/mtl/Heap.h>
 #include <geas/mtl/Queue.h>
@@ -37,11 +39,28 @@ typedef unsigned int man_id_t;
 
 enum PredFlags { PR_DEFAULT = 0, PR_NOBRANCH = 1 };
 
+// Called with each new learnt clause (after root-level
+// simplification), e.g. for sharing between solver instances.
+class learnt_callback {
+public:
+  typedef void (*fun)(void*, vec<clause_elt>&);
+
+  learnt_callback(fun _f, void* _obj)
+    : f(_f), obj(_obj) { }
+
+  void operator()(vec<clause_elt>& learnt) { f(obj, learnt); }
+
+protected:
+  fun f;
+  void* obj;
+};
+
 class solver_data {
   struct pol_info {
     pol_info(void)
-      : has_preference(0), preferred(0), branch(0) { }
-    unsigned pad : 5;
+      : nobranch(0), has_preference(0), preferred(0), branch(0) { }
+    unsigned pad : 4;
+    unsigned nobranch : 1;
     unsigned has_preference : 1;
     unsigned preferred : 1;
     unsigned branch : 1;
@@ -79,11 +98,20 @@ public:
   vec<bool> wake_queued;
   vec<pval_t> wake_vals;
   
+  // Batched watchers marked in the current round.
+  vec<batch_set*> batch_queue;
+
   Queue<propagator*> prop_queue[PRIO_LEVELS];
   uint32_t queue_has_prop; // Which priority levels are nonempty
 
   vec<propagator*> propagators;
+  // For profiling: the propagator owning an explanation thunk.
+  // Filled in on demand (see count_explain).
+  std::unordered_map<const void*, propagator*> prop_owner;
+
   vec<brancher*> branchers;
+  // Atom activities, if an atom_act_branch is in use.
+  atom_act_brancher* atom_act;
   brancher* last_branch;
 
   Heap<act_cmp> pred_heap;
@@ -101,11 +129,16 @@ public:
   unsigned int init_end;
   char init_saved;
 
+  // Objective bound from minimize, holding globally but
+  // not yet established at the root.
+  patom_t obj_bound;
+
   // Callbacks for various events
   vec<event_callback> on_pred;
   vec<event_callback> on_branch;
   vec<event_callback> on_solution;
   vec<event_callback> on_restart;
+  vec<learnt_callback> on_learnt;
 
   vec<pol_info> polarity;
 
@@ -115,13 +148,29 @@ public:
   double pred_act_inc;
   int learnt_dbmax;
   int restart_limit;
-
-  volatile sig_atomic_t abort_solve; 
+  // Conflict count at which simplify_at_root next
+  // collects empty watch nodes.
+  int next_watch_sweep;
+  // infer.num_imps when bin_equiv last looked.
+  int equiv_imps;
+
+  // Set by solver::abort, possibly from another thread.
+  std::atomic<int> abort_solve;
+  // Solving for a parallel_solver, which handles SIGINT and
+  // clears abort_solve for its workers.
+  bool is_worker;
   bool solver_is_consistent;
 
   vec<manager_t> managers;
 };
 
+// SIGINT handling for solve. A caught signal stays
+// pending until clear_sigint.
+void set_handlers(void);
+void clear_handlers(void);
+bool sigint_caught(void);
+void clear_sigint(void);
+
 man_id_t register_manager(void* (*create)(solver_data* s), void (*destroy)(void*));
 
 inline int num_preds(solver_data* s) { return s->pred_callbacks.size(); }
@@ -166,6 +215,11 @@ void attach(solver_data* s, patom_t p, const watch_callback& c);
 
 void process_initializers(solver_data& s);
 
+// Budget accounting across several calls to solve: what is left
+// of l, given we started at stats st0, and whether it is used up.
+limits limits_remaining(const limits& l, const statistics& st0, const statistics& st);
+bool limits_exhausted(const limits& l, const statistics& st0, const statistics& st);
+
 template<typename... Ts>
 bool add_clause(solver_data* s, patom_t e, Ts... args) {
   vec<clause_elt> elts;
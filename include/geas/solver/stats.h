@@ -5,6 +5,10 @@
 extern "C" {
 #endif
 
+// LBDs of 1..GEAS_LBD_HIST-1; the last bucket
+// holds anything larger.
+#define GEAS_LBD_HIST 16
+
 typedef struct {
   // statistics(void) : conflicts(0), restarts(0), solutions(0) { }
   int conflicts;
@@ -14,8 +18,50 @@ typedef struct {
 
   int num_learnts;
   int num_learnt_lits;
+
+  // Permanent and mid-tier learnts; the rest of
+  // num_learnts are local.
+  int num_core;
+  int num_tier2;
+  int lbd_hist[GEAS_LBD_HIST]; // LBD of each learnt, when derived.
+  int minimized_lits; // Removed from learnts by minimization.
+
+  // Decision levels kept across restarts, and time spent
+  // propagating after a restart before the next free decision.
+  int reused_levels;
+  double replay_time;
+
+  // Learnt literals removed and learnts deleted by inprocessing,
+  // and the time spent on it.
+  int inprocess_lits;
+  int inprocess_subsumed;
+  double inprocess_time;
+
+  // Watch nodes freed at the root, and their size in MB.
+  int watches_freed;
+  double watch_mem_freed;
+
+  // Atoms and preds replaced by an equivalent, and atoms
+  // found false by probing.
+  int equiv_atoms;
+  int equiv_preds;
+  int failed_lits;
 } statistics;
 
+// Work done by the propagators of one kind, summed over
+// its instances. Cycles are timestamp-counter ticks spent
+// in propagate; prunings count the atoms it set.
+typedef struct {
+  const char* kind;
+  int count;
+  long long wakeups;
+  long long execs;
+  long long cycles;
+  long long prunings;
+  long long conflicts;
+  long long explains;
+} prop_profile;
+
 #ifdef __cplusplus
 }
 #endif
@@ -152,6 +152,7 @@ struct ivar_ext {
   IV_Kind kind;
 
   vec<watch_callback> b_callbacks[2];
+  vec<batch_watch> b_batches[2];
   vec<watch_callback> fix_callbacks;
   vec<rem_info> rem_callbacks;
 
@@ -227,6 +228,8 @@ public:
   void attach(solver_data* s, intvar_event e, watch_callback c);
   void attach(intvar_event e, watch_callback c);
   void attach_rem(val_callback<int64_t> c);
+  // Bound changes mark id in b (E_LB and E_UB only).
+  void attach_batch(intvar_event e, batch_set& b, int id);
 
   int dom_sz_approx(ctx_t& ctx) const; // Cheap
   int dom_sz_exact(ctx_t& ctx) const; // Potentially expensive
@@ -282,7 +285,15 @@ public:
   ~intvar_manager(void);
   intvar new_var(val_t lb, val_t ub);
 
+  // Equality atoms are introduced lazily, so the same [x = k]
+  // may have different pids in different solver instances.
+  // An eq_key names it independently of creation order.
+  struct eq_key { int var_idx; pval_t val; };
+  bool lazy_eq_key(pid_t p, eq_key& k) const;
+  patom_t find_eqatom(eq_key k);
+
   vec<pid_t> var_preds;
+  std::unordered_map<pid_t, eq_key> lazy_eqs;
 
   solver_data* s;
   vec<ivar_ext*> var_exts;
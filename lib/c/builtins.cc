@@ -268,6 +268,18 @@ int bipartite_flow(solver s, int* srcs, int srcs_sz, int* sinks, int sinks_sz, b
   return geas::bipartite_flow(get_solver(s)->data, src_vec, sink_vec, flow_vec);
 }
 
+int global_cardinality(solver s, intvar* xs, int xs_sz,
+  int* cover, int cover_sz, intvar* counts, int counts_sz) {
+  vec<geas::intvar> x_vec;
+  for(intvar* v = xs; v != xs+xs_sz; ++v)
+    x_vec.push(*get_intvar(*v));
+  vec<int> vals(cover, cover+cover_sz);
+  vec<geas::intvar> c_vec;
+  for(intvar* v = counts; v != counts+counts_sz; ++v)
+    c_vec.push(*get_intvar(*v));
+  return geas::global_cardinality(get_solver(s)->data, x_vec, vals, c_vec);
+}
+
 int cumulative(solver s, task* ts, int sz, int cap) {
   vec<geas::intvar> xs;
   vec<int> ds;
@@ -314,6 +326,18 @@ int disjunctive(solver s, dtask* ts, int sz) {
   return geas::disjunctive_int(get_solver(s)->data, xs, ds);
 }
 
+int disjunctive_var(solver s, vdtask* ts, int sz) {
+  vec<geas::intvar> xs;
+  vec<geas::intvar> ds;
+  vec<geas::patom_t> ps;
+  for(vdtask t : range(ts, ts+sz)) {
+    xs.push(*get_intvar(t.start));
+    ds.push(*get_intvar(t.dur));
+    ps.push(get_atom(t.present));
+  }
+  return geas::disjunctive_opt(get_solver(s)->data, xs, ds, ps);
+}
+
 int precede_chain_int(solver s, intvar* vs, int sz) {
   vec<geas::intvar> xs;
   intvar* end = vs+sz;
@@ -370,6 +394,25 @@ int table(solver s, table_id t, intvar* vs, int sz, table_mode m) {
   return geas::table::post(get_solver(s)->data, t, xs, (geas::table::TableMode) m);
 }
 
+regular_id build_regular(solver s, int num_states, int num_syms,
+  int* trans, int trans_sz, int start, int* accepts, int accepts_sz) {
+  geas::regular::dfa d;
+  d.num_states = num_states;
+  d.num_syms = num_syms;
+  d.start = start;
+  for(int ii = 0; ii < trans_sz; ++ii) d.trans.push(trans[ii]);
+  for(int ii = 0; ii < accepts_sz; ++ii) d.accepts.push(accepts[ii]);
+  return geas::regular::build(get_solver(s)->data, d);
+}
+
+int regular(solver s, regular_id r, intvar* vs, int sz) {
+  vec<geas::intvar> xs;
+  intvar* end = vs+sz;
+  for(; vs != end; ++vs) xs.push(*get_intvar(*vs));
+
+  return geas::regular::post(get_solver(s)->data, r, xs);
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -2,6 +2,8 @@
 #include <geas/solver/model.h>
 #include <geas/solver/branch.h>
 #include <geas/solver/priority-branch.h>
+#include <geas/solver/core_opt.h>
+#include <geas/solver/lns.h>
 #include <geas/engine/logging.h>
 
 #include <geas/utils/defs.h>
@@ -291,6 +293,46 @@ result solve(solver s, limits lim) {
   return unget_result(get_solver(s)->solve(lim)); 
 }
 
+struct c_solution_fn {
+  void (*f)(void*, model, int);
+  void* data;
+};
+
+static void call_solution_fn(void* ptr, const geas::model& m, geas::intvar::val_t obj) {
+  c_solution_fn* c(static_cast<c_solution_fn*>(ptr));
+  c->f(c->data, (model) const_cast<geas::model*>(&m), obj);
+}
+
+result minimize(solver s, intvar obj, limits lim, int probe_limit,
+  void (*on_sol)(void*, model, int), void* data) {
+  c_solution_fn c = { on_sol, data };
+  return unget_result(get_solver(s)->minimize(*get_intvar(obj), lim, probe_limit,
+    on_sol ? call_solution_fn : nullptr, &c));
+}
+
+result minimize_core(solver s, int* ks, intvar* xs, int sz, int k,
+  limits lim, core_options o, void (*on_sol)(void*, model, int), void* data) {
+  vec<int> cs;
+  vec<geas::intvar> vs;
+  for(int ii = 0; ii < sz; ii++) {
+    cs.push(ks[ii]);
+    vs.push(*get_intvar(xs[ii]));
+  }
+  c_solution_fn c = { on_sol, data };
+  return unget_result(geas::minimize_core(*get_solver(s), cs, vs, k, lim, o,
+    on_sol ? call_solution_fn : nullptr, &c));
+}
+
+result minimize_lns(solver s, intvar obj, intvar* xs, int sz,
+  limits lim, lns_options o, void (*on_sol)(void*, model, int), void* data) {
+  vec<geas::intvar> vs;
+  for(int ii = 0; ii < sz; ii++)
+    vs.push(*get_intvar(xs[ii]));
+  c_solution_fn c = { on_sol, data };
+  return unget_result(geas::minimize_lns(*get_solver(s), *get_intvar(obj), vs, lim, o,
+    on_sol ? call_solution_fn : nullptr, &c));
+}
+
 void abort_solve(solver s) { return get_solver(s)->abort(); }
 
 void reset(solver s) {
@@ -471,6 +513,14 @@ statistics get_statistics(solver s) {
   return data->stats;
 }
 
+int get_propagator_profile(solver s, prop_profile* out, int sz) {
+  vec<prop_profile> ps;
+  get_solver(s)->get_propagator_profile(ps);
+  for(int ii = 0; ii < ps.size() && ii < sz; ++ii)
+    out[ii] = ps[ii];
+  return ps.size();
+}
+
 void set_cons_id(solver s, int id) {
   get_solver(s)->data->log.scope_constraint = id;
 }
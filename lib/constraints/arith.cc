@@ -1950,6 +1950,7 @@ bool pred_leq(solver_data* s, pid_t x, pid_t y, int k) {
 
   s->infer.pred_ineqs[x].push({y, k});
   s->infer.pred_ineqs[y^1].push({x^1, k});
+  ++s->infer.num_imps;
   return true;
 }
 
@@ -1,6 +1,7 @@
 #include <climits>
 #include <cstring>
 #include <algorithm>
+#include <type_traits>
 #include <geas/solver/solver_data.h>
 #include <geas/engine/propagator.h>
 #include <geas/engine/propagator_ext.h>
@@ -14,7 +15,8 @@
 
 namespace geas {
 
-// Totally non-incremental time-table propagator.
+// Time-table propagator over a trailed compulsory-part
+// profile, with time-table edge-finding.
 // ============================================
 
 typedef unsigned int task_id;
@@ -34,11 +36,19 @@ struct pevt {
 template <class V>
 class cumul {
 public:
+  class cumul_ttef;
+
   class cumul_val : public propagator, public prop_inst<cumul_val> {
     typedef prop_inst<cumul_val> I;
     typedef cumul_val P;
+    friend class cumul_ttef;
 
     enum ProfileState { P_Invalid = 0, P_Valid = 1, P_Saved = 2 };
+    enum { P_ChunkBits = 8, P_ChunkSz = 1 << P_ChunkBits };
+
+    // The trailed profile is only maintained for integer
+    // consumption; float profiles would drift.
+    static constexpr bool incremental = std::is_integral<V>::value;
 
     // Typedefs
     typedef unsigned int task_id;
@@ -49,29 +59,25 @@ public:
       V r;
     };
 
-    struct evt_info {
-      evt_kind kind;  
-      task_id task;
+    // The profile has level [level] from t up to the following segment.
+    struct seg_info {
       int t;
       V level;
     };
 
+    // Node of the trailed profile.
+    struct pnode {
+      int t;
+      V level;
+      int next;
+    };
+
     struct ex_info {
       task_id t;
       int s;
       int e;
     };
 
-    struct {
-      bool operator()(const evt_info& x, const evt_info& y) const {
-        if(x.t == y.t) {
-          // Process ends before starts.
-          return x.kind < y.kind;
-        }
-        return x.t < y.t;
-      }
-    } pevt_cmp;
-
     int usage_at(int time, const ctx_t& ctx) const {
       V total(0);
       for(const task_info& t : tasks) {
@@ -100,18 +106,34 @@ public:
 
     // Persistent state
     Tint active_end;
+    TrV p_max;
 
     p_sparseset profile_tasks;
     p_sparseset active_tasks;
 
+    // Breakpoints of the compulsory-part profile, as a list
+    // threaded from node 0 (at INT_MIN) to node 1 (at INT_MAX).
+    // Nodes are never freed, so chunks don't move.
+    vec<pnode*> p_chunks;
+    int p_count;
+    // Compulsory part of each task, as recorded in the profile.
+    vec<int> cp_lst;
+    vec<int> cp_eet;
+
     vec<ex_info> exs;
     char exs_saved;
 
     // Transient state.
-    vec<evt_info> profile;
+    vec<seg_info> profile;
+    vec<int64_t> p_area; // Profile energy preceding each segment.
+    vec<seg_info> p_delta;
+    boolset cp_change;
     boolset lb_change;
     boolset ub_change;
     char profile_state;
+    int chg_lo; // Span of the profile changes to sweep
+    int chg_hi;
+    bool sweep_all;
 
     // Helper functions
     inline int est(int xi) const { return lb(tasks[xi].s); }
@@ -122,6 +144,18 @@ public:
     inline V mreq(int xi) const { return tasks[xi].r; }
     inline int dur(int xi) const { return tasks[xi].d; }
 
+
+    pnode& node(int ni) { return p_chunks[ni >> P_ChunkBits][ni & (P_ChunkSz-1)]; }
+
+    int alloc_node(int t, V level, int next) {
+      int ni = p_count;
+      trail_change(s->persist, p_count, p_count+1);
+      if((ni >> P_ChunkBits) >= p_chunks.size())
+        p_chunks.push(new pnode[P_ChunkSz]);
+      node(ni) = pnode { t, level, next };
+      return ni;
+    }
+
     int make_ex(task_id t, int s, int e) {
       this->template save(exs._size(), exs_saved);
       int id = exs.size();
@@ -130,37 +164,31 @@ public:
     }
 
     watch_result wake_lb(int ti) {
+      if(!profile_tasks.elem(ti) && lst(ti) < eet(ti)) {
+        trail_push(s->persist, profile_tasks.sz);
+        profile_tasks.insert(ti);
+      }
       if(profile_tasks.elem(ti)) {
-        profile_state &= ~(P_Valid);
+        cp_change.add(ti);
+        queue_prop();
+      } else if(active_tasks.elem(ti)) {
+        lb_change.add(ti);
         queue_prop();
-      } else {
-        if(lst(ti) < eet(ti)) {
-          trail_push(s->persist, profile_tasks.sz);
-          profile_tasks.insert(ti);
-          profile_state &= ~(P_Valid);
-          queue_prop();
-        } else if(active_tasks.elem(ti)) {
-          lb_change.add(ti);
-          queue_prop();
-        }
       }
       return Wt_Keep;
     }
 
     watch_result wake_ub(int ti) {
+      if(!profile_tasks.elem(ti) && lst(ti) < eet(ti)) {
+        trail_push(s->persist, profile_tasks.sz);
+        profile_tasks.insert(ti);
+      }
       if(profile_tasks.elem(ti)) {
-        profile_state &= ~(P_Valid);
+        cp_change.add(ti);
+        queue_prop();
+      } else if(active_tasks.elem(ti)) {
+        ub_change.add(ti);
         queue_prop();
-      } else {
-        if(lst(ti) < eet(ti)) {
-          trail_push(s->persist, profile_tasks.sz);
-          profile_tasks.insert(ti);
-          profile_state &= ~(P_Valid);
-          queue_prop();
-        } else if(active_tasks.elem(ti)) {
-          ub_change.add(ti);
-          queue_prop();
-        }
       }
       return Wt_Keep;
     }
@@ -175,55 +203,136 @@ public:
     }
 
     void log_profile(void) {
-      for(evt_info e : profile) {
-        std::cerr << e.t << ":" << e.task << ":" << (e.kind == ST ? "+" : "-") << e.level << " ";
+      for(seg_info e : profile) {
+        std::cerr << e.t << ":" << e.level << " ";
       }
       std::cerr << std::endl;
     }
 
-    bool rebuild_profile(vec<clause_elt>& confl) {
-#ifdef LOG_PROFILE
-      if(s->stats.conflicts > LOG_START_AT) {
-      std::cout << "Building profile [" << prop_id << "]:" << std::endl << "-------------------" << std::endl;
-      log_ptasks();
+    void push_delta(int s, int e, V r) {
+      p_delta.push(seg_info { s, r });
+      p_delta.push(seg_info { e, -r });
+      chg_lo = std::min(chg_lo, s);
+      chg_hi = std::max(chg_hi, e);
+    }
+
+    // Fold the compulsory parts of changed tasks into the
+    // trailed profile.
+    bool update_profile(vec<clause_elt>& confl) {
+      p_delta.clear();
+      for(task_id ti : cp_change) {
+        int l = lst(ti);
+        int e = eet(ti);
+        int ol = cp_lst[ti];
+        int oe = cp_eet[ti];
+        if(l == ol && e == oe)
+          continue;
+        if(ol < oe) {
+          // The compulsory part only grows.
+          if(l < ol)
+            push_delta(l, ol, mreq(ti));
+          if(oe < e)
+            push_delta(oe, e, mreq(ti));
+        } else {
+          push_delta(l, e, mreq(ti));
+        }
+        trail_change(s->persist, cp_lst[ti], l);
+        trail_change(s->persist, cp_eet[ti], e);
       }
-#endif
+      cp_change.clear();
+      if(!p_delta.size())
+        return true;
+      std::sort(p_delta.begin(), p_delta.end(),
+        [](const seg_info& x, const seg_info& y) { return x.t < y.t; });
+
+      // Split segments at the new breakpoints...
+      int ni = 0;
+      for(const seg_info& d : p_delta) {
+        while(node(node(ni).next).t <= d.t)
+          ni = node(ni).next;
+        if(node(ni).t < d.t) {
+          int nn = alloc_node(d.t, node(ni).level, node(ni).next);
+          trail_change(s->persist, node(ni).next, nn);
+          ni = nn;
+        }
+      }
+      // ...then shift the levels in between.
+      V acc(0);
+      V pk(p_max);
+      ni = 0;
+      for(seg_info* d = p_delta.begin(); d != p_delta.end(); ) {
+        ni = node(ni).next;
+        pnode& n(node(ni));
+        for(; d != p_delta.end() && d->t <= n.t; ++d)
+          acc += d->level;
+        if(acc != 0) {
+          V l(n.level + acc);
+          trail_change(s->persist, n.level, l);
+          if(l > pk) {
+            if(l > cap) {
+              explain_overload(n.t, confl);
+              return false;
+            }
+            pk = l;
+          }
+        }
+      }
+      if(pk > p_max)
+        set(p_max, pk);
+      return true;
+    }
 
+    void flatten_profile(void) {
       profile.clear();
-      // profile.push(evt_info { ET, INT_MAX, INT_MIN, 0 });
-      profile.push(evt_info { ST, INT_MAX, INT_MIN, 0 });
-      for(task_id ti : profile_tasks) {
-        profile.push(evt_info { ST, ti, lst(ti), mreq(ti) });
-        profile.push(evt_info { ET, ti, eet(ti), mreq(ti) });
+      p_area.clear();
+      int64_t area = 0;
+      for(int ni = 0; ni != 1; ni = node(ni).next) {
+        pnode& n(node(ni));
+        profile.push(seg_info { n.t, n.level });
+        p_area.push(area);
+        if(ni)
+          area += ((int64_t) n.level) * ((int64_t) node(n.next).t - n.t);
       }
-      std::sort(profile.begin()+1, profile.end(), pevt_cmp);
-      profile.push(evt_info { ET, INT_MAX, INT_MAX, 0});
-
-      // Now replace the deltas with actual values
+      profile.push(seg_info { INT_MAX, 0 });
+      p_area.push(area);
+    }
 
+    // Non-incremental version, for non-integral consumption.
+    bool rebuild_profile(vec<clause_elt>& confl) {
 #ifdef LOG_PROFILE
       if(s->stats.conflicts > LOG_START_AT) {
-      log_profile();
+      std::cout << "Building profile [" << prop_id << "]:" << std::endl << "-------------------" << std::endl;
+      log_ptasks();
       }
 #endif
+      p_delta.clear();
+      for(task_id ti : profile_tasks) {
+        p_delta.push(seg_info { lst(ti), mreq(ti) });
+        p_delta.push(seg_info { eet(ti), -mreq(ti) });
+      }
+      std::sort(p_delta.begin(), p_delta.end(),
+        [](const seg_info& x, const seg_info& y) { return x.t < y.t; });
 
+      profile.clear();
+      profile.push(seg_info { INT_MIN, 0 });
       V cumul(0);
-      V p_max(0);
-      for(evt_info& e : profile) {
-        if(e.kind == ST) {
-          cumul += e.level;
-          if(cumul > p_max) {
-            if(cumul > cap) {
-              explain_overload(e.t, confl);
-              return false;
-            }
-            p_max = cumul;
+      V pk(0);
+      for(int ii = 0; ii < p_delta.size(); ++ii) {
+        cumul += p_delta[ii].level;
+        if(ii+1 < p_delta.size() && p_delta[ii+1].t == p_delta[ii].t)
+          continue;
+        if(cumul > pk) {
+          if(cumul > cap) {
+            explain_overload(p_delta[ii].t, confl);
+            return false;
           }
-        } else {
-          cumul -= e.level;
+          pk = cumul;
         }
-        e.level = cumul;
+        profile.push(seg_info { p_delta[ii].t, cumul });
       }
+      profile.push(seg_info { INT_MAX, 0 });
+      if(pk > p_max)
+        set(p_max, pk);
 
 #ifdef LOG_PROFILE
       if(s->stats.conflicts > LOG_START_AT) {
@@ -231,98 +340,77 @@ public:
       std::cerr << std::endl;
       }
 #endif
+      return true;
+    }
 
+    void activate_tasks(void) {
       // Activate any remaining tasks which might
       // be shifted.
       V req_max(cap - p_max);
       int ti = active_end;
       if(ti < tasks.size() && mreq(ti) > req_max) {
         trail_push(s->persist, active_tasks.sz);
-        active_tasks.insert(ti);
-        for(++ti; ti < tasks.size(); ++ti) {
+        for(; ti < tasks.size(); ++ti) {
           if(mreq(ti) <= req_max)
             break;
           assert(!active_tasks.elem(ti));
           active_tasks.insert(ti);
+          lb_change.add(ti);
+          ub_change.add(ti);
         }
         set(active_end, ti);
       }
-      return true;
     }
 
     bool sweep_fwd(task_id ti) {
-      // Find the starting interval
       const task_info& t(tasks[ti]);
-
-      evt_info* s = std::upper_bound(profile.begin(), profile.end(),
-        est(ti), [](const int& t, const evt_info& e) { return t <= e.t - (e.kind == ET) ; });
-      if(s == profile.end())
-        return true;
-      // Task stats in the previous interval   
       V lev_max = cap - mreq(ti);
+      // Segments from the task's own compulsory part
+      // include its usage.
+      int own = profile_tasks.elem(ti) ? lst(ti) : INT_MAX;
 
+      // Find the starting interval
+      seg_info* seg = std::upper_bound(profile.begin(), profile.end(),
+        est(ti), [](const int& t, const seg_info& e) { return t < e.t; }) - 1;
       int end_time = est(ti) + t.d;
-      if(s[-1].task == ti)
-        return true;
-      int ex_time = s[-1].t;
-      V seg_level = s[-1].level;
-
-      while(ex_time < end_time) {
-        if(seg_level > lev_max) {
+      for(; seg->t < end_time && seg->t < own; ++seg) {
+        if(seg->level > lev_max) {
           // Shift start and reset.
-          if(!set_lb(t.s, s->t, this->template expl<&P::ex_est>(make_ex(ti, ex_time, s->t), expl_thunk::Ex_BTPRED)))
+          if(!set_lb(t.s, seg[1].t, this->template expl<&P::ex_est>(make_ex(ti, seg->t, seg[1].t), expl_thunk::Ex_BTPRED)))
             return false;
-          end_time = s->t + t.d;
+          end_time = seg[1].t + t.d;
         }
-        // The profile's going to be updated anyway.
-        if(s->task == ti)
-          return true;
-        ex_time = s->t;
-        seg_level = s->level;
-        ++s;
       }
       return true;
     }
 
     bool sweep_bwd(task_id ti) {
-#if 0
-      return true;
-#endif
-      // Find the starting interval
       const task_info& t(tasks[ti]);
-
-      // evt_info* s = profile.begin();
-      // while(s->t - (s->kind == ET) < let(ti)) ++s;
-      evt_info* s = std::upper_bound(profile.begin(), profile.end(),
-        let(ti), [](const int& t, const evt_info& e) { return t < e.t + (e.kind == ST) ; });
-      if(s == profile.begin())
-        return true;
-      // Task stats in the previous interval   
       V lev_max = cap - mreq(ti);
+      int own = profile_tasks.elem(ti) ? eet(ti) : INT_MIN;
 
+      // Find the last interval overlapping the task.
+      seg_info* seg = std::upper_bound(profile.begin(), profile.end(),
+        let(ti) - 1, [](const int& t, const seg_info& e) { return t < e.t; }) - 1;
       int start_time = lst(ti);
-      int ex_time = s->t;
-      if(s->task == ti)
-        return true;
-
-      --s;
-      do {
-        assert(ex_time > start_time);
-        if(s->task == ti)
-          return true;
-        if(s->level > lev_max) {
-          // Shift start and reset.
-          if(!set_ub(t.s, s->t - t.d, this->template expl<&P::ex_let>(make_ex(ti, s->t, ex_time), expl_thunk::Ex_BTPRED)))
+      for(; seg != profile.begin() && seg[1].t > start_time && seg[1].t > own; --seg) {
+        if(seg->level > lev_max) {
+          if(!set_ub(t.s, seg->t - t.d, this->template expl<&P::ex_let>(make_ex(ti, seg->t, seg[1].t), expl_thunk::Ex_BTPRED)))
             return false;
-          start_time = s->t - t.d;
+          start_time = seg->t - t.d;
         }
-        // The profile's going to be updated anyway.
-        ex_time = s->t;
-        --s;
-      } while(ex_time > start_time);
+      }
       return true;
     }
 
+    int64_t area_before(int t) const {
+      const seg_info* seg = std::upper_bound(profile.begin(), profile.end(),
+        t, [](const int& t, const seg_info& e) { return t < e.t; }) - 1;
+      if(seg == profile.begin())
+        return 0;
+      return p_area[(int) (seg - profile.begin())] + ((int64_t) seg->level) * ((int64_t) t - seg->t);
+    }
+
     inline void EX_PUSH(vec<clause_elt>& expl, patom_t at) {
       assert(!ub(at));
       expl.push(at);
@@ -332,23 +420,14 @@ public:
       ex_info e(exs[ex_id]);
       task_id ti(e.t);
       const task_info& t(tasks[ti]);
-      // int t_est(std::max(t.s.lb_of_pval(p), e.ex_time+1));
 
-      // Assumption: we're doing stepwise-propagation.
-      // So at this point, lb(t.s) < est, and every task
-      // active at (est-1) was active from lb(t.s) + dur - 1.
-      
-      // So, we collect a sufficient set of tasks, active at
-      // (est-1).
+      // Collect a sufficient set of tasks covering
+      // [e.s, e.e), then discard any we can do without.
       V e_req = (cap - t.r);
       vec<task_id> etasks;
       for(task_id p : profile_tasks) {
         if(lst(p) <= e.s && e.e <= eet(p)) {
-          // if(p == ti)
-          //   continue;
           assert(p != ti);
-          // assert(lst(p) >= lb(t.s));
-
           etasks.push(p);
           if(e_req < mreq(p)) {
             // Found a cover. Minimize, and find a relaxed
@@ -357,8 +436,8 @@ public:
             
             int jj = 0;
             for(int ii = 0; ii < etasks.size(); ++ii) {
-              if(mreq(p) < slack) {
-                slack -= mreq(p);
+              if(mreq(etasks[ii]) < slack) {
+                slack -= mreq(etasks[ii]);
                 continue;
               }
               etasks[jj++] = etasks[ii];
@@ -385,18 +464,13 @@ public:
       ex_info e(exs[ex_id]);
       task_id ti(e.t);
       const task_info& t(tasks[ti]);
-      // int t_let(std::min(t.s.ub_of_pval(p) + t.d, e.ex_time));
 
       V e_req = (cap - t.r);
       vec<task_id> etasks;
       for(task_id p : profile_tasks) {
-        // if(lst(p) < e.ex_time && e.ex_time <= eet(p)) {
         if(lst(p) <= e.s && e.e <= eet(p)) {
-          // assert(p != ti);
           if(p == ti)
             continue;
-          // assert(lst(p) >= lb(t.s));
-
           etasks.push(p);
           if(e_req < mreq(p)) {
             // Found a cover. Minimize, and find a relaxed
@@ -405,33 +479,21 @@ public:
             
             int jj = 0;
             for(int ii = 0; ii < etasks.size(); ++ii) {
-              if(mreq(p) < slack) {
-                slack -= mreq(p);
+              if(mreq(etasks[ii]) < slack) {
+                slack -= mreq(etasks[ii]);
                 continue;
               }
               etasks[jj++] = etasks[ii];
             }
             etasks.shrink_(etasks.size() - jj);
             // Now construct the actual explanation
-#if 1
-            // Either t is pushed after e.ex_time...
-            // EX_PUSH(expl, t.s >= e.ex_time);
+            // Either t is pushed after e.e...
             EX_PUSH(expl, t.s >= e.e);
             // ...or some member of etasks doesn't cover.
             for(task_id p : etasks) {
-              // EX_PUSH(expl, tasks[p].s > t_let);
-              // EX_PUSH(expl, tasks[p].s < e.ex_time - tasks[p].d);
               EX_PUSH(expl, tasks[p].s > e.s);
               EX_PUSH(expl, tasks[p].s < e.e - tasks[p].d);
             }
-#else
-            // Semi-naive explanation
-            expl.push(t.s > ub(t.s));
-            for(task_id p : etasks) {
-              expl.push(tasks[p].s < lb(tasks[p].s));
-              expl.push(tasks[p].s > ub(tasks[p].s));
-            }
-#endif
             return;
           }
           e_req -= mreq(p);
@@ -473,14 +535,17 @@ public:
   public:
     cumul_val(solver_data* s, vec<intvar>& starts, vec<int>& dur, vec<V>& res, V _cap)
       : propagator(s), cap(_cap)
-      , active_end(0)
+      , active_end(0), p_max(0)
       , profile_tasks(starts.size())
       , active_tasks(0)
+      , p_count(2)
       , exs_saved(false)
       , profile()
+      , cp_change(starts.size())
       , lb_change(starts.size())
       , ub_change(starts.size())
-      , profile_state(P_Invalid) {
+      , profile_state(P_Invalid)
+      , chg_lo(INT_MAX), chg_hi(INT_MIN), sweep_all(false) {
       for(int xi : irange(starts.size())) {
         // If a task has zero duration or resource consumption, skip it.
         if(!dur[xi] || !res[xi])
@@ -492,61 +557,319 @@ public:
       }
       active_tasks.growTo_strict(tasks.size());
       std::sort(tasks.begin(), tasks.end(), [](const task_info& x, const task_info& y) { return x.r > y.r; });
+
+      p_chunks.push(new pnode[P_ChunkSz]);
+      node(0) = pnode { INT_MIN, 0, 1 };
+      node(1) = pnode { INT_MAX, 0, -1 };
+      cp_lst.growTo(tasks.size(), 0);
+      cp_eet.growTo(tasks.size(), 0);
       for(int xi: irange(tasks.size())) {
         task_info& t(tasks[xi]);
         t.s.attach(E_LB, this->template watch<&P::wake_lb>(xi));
         t.s.attach(E_UB, this->template watch<&P::wake_ub>(xi));
-        // tasks.push(t);
         if(lst(xi) < eet(xi)) {
           profile_tasks.insert(xi);
+          cp_change.add(xi);
         }
       }
+      queue_prop();
     }
 
-    bool propagate(vec<clause_elt>& confl) {
-      // fprintf(stderr, "Active: %d of %d\n", active_tasks.size(), tasks.size());
-      if(!(profile_state & P_Valid)) {
+    ~cumul_val(void) {
+      for(pnode* c : p_chunks)
+        delete[] c;
+    }
+
+    // Brings the flattened profile up to date with the
+    // compulsory parts.
+    bool sync_profile(vec<clause_elt>& confl) {
+      // After backtracking, the flattened profile is stale.
+      bool stale = !(profile_state & P_Valid);
+      bool changed = stale;
+      if(incremental) {
+        if(!update_profile(confl))
+          return false;
+        changed |= (p_delta.size() > 0);
+      } else if(stale || cp_change.size()) {
+        cp_change.clear();
+        if(!rebuild_profile(confl))
+          return false;
+        changed = stale = true;
+      }
+      if(changed) {
         if(!(profile_state & P_Saved))
           s->persist.bt_flags.push(&profile_state);
-        if(!rebuild_profile(confl))
+        if(incremental)
+          flatten_profile();
+        profile_state = (P_Saved | P_Valid);
+        activate_tasks();
+      }
+      sweep_all |= stale;
+      return true;
+    }
+
+    bool propagate(vec<clause_elt>& confl) {
+      if(!sync_profile(confl))
+        return false;
+
+      // Only re-sweep tasks which overlap the change, or whose
+      // bounds have moved.
+      for(task_id t : active_tasks) {
+        if(is_fixed(tasks[t].s)) {
+          assert(profile_tasks.elem(t));
+          continue;
+        }
+        bool touched = sweep_all || (est(t) < chg_hi && chg_lo < let(t));
+        if((touched || lb_change.elem(t)) && !sweep_fwd(t))
           return false;
-        profile_state = (P_Saved & P_Valid);
-#if 1
-        for(task_id t : active_tasks) {
-          if(is_fixed(tasks[t].s)) {
-            assert(profile_tasks.elem(t));
+        if((touched || ub_change.elem(t)) && !sweep_bwd(t))
+          return false;
+      }
+      return true;
+    }
+
+    void cleanup(void) {
+      cp_change.clear();
+      lb_change.clear();
+      ub_change.clear();
+      chg_lo = INT_MAX;
+      chg_hi = INT_MIN;
+      sweep_all = false;
+      is_queued = false;
+    }
+  };
+
+  // Time-table edge-finding, over the profile of a cumul_val.
+  // Much more expensive than the time-table, so it runs
+  // at low priority.
+  class cumul_ttef : public propagator, public prop_inst<cumul_ttef> {
+    typedef prop_inst<cumul_ttef> I;
+    typedef cumul_ttef P;
+
+    typedef unsigned int task_id;
+
+    struct ttef_info {
+      task_id t;
+      int dir;
+      int a;
+      int b;
+    };
+
+    struct elt_info {
+      task_id t;
+      int k;
+    };
+
+    bool check_sat(ctx_t& ctx) { return tt->check_sat(ctx); }
+    bool check_unsat(ctx_t& ctx) { return !check_sat(ctx); }
+
+    // The time-table we're working from.
+    cumul_val* tt;
+
+    vec<ttef_info> exs;
+    char exs_saved;
+
+    // Transient state
+    vec<int> t_est;
+    vec<int> t_lct;
+    vec<int64_t> t_est_area;
+    vec<int64_t> t_lct_area;
+    vec<int> est_ord;
+    vec<int> lct_ord;
+
+    inline int est(int xi) const { return lb(tt->tasks[xi].s); }
+    inline int let(int xi) const { return ub(tt->tasks[xi].s) + tt->tasks[xi].d; }
+    inline V mreq(int xi) const { return tt->tasks[xi].r; }
+    inline int dur(int xi) const { return tt->tasks[xi].d; }
+
+    // Bounds of the mirrored problem, if dir is set.
+    inline int est_d(int dir, int xi) const { return dir ? -let(xi) : est(xi); }
+    inline int lct_d(int dir, int xi) const { return dir ? -est(xi) : let(xi); }
+    inline int cp_len(int xi) const { return std::max(0, tt->cp_eet[xi] - tt->cp_lst[xi]); }
+
+    // Profile energy before t, in the mirrored problem if dir is set.
+    int64_t area_before_d(int dir, int t) const {
+      return dir ? -tt->area_before(-t) : tt->area_before(t);
+    }
+
+    int make_ttef(task_id t, int dir, int a, int b) {
+      this->template save(exs._size(), exs_saved);
+      int id = exs.size();
+      exs.push(ttef_info { t, dir, a, b });
+      return id;
+    }
+
+    watch_result wake(int ti) {
+      queue_prop();
+      return Wt_Keep;
+    }
+
+    // Checks the windows [est_i, lct_j), with the energy of the
+    // compulsory parts plus the free parts of tasks inside the window.
+    // For each window, the task extending furthest past lct_j is pushed
+    // if its free part doesn't fit.
+    bool prop_ttef(int dir, vec<clause_elt>& confl) {
+      int n = tt->tasks.size();
+      t_est.clear(); t_lct.clear();
+      t_est_area.clear(); t_lct_area.clear();
+      for(int xi : irange(n)) {
+        t_est.push(est_d(dir, xi));
+        t_lct.push(lct_d(dir, xi));
+        t_est_area.push(area_before_d(dir, t_est.last()));
+        t_lct_area.push(area_before_d(dir, t_lct.last()));
+      }
+      std::sort(est_ord.begin(), est_ord.end(),
+        [this](int x, int y) { return t_est[x] > t_est[y]; });
+      std::sort(lct_ord.begin(), lct_ord.end(),
+        [this](int x, int y) { return t_lct[x] > t_lct[y]; });
+
+      for(int jj : irange(n)) {
+        int b = t_lct[lct_ord[jj]];
+        if(jj > 0 && b == t_lct[lct_ord[jj-1]])
+          continue;
+        int64_t b_area = t_lct_area[lct_ord[jj]];
+        int64_t e_free = 0;
+        int u = -1;
+        int64_t u_viol = 0;
+        int64_t u_cp = 0;
+        for(int ii = 0; ii < n; ) {
+          int a = t_est[est_ord[ii]];
+          int64_t a_area = t_est_area[est_ord[ii]];
+          if(a >= b) {
+            ++ii;
             continue;
           }
-          if(!sweep_fwd(t))
-            return false;
-          if(!sweep_bwd(t))
-            return false;   
-        }
-#endif
-      } else {
-        // If the profile hasn't changed, only sweep
-        // variables with updated bounds.
-#if 1
-        for(task_id t : lb_change) {
-          if(is_fixed(tasks[t].s))
-            continue;
-          if(!sweep_fwd(t))
-            return false;
-        }
-        for(task_id t : ub_change) {
-          if(is_fixed(tasks[t].s))
-            continue;
-          if(!sweep_bwd(t))
+          for(; ii < n && t_est[est_ord[ii]] == a; ++ii) {
+            int xi = est_ord[ii];
+            int64_t r = mreq(xi);
+            if(t_lct[xi] <= b) {
+              e_free += r * (dur(xi) - cp_len(xi));
+            } else {
+              // Compulsory energy of xi already in the window.
+              int cp_s = dir ? -tt->cp_eet[xi] : tt->cp_lst[xi];
+              int64_t cp = r * std::max(0, std::min(cp_s + cp_len(xi), b) - cp_s);
+              int64_t viol = r * std::min(b - a, dur(xi)) - cp;
+              if(viol > u_viol) {
+                u = xi;
+                u_viol = viol;
+                u_cp = cp;
+              }
+            }
+          }
+          int64_t avail = ((int64_t) tt->cap) * (b - a) - (b_area - a_area) - e_free;
+          if(avail < 0) {
+            ex_energy(dir, a, b, ((int64_t) tt->cap) * (b - a) + 1, -1, confl);
             return false;
+          }
+          if(u_viol > avail) {
+            int v = b - (avail + u_cp)/mreq(u);
+            if(v > est_d(dir, u)) {
+              reason h(this->template expl<&P::ex_ttef>(make_ttef(u, dir, a, b), expl_thunk::Ex_BTPRED));
+              if(dir ? !set_ub(tt->tasks[u].s, -v - dur(u), h) : !set_lb(tt->tasks[u].s, v, h))
+                return false;
+            }
+          }
         }
-#endif
       }
       return true;
     }
 
+    inline void EX_PUSH(vec<clause_elt>& expl, patom_t at) {
+      assert(!ub(at));
+      expl.push(at);
+    }
+
+    // Collects tasks (other than skip) which must spend at least
+    // [need] energy in [a, b), lifting their bounds as far as
+    // the slack allows.
+    void ex_energy(int dir, int a, int b, int64_t need, int skip, vec<clause_elt>& expl) {
+      vec<elt_info> elts;
+      for(int xi : irange(tt->tasks.size())) {
+        if(xi == skip)
+          continue;
+        int d = dur(xi);
+        int k = std::min(std::min(d, b - a),
+          std::min(est_d(dir, xi) + d - a, b - lct_d(dir, xi) + d));
+        if(k > 0)
+          elts.push(elt_info { (task_id) xi, k });
+      }
+      std::sort(elts.begin(), elts.end(),
+        [this](const elt_info& x, const elt_info& y) { return x.k * (int64_t) mreq(x.t) > y.k * (int64_t) mreq(y.t); });
+      int64_t total = 0;
+      int sz = 0;
+      while(total < need) {
+        assert(sz < elts.size());
+        total += elts[sz].k * (int64_t) mreq(elts[sz].t);
+        ++sz;
+      }
+      int64_t slack = total - need;
+      for(int ii = sz-1; ii >= 0; --ii) {
+        task_id xi = elts[ii].t;
+        int64_t r = mreq(xi);
+        int k = elts[ii].k - std::min((int64_t) elts[ii].k, slack / r);
+        slack -= r * (elts[ii].k - k);
+        if(!k)
+          continue;
+        const intvar& x(tt->tasks[xi].s);
+        int d = dur(xi);
+        // xi starts late enough, and early enough, to
+        // overlap the window by k.
+        int lo = a + k - d;
+        int hi = b - k;
+        if(dir) {
+          if(-lo - d < ub_0(x))
+            EX_PUSH(expl, x > -lo - d);
+          if(-hi - d > lb_0(x))
+            EX_PUSH(expl, x < -hi - d);
+        } else {
+          if(lo > lb_0(x))
+            EX_PUSH(expl, x < lo);
+          if(hi < ub_0(x))
+            EX_PUSH(expl, x > hi);
+        }
+      }
+    }
+
+    void ex_ttef(int ex_id, pval_t p, vec<clause_elt>& expl) {
+      ttef_info e(exs[ex_id]);
+      const intvar& x(tt->tasks[e.t].s);
+      int d = dur(e.t);
+      int v = e.dir ? -x.ub_of_pval(p) - d : x.lb_of_pval(p);
+      // Unless the task starts from v, it overlaps
+      // the window by at least k.
+      int k = std::min(e.b - v + 1, d);
+      int lo = e.a + k - d;
+      if(e.dir) {
+        if(-lo - d < ub_0(x))
+          EX_PUSH(expl, x > -lo - d);
+      } else {
+        if(lo > lb_0(x))
+          EX_PUSH(expl, x < lo);
+      }
+      ex_energy(e.dir, e.a, e.b, ((int64_t) tt->cap) * (e.b - e.a) - ((int64_t) mreq(e.t)) * k + 1, e.t, expl);
+    }
+
+
+  public:
+    cumul_ttef(solver_data* s, cumul_val* _tt)
+      : propagator(s, PRIO_LOW), tt(_tt), exs_saved(false) {
+      for(int xi : irange(tt->tasks.size())) {
+        intvar x(tt->tasks[xi].s);
+        x.attach(E_LB, this->template watch<&P::wake>(xi));
+        x.attach(E_UB, this->template watch<&P::wake>(xi));
+        est_ord.push(xi);
+        lct_ord.push(xi);
+      }
+      queue_prop();
+    }
+
+    bool propagate(vec<clause_elt>& confl) {
+      if(!tt->sync_profile(confl))
+        return false;
+      return prop_ttef(0, confl) && prop_ttef(1, confl);
+    }
+
     void cleanup(void) {
-      lb_change.clear();
-      ub_change.clear();
       is_queued = false;
     }
   };
@@ -2304,7 +2627,18 @@ bool cumulative(solver_data* s,
   vec<intvar>& starts, vec<int>& duration, vec<int>& resource, int cap) {
   // new cumul_prop(s, starts, duration, resource, cap);
   // return true;
-  return cumul<int>::cumul_val::post(s, starts, duration, resource, cap);
+  // Fail before constructing anything: a propagator registers
+  // itself with the solver, so one thrown out of its constructor
+  // would be freed twice.
+  for(int xi : irange(starts.size())) {
+    if(duration[xi] && resource[xi] > cap) {
+      s->solver_is_consistent = false;
+      return false;
+    }
+  }
+  cumul<int>::cumul_val* tt(new cumul<int>::cumul_val(s, starts, duration, resource, cap));
+  new cumul<int>::cumul_ttef(s, tt);
+  return true;
 }
 
 bool cumulative_var(solver_data* s,
@@ -2,6 +2,7 @@
 #include <geas/engine/propagator.h>
 #include <geas/engine/propagator_ext.h>
 #include <geas/vars/intvar.h>
+#include <geas/constraints/builtins.h>
 namespace geas {
 
 // Helpful functions
@@ -74,6 +75,19 @@ struct ps_tree {
     nodes[p] = node_t { dur, ect, dur, ect };
     percolate(p);
   }
+  // Add elt as a gray (optional) task.
+  void add_gray(unsigned int elt) {
+    int dur = f.dur(elt);
+    int ect = f.ect(elt);
+
+    unsigned int p(idx(elt));
+    nodes[p] = node_t { 0, INT_MIN, dur, ect };
+    percolate(p);
+  }
+  void clear(void) {
+    for(node_t& n : nodes)
+      n = node_t { 0, INT_MIN, 0, INT_MIN };
+  }
   void remove(unsigned int elt) {
     unsigned int p(idx(elt));
     nodes[p] = node_t { 0, INT_MIN, 0, INT_MIN };
@@ -583,6 +597,387 @@ class disjunctive : public propagator, public prop_inst<disjunctive> {
     char edata_saved;
 };
 
+// Disjunctive with variable durations and optional tasks.
+// Reasoning is over the minimal interval [s, s + lb(d)) of each
+// task, so every rule is the fixed-duration one; durations only
+// enter explanations. Optional tasks (presence not yet fixed) are
+// never moved, but are made absent when they cannot fit.
+// Tasks which may have zero length are ignored.
+// Each rule is written once, for the lower bound of the start;
+// dir = 1 runs it on the mirrored problem (t -> -t).
+class disj_var : public propagator, public prop_inst<disj_var> {
+  enum { T_Absent = 0, T_Opt = 1, T_Present = 2 };
+
+  struct eval_ect {
+    int ect(int p) const {
+      int xi = d->perm[p];
+      return d->c_est[xi] + d->c_du[xi];
+    }
+    int dur(int p) const { return d->c_du[d->perm[p]]; }
+    disj_var* d;
+  };
+
+  // For semi-eager explanations.
+  struct ex_data {
+    int xi;
+    int dir;
+    int opt; // Was xi optional (so the inference is ~p)?
+    int a;
+    int b;
+    int c;
+    int v;
+  };
+
+  inline int du(int xi) { return lb(ds[xi]); }
+  inline int est(int dir, int xi) {
+    return dir ? -(ub(xs[xi]) + du(xi)) : lb(xs[xi]);
+  }
+  inline int lct(int dir, int xi) {
+    return dir ? -lb(xs[xi]) : ub(xs[xi]) + du(xi);
+  }
+  inline int status(int xi) {
+    if(s->state.is_entailed(ps[xi]))
+      return T_Present;
+    return s->state.is_inconsistent(ps[xi]) ? T_Absent : T_Opt;
+  }
+
+  watch_result wake(int xi) {
+    queue_prop();
+    return Wt_Keep;
+  }
+
+  // Explanation atoms: est(dir, xi) >= a, lct(dir, xi) <= b,
+  // and xi's duration and presence.
+  void ex_est(int dir, int xi, int a, vec<clause_elt>& expl) {
+    if(dir)
+      EX_PUSH(expl, xs[xi] > -a - du(xi));
+    else
+      EX_PUSH(expl, xs[xi] < a);
+  }
+  void ex_lct(int dir, int xi, int b, vec<clause_elt>& expl) {
+    if(dir)
+      EX_PUSH(expl, xs[xi] < -b);
+    else
+      EX_PUSH(expl, xs[xi] > b - du(xi));
+  }
+  void ex_task(int xi, vec<clause_elt>& expl) {
+    if(du(xi) > lb_0(ds[xi]))
+      EX_PUSH(expl, ds[xi] < du(xi));
+    if(s->state.is_entailed(ps[xi]) && !s->state.is_entailed_l0(ps[xi]))
+      EX_PUSH(expl, ~ps[xi]);
+  }
+  // Collect present tasks other than skip with est >= lo and
+  // lct (or lst, if by_lst) <= hi, until their energy reaches need.
+  void ex_window(int dir, int lo, int hi, bool by_lst, int need, int skip, vec<clause_elt>& expl) {
+    if(need <= 0)
+      return;
+    for(int xi : irange(xs.size())) {
+      if(xi == skip || du(xi) == 0 || status(xi) != T_Present)
+        continue;
+      int end = by_lst ? hi + du(xi) : hi;
+      if(est(dir, xi) < lo || lct(dir, xi) > end)
+        continue;
+      ex_est(dir, xi, lo, expl);
+      ex_lct(dir, xi, end, expl);
+      ex_task(xi, expl);
+      need -= du(xi);
+      if(need <= 0)
+        return;
+    }
+    assert(need <= 0);
+  }
+
+  // Edge-finding: xi ends after the tasks in [a, b], and those
+  // in [c, b] take until v.
+  void ex_ef(int eid, pval_t p, vec<clause_elt>& expl) {
+    ex_data e(edata[eid]);
+    ex_est(e.dir, e.xi, e.a, expl);
+    ex_task(e.xi, expl);
+    if(e.opt && e.v == INT_MIN) {
+      // xi itself lies inside the overloaded window.
+      ex_lct(e.dir, e.xi, e.b, expl);
+      ex_window(e.dir, e.a, e.b, false, e.b - e.a - du(e.xi) + 1, e.xi, expl);
+      return;
+    }
+    ex_window(e.dir, e.a, e.b, false, e.b - e.a - du(e.xi) + 1, e.xi, expl);
+    ex_window(e.dir, e.c, e.b, false, e.v - e.c, e.xi, expl);
+    if(e.opt)
+      ex_lct(e.dir, e.xi, e.v - 1 + du(e.xi), expl);
+  }
+
+  // Detectable precedences: tasks in [c, ..) with lst < a
+  // precede xi, and take until v.
+  void ex_dp(int eid, pval_t p, vec<clause_elt>& expl) {
+    ex_data e(edata[eid]);
+    ex_est(e.dir, e.xi, e.a - du(e.xi), expl);
+    ex_task(e.xi, expl);
+    ex_window(e.dir, e.c, e.a - 1, true, e.v - e.c, e.xi, expl);
+    if(e.opt)
+      ex_lct(e.dir, e.xi, e.v - 1 + du(e.xi), expl);
+  }
+
+  // Not-last: the tasks in [c, ..) with lst <= b run past
+  // xi's lst (a), so xi ends by b.
+  void ex_nl(int eid, pval_t p, vec<clause_elt>& expl) {
+    ex_data e(edata[eid]);
+    ex_lct(e.dir, e.xi, e.a + du(e.xi), expl);
+    ex_task(e.xi, expl);
+    // Needs at least one task, even if it starts after xi's lst.
+    ex_window(e.dir, e.c, e.b, true, std::max(1, e.a - e.c + 1), e.xi, expl);
+    if(e.opt)
+      ex_est(e.dir, e.xi, e.b - du(e.xi) + 1, expl);
+  }
+
+public:
+  disj_var(solver_data* s, vec<intvar>& _st, vec<intvar>& _du, vec<patom_t>& _ps)
+    : propagator(s), xs(_st), ds(_du), ps(_ps)
+    , tree(eval_ect { this }, xs.size())
+    , edata_saved(false) {
+    for(int ii : irange(xs.size())) {
+      if(!enqueue(*s, ds[ii] >= 0, reason()))
+        throw RootFail();
+      xs[ii].attach(E_LU, watch<&P::wake>(ii));
+      ds[ii].attach(E_LB, watch<&P::wake>(ii));
+      if(!s->state.is_entailed_l0(ps[ii]))
+        attach(s, ps[ii], watch<&P::wake>(ii));
+      c_est.push(0);
+      c_lct.push(0);
+      c_du.push(0);
+      c_st.push(T_Absent);
+      perm.push(ii);
+      pos.push(ii);
+      in_theta.push(false);
+    }
+  }
+
+  int make_edata(int xi, int dir, int opt, int a, int b, int c, int v) {
+    int id = edata.size();
+    trail_save(s->persist, edata._size(), edata_saved);
+    edata.push(ex_data { xi, dir, opt, a, b, c, v });
+    return id;
+  }
+
+  void cleanup(void) {
+    is_queued = false;
+  }
+
+  // Cache the bounds for dir, and lay out the tree by est.
+  void snapshot(int dir) {
+    for(int xi : irange(xs.size())) {
+      c_du[xi] = du(xi);
+      c_est[xi] = est(dir, xi);
+      c_lct[xi] = lct(dir, xi);
+      // Zero-length tasks may overlap anything.
+      c_st[xi] = c_du[xi] > 0 ? status(xi) : T_Absent;
+    }
+    std::sort(perm.begin(), perm.end(),
+      [this](int x, int y) { return c_est[x] < c_est[y]; });
+    for(int ii : irange(perm.size()))
+      pos[perm[ii]] = ii;
+    tree.clear();
+  }
+  int c_lst(int xi) const { return c_lct[xi] - c_du[xi]; }
+
+  bool set_est(int dir, int xi, int v, expl_thunk ex) {
+    if(v <= est(dir, xi))
+      return true;
+    return dir ? set_ub(xs[xi], -v - du(xi), ex) : set_lb(xs[xi], v, ex);
+  }
+  bool set_lct(int dir, int xi, int v, expl_thunk ex) {
+    if(lct(dir, xi) <= v)
+      return true;
+    return dir ? set_lb(xs[xi], -v, ex) : set_ub(xs[xi], v - du(xi), ex);
+  }
+  bool set_absent(int xi, expl_thunk ex) {
+    if(s->state.is_inconsistent(ps[xi]))
+      return true;
+    return enqueue(*s, ~ps[xi], ex);
+  }
+
+  // Overload checking and edge-finding, with optional tasks
+  // starting out gray.
+  bool prop_ef(int dir, vec<clause_elt>& confl) {
+    snapshot(dir);
+    order.clear();
+    for(int xi : irange(xs.size())) {
+      if(c_st[xi] == T_Present) {
+        tree.add(pos[xi]);
+        order.push(xi);
+      } else if(c_st[xi] == T_Opt) {
+        tree.add_gray(pos[xi]);
+      }
+    }
+    std::sort(order.begin(), order.end(),
+      [this](int x, int y) { return c_lct[x] > c_lct[y]; });
+
+    for(int xj : order) {
+      int U = c_lct[xj];
+      if(tree.root().ect > U) {
+        int lo = c_est[perm[tree.binding_task(U+1)]];
+        ex_window(dir, lo, U, false, U - lo + 1, -1, confl);
+        return false;
+      }
+      while(tree.root().o_ect > U) {
+        int tP(tree.root().o_ect);
+        unsigned int pi = tree.blocked_task(tP);
+        int xi = perm[pi];
+        int L1 = c_est[perm[tree.blocking_task(tP)]];
+        int E = tree.root().ect;
+        int L2 = c_est[perm[tree.binding_task(E)]];
+        if(c_st[xi] == T_Present) {
+          if(est(dir, xi) < E) {
+            if(!set_est(dir, xi, E,
+                 ex_thunk(ex<&P::ex_ef>, make_edata(xi, dir, 0, L1, U, L2, E), expl_thunk::Ex_BTPRED)))
+              return false;
+          }
+        } else if(c_lct[xi] <= U) {
+          if(!set_absent(xi,
+               ex_thunk(ex<&P::ex_ef>, make_edata(xi, dir, 1, L1, U, L2, INT_MIN), expl_thunk::Ex_BTPRED)))
+            return false;
+        } else if(E > c_lst(xi)) {
+          if(!set_absent(xi,
+               ex_thunk(ex<&P::ex_ef>, make_edata(xi, dir, 1, L1, U, L2, E), expl_thunk::Ex_BTPRED)))
+            return false;
+        }
+        tree.remove(pi);
+      }
+      tree.smudge(pos[xj]);
+    }
+    return true;
+  }
+
+  // Detectable precedences: if ect(i) > lst(j), j precedes i.
+  bool prop_dp(int dir, vec<clause_elt>& confl) {
+    snapshot(dir);
+    order.clear();
+    queue.clear();
+    for(int xi : irange(xs.size())) {
+      in_theta[xi] = false;
+      if(c_st[xi] == T_Absent)
+        continue;
+      order.push(xi);
+      if(c_st[xi] == T_Present)
+        queue.push(xi);
+    }
+    std::sort(order.begin(), order.end(),
+      [this](int x, int y) { return c_est[x] + c_du[x] < c_est[y] + c_du[y]; });
+    std::sort(queue.begin(), queue.end(),
+      [this](int x, int y) { return c_lst(x) < c_lst(y); });
+
+    int qi = 0;
+    for(int xi : order) {
+      int T = c_est[xi] + c_du[xi];
+      for(; qi < queue.size() && c_lst(queue[qi]) < T; ++qi) {
+        tree.add(pos[queue[qi]]);
+        in_theta[queue[qi]] = true;
+      }
+      if(in_theta[xi])
+        tree.remove(pos[xi]);
+      int E = tree.root().ect;
+      if(E > est(dir, xi)) {
+        int lo = c_est[perm[tree.binding_task(E)]];
+        if(c_st[xi] == T_Present) {
+          if(!set_est(dir, xi, E,
+               ex_thunk(ex<&P::ex_dp>, make_edata(xi, dir, 0, T, 0, lo, E), expl_thunk::Ex_BTPRED)))
+            return false;
+        } else if(E > c_lst(xi)) {
+          if(!set_absent(xi,
+               ex_thunk(ex<&P::ex_dp>, make_edata(xi, dir, 1, T, 0, lo, E), expl_thunk::Ex_BTPRED)))
+            return false;
+        }
+      }
+      if(in_theta[xi])
+        tree.add(pos[xi]);
+    }
+    return true;
+  }
+
+  // Not-last: if the tasks j with lst(j) < lct(i) must run
+  // past lst(i), i ends by the latest of their lsts.
+  bool prop_nl(int dir, vec<clause_elt>& confl) {
+    snapshot(dir);
+    order.clear();
+    queue.clear();
+    for(int xi : irange(xs.size())) {
+      in_theta[xi] = false;
+      if(c_st[xi] == T_Absent)
+        continue;
+      order.push(xi);
+      if(c_st[xi] == T_Present)
+        queue.push(xi);
+    }
+    std::sort(order.begin(), order.end(),
+      [this](int x, int y) { return c_lct[x] < c_lct[y]; });
+    std::sort(queue.begin(), queue.end(),
+      [this](int x, int y) { return c_lst(x) < c_lst(y); });
+
+    int qi = 0;
+    for(int xi : order) {
+      for(; qi < queue.size() && c_lst(queue[qi]) < c_lct[xi]; ++qi) {
+        tree.add(pos[queue[qi]]);
+        in_theta[queue[qi]] = true;
+      }
+      if(in_theta[xi])
+        tree.remove(pos[xi]);
+      int lst_i = c_lst(xi);
+      if(tree.root().ect > lst_i) {
+        int xj = queue[qi-1] == xi ? queue[qi-2] : queue[qi-1];
+        int B = c_lst(xj);
+        if(B < lct(dir, xi)) {
+          int lo = c_est[perm[tree.binding_task(lst_i+1)]];
+          if(c_st[xi] == T_Present) {
+            if(!set_lct(dir, xi, B,
+                 ex_thunk(ex<&P::ex_nl>, make_edata(xi, dir, 0, lst_i, B, lo, 0), expl_thunk::Ex_BTPRED)))
+              return false;
+          } else if(c_est[xi] + c_du[xi] > B) {
+            if(!set_absent(xi,
+                 ex_thunk(ex<&P::ex_nl>, make_edata(xi, dir, 1, lst_i, B, lo, 0), expl_thunk::Ex_BTPRED)))
+              return false;
+          }
+        }
+      }
+      if(in_theta[xi])
+        tree.add(pos[xi]);
+    }
+    return true;
+  }
+
+  bool propagate(vec<clause_elt>& confl) {
+#ifdef LOG_ALL
+    std::cout << "[[Running disj_var]]" << std::endl;
+#endif
+    for(int dir = 0; dir < 2; ++dir) {
+      if(!prop_ef(dir, confl) || !prop_dp(dir, confl) || !prop_nl(dir, confl))
+        return false;
+    }
+    return true;
+  }
+
+  // Parameters
+  vec<intvar> xs; // Start times
+  vec<intvar> ds; // Durations
+  vec<patom_t> ps; // Presence
+
+  // Bounds as of the start of the current rule
+  vec<int> c_est;
+  vec<int> c_lct;
+  vec<int> c_du;
+  vec<char> c_st;
+
+  // Temporary storage
+  vec<int> perm; // Tree leaves, by est
+  vec<int> pos;
+  vec<int> order;
+  vec<int> queue;
+  vec<bool> in_theta;
+
+  ps_tree<eval_ect> tree;
+
+  // For storing explanation information.
+  vec<ex_data> edata;
+  char edata_saved;
+};
+
 bool disjunctive_int(solver_data* s, vec<intvar>& st, vec<int>& du) {
   // new disjunctive(s, st, du);
   // return true;
@@ -590,9 +985,19 @@ bool disjunctive_int(solver_data* s, vec<intvar>& st, vec<int>& du) {
 }
 
 bool disjunctive_var(solver_data* s, vec<intvar>& st, vec<intvar>& du) {
-  // new disj_var(s, st, du);
-  GEAS_NOT_YET;
-  return false;
+  vec<patom_t> ps(st.size(), at_True);
+  return disjunctive_opt(s, st, du, ps);
+}
+
+bool disjunctive_opt(solver_data* s, vec<intvar>& st, vec<intvar>& du, vec<patom_t>& ps) {
+  if(st.size() < 2) {
+    for(intvar& d : du) {
+      if(!enqueue(*s, d >= 0, reason()))
+        return false;
+    }
+    return true;
+  }
+  return disj_var::post(s, st, du, ps);
 }
 
 }
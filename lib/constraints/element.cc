@@ -1404,9 +1404,9 @@ class elem_var_env : public propagator, public prop_inst<elem_var_env> {
     char* idx_saved;
 
     // When z = c was pruned, what was the data level?
-    int* z_dtrail_pos;
+    persistence::dtrail_pos* z_dtrail_pos;
     // Equiv for idx.
-    int* idx_dtrail_pos;
+    persistence::dtrail_pos* idx_dtrail_pos;
     
     int* z_supp;
     int* idx_supp;
@@ -1661,8 +1661,8 @@ public:
       alloc<char>(dom_sz), // z_saved
       alloc<char>(idx_sz), // idx_saved
 
-      new int[dom_sz], // z_dtrail_pos
-      new int[idx_sz], // idx_dtrail_pos
+      new persistence::dtrail_pos[dom_sz], // z_dtrail_pos
+      new persistence::dtrail_pos[idx_sz], // idx_dtrail_pos
 
       new int[dom_sz], // z_supp
       new int[idx_sz] // idx_supp
@@ -1717,7 +1717,7 @@ public:
   }
 
   inline bool _prop_z(int inst_id) {
-    int dtrail_pos = s->persist.data_trail.size();
+    persistence::dtrail_pos dtrail_pos(s->persist.data_pos());
     instance& i(instances[inst_id]);
 
     if(i.is_fixed) {
@@ -1784,7 +1784,7 @@ public:
   }
 
   inline bool _prop_idx(int inst_id) {
-    int dtrail_pos = s->persist.data_trail.size();
+    persistence::dtrail_pos dtrail_pos(s->persist.data_pos());
     instance& i(instances[inst_id]);
 
     int base = 0;
@@ -1817,7 +1817,7 @@ public:
   }
 
   bool prop_indices(void) {
-    int dtrail_pos = s->persist.data_trail.size();
+    persistence::dtrail_pos dtrail_pos(s->persist.data_pos());
 
     // Only look at the touched values; if z has changed,
     // we will have dealt with it in prop_z.
@@ -1855,7 +1855,7 @@ public:
   }
 
   bool prop_vars(void) {
-    int dtrail_pos = s->persist.data_trail.size();
+    persistence::dtrail_pos dtrail_pos(s->persist.data_pos());
 
     int base = 0;
     for(int b = 0; b < req_words(dom_sz); ++b, base += 64) {
@@ -5,8 +5,10 @@
 #include <geas/vars/intvar.h>
 #include <geas/utils/interval.h>
 #include <geas/mtl/bool-set.h>
+#include <unordered_map>
 
 #include <geas/constraints/flow/flow.h>
+#include <geas/constraints/builtins.h>
 
 // #define LOG_FLOW
 namespace geas {
@@ -502,6 +504,614 @@ bool bipartite_flow(solver_data* s, vec<int>& srcs, vec<int>& sinks, vec<bflow>&
   return true; 
 }
 
+// Global cardinality: sources are the variables, each sending one unit,
+// and sinks are the values, taking between lb(count) and ub(count) units.
+// Values outside the cover get a free sink. The flow is repaired from
+// scratch each call, and arcs (and count bounds) outside the SCCs of
+// the residual graph are pruned.
+class bp_flow_gcc : public propagator, public prop_inst<bp_flow_gcc> {
+  watch_result wake_arc(int fi) {
+    queue_prop();
+    return Wt_Keep;
+  }
+
+  watch_result wake_count(int ci) {
+    queue_prop();
+    return Wt_Keep;
+  }
+
+  // The residual graph has nodes (idx<<1)|is_sink, and the
+  // super-sink T, taking the flow out of every value.
+  inline int t_node(void) const { return (nsinks<<1)|1; }
+
+  inline int sink_lb(int d) {
+    return sink_count[d] < 0 ? 0 : lb(counts[sink_count[d]]);
+  }
+  inline int sink_ub(int d) {
+    return sink_count[d] < 0 ? nsrcs : ub(counts[sink_count[d]]);
+  }
+
+  // Residual arcs: src -> sink, sink -> src, sink -> T, T -> sink.
+  inline bool fwd(int fi) { return !used_flow[fi] && ub(flows[fi].at); }
+  inline bool bwd(int fi) { return used_flow[fi] && !lb(flows[fi].at); }
+  inline bool up(int d) { return sink_flow[d] < sink_ub(d); }
+  inline bool down(int d) { return sink_flow[d] > sink_lb(d); }
+
+  void ex_pos(int fi, pval_t _p, vec<clause_elt>& expl) {
+    mark_reach(flows[fi].src<<1);
+    assert(!sink_seen.elem(flows[fi].sink));
+    make_expl(true, -1, expl);
+  }
+
+  void ex_neg(int fi, pval_t _p, vec<clause_elt>& expl) {
+    mark_reach((flows[fi].sink<<1)|1);
+    assert(!src_seen.elem(flows[fi].src));
+    make_expl(true, -1, expl);
+  }
+
+  // Too few variables can still take the value.
+  void ex_count_ub(int d, pval_t p, vec<clause_elt>& expl) {
+    int k = in_flows[d].size() - counts[sink_count[d]].ub_of_pval(p);
+    for(int fi : in_flows[d]) {
+      if(!k)
+        break;
+      if(!ub(flows[fi].at)) {
+        EX_PUSH(expl, flows[fi].at);
+        --k;
+      }
+    }
+  }
+
+  // Too many variables are fixed to the value.
+  void ex_count_lb(int d, pval_t p, vec<clause_elt>& expl) {
+    int k = counts[sink_count[d]].lb_of_pval(p);
+    for(int fi : in_flows[d]) {
+      if(!k)
+        break;
+      if(lb(flows[fi].at)) {
+        EX_PUSH(expl, ~flows[fi].at);
+        --k;
+      }
+    }
+  }
+
+  inline void mark(int e) {
+    boolset& seen(e&1 ? sink_seen : src_seen);
+    if(!seen.elem(e>>1)) {
+      seen.add(e>>1);
+      queue.push(e);
+    }
+  }
+
+  // Marks the nodes reachable from e in the residual graph.
+  void mark_reach(int e0) {
+    src_seen.clear(); sink_seen.clear();
+    queue.clear();
+    mark(e0);
+    for(int qi = 0; qi < queue.size(); ++qi) {
+      int e = queue[qi];
+      int v = e>>1;
+      if(!(e&1)) {
+        for(int fi : out_flows[v]) {
+          if(fwd(fi))
+            mark((flows[fi].sink<<1)|1);
+        }
+      } else if(v < nsinks) {
+        for(int fi : in_flows[v]) {
+          if(bwd(fi))
+            mark(flows[fi].src<<1);
+        }
+        if(up(v))
+          mark(t_node());
+      } else {
+        for(int d : irange(nsinks)) {
+          if(down(d))
+            mark((d<<1)|1);
+        }
+      }
+    }
+    queue.clear();
+  }
+
+  // Explains why no flow crosses into the node set F, which is
+  // the marked set if closed is set, its complement otherwise:
+  // every residual arc leaving F is blocked by some atom.
+  // The arc between sink skip and T is left out.
+  void make_expl(bool closed, int skip, vec<clause_elt>& expl) {
+    for(int fi : irange(flows.size())) {
+      const bflow& f(flows[fi]);
+      bool in_s = src_seen.elem(f.src) == closed;
+      bool in_d = sink_seen.elem(f.sink) == closed;
+      if(in_s && !in_d && !used_flow[fi])
+        EX_PUSH(expl, f.at);
+      else if(!in_s && in_d && used_flow[fi])
+        EX_PUSH(expl, ~f.at);
+    }
+    bool in_t = sink_seen.elem(nsinks) == closed;
+    for(int d : irange(nsinks)) {
+      int ci = sink_count[d];
+      if(d == skip || ci < 0)
+        continue;
+      const intvar& c(counts[ci]);
+      bool in_d = sink_seen.elem(d) == closed;
+      if(in_d && !in_t) {
+        if(ub(c) < ub_0(c))
+          EX_PUSH(expl, c > ub(c));
+      } else if(!in_d && in_t) {
+        if(lb(c) > lb_0(c))
+          EX_PUSH(expl, c < lb(c));
+      }
+    }
+  }
+
+  inline void unassign(int si) {
+    int fi = src_flow[si];
+    used_flow[fi] = false;
+    sink_flow[flows[fi].sink]--;
+    src_flow[si] = -1;
+  }
+
+  inline void assign(int fi) {
+    used_flow[fi] = true;
+    sink_flow[flows[fi].sink]++;
+    src_flow[flows[fi].src] = fi;
+  }
+
+  // Finds an augmenting path from the unassigned source si to
+  // some sink below capacity, and flips it.
+  bool augment_src(int si) {
+    src_seen.clear(); sink_seen.clear();
+    queue.clear();
+    src_seen.add(si);
+    queue.push(si);
+    for(int qi = 0; qi < queue.size(); ++qi) {
+      for(int fi : out_flows[queue[qi]]) {
+        int d = flows[fi].sink;
+        if(!fwd(fi) || sink_seen.elem(d))
+          continue;
+        sink_seen.add(d);
+        sink_pred[d] = fi;
+        if(up(d)) {
+          // Shift each source on the path onto its predecessor arc.
+          while(true) {
+            int s = flows[fi].src;
+            int fj = src_flow[s];
+            used_flow[fi] = true;
+            src_flow[s] = fi;
+            if(s == si)
+              break;
+            used_flow[fj] = false;
+            fi = sink_pred[flows[src_pred[s]].sink];
+          }
+          sink_flow[d]++;
+          return true;
+        }
+        for(int fj : in_flows[d]) {
+          int s = flows[fj].src;
+          if(!bwd(fj) || src_seen.elem(s))
+            continue;
+          src_seen.add(s);
+          src_pred[s] = fj;
+          queue.push(s);
+        }
+      }
+    }
+    return false;
+  }
+
+  // Finds a path into sink d0, from either an unassigned source or
+  // a sink above its lower bound, and flips it.
+  bool supply_sink(int d0) {
+    src_seen.clear(); sink_seen.clear();
+    queue.clear();
+    sink_seen.add(d0);
+    queue.push(d0);
+    for(int qi = 0; qi < queue.size(); ++qi) {
+      for(int fi : in_flows[queue[qi]]) {
+        int s = flows[fi].src;
+        if(!fwd(fi) || src_seen.elem(s))
+          continue;
+        src_seen.add(s);
+        src_pred[s] = fi;
+        int fj = src_flow[s];
+        if(fj >= 0) {
+          int d = flows[fj].sink;
+          if(lb(flows[fj].at) || sink_seen.elem(d))
+            continue;
+          sink_seen.add(d);
+          if(!down(d)) {
+            sink_pred[d] = s;
+            queue.push(d);
+            continue;
+          }
+        }
+        // Move each source on the path onto its predecessor arc.
+        while(true) {
+          if(src_flow[s] >= 0)
+            unassign(s);
+          assign(src_pred[s]);
+          int d = flows[src_pred[s]].sink;
+          if(d == d0)
+            break;
+          s = sink_pred[d];
+        }
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void save_flow(void) {
+    saved_flow.clear();
+    for(int fi : src_flow)
+      saved_flow.push(fi);
+  }
+
+  void restore_flow(void) {
+    for(int si : irange(nsrcs)) {
+      if(src_flow[si] >= 0)
+        unassign(si);
+    }
+    for(int fi : saved_flow) {
+      if(fi >= 0)
+        assign(fi);
+    }
+  }
+
+  // Brings the flow back in line with the current domains.
+  bool repair(vec<clause_elt>& confl) {
+    for(int fi : irange(flows.size())) {
+      if(used_flow[fi] && !ub(flows[fi].at))
+        unassign(flows[fi].src);
+    }
+    for(int fi : irange(flows.size())) {
+      if(!used_flow[fi] && lb(flows[fi].at)) {
+        if(src_flow[flows[fi].src] >= 0)
+          unassign(flows[fi].src);
+        assign(fi);
+      }
+    }
+    for(int d : irange(nsinks)) {
+      if(sink_flow[d] <= sink_ub(d))
+        continue;
+      for(int fi : in_flows[d]) {
+        if(bwd(fi)) {
+          unassign(flows[fi].src);
+          if(sink_flow[d] <= sink_ub(d))
+            break;
+        }
+      }
+      if(sink_flow[d] > sink_ub(d)) {
+        // Too many variables are fixed to the value.
+        const intvar& c(counts[sink_count[d]]);
+        if(ub(c) < ub_0(c))
+          EX_PUSH(confl, c > ub(c));
+        int k = ub(c) + 1;
+        for(int fi : in_flows[d]) {
+          if(k <= 0)
+            break;
+          if(used_flow[fi]) {
+            EX_PUSH(confl, ~flows[fi].at);
+            --k;
+          }
+        }
+        return false;
+      }
+    }
+    for(int d : irange(nsinks)) {
+      while(sink_flow[d] < sink_lb(d)) {
+        if(!supply_sink(d)) {
+          make_expl(false, -1, confl);
+          return false;
+        }
+      }
+    }
+    for(int si : irange(nsrcs)) {
+      if(src_flow[si] < 0 && !augment_src(si)) {
+        make_expl(true, -1, confl);
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void visit(int e, int d) {
+    if(!index.elem(d)) {
+      strongconnect(d);
+      lowlink[e] = std::min(lowlink[e], lowlink[d]);
+    } else if(queued[d]) {
+      lowlink[e] = std::min(lowlink[e], (int) index.pos(d));
+    }
+  }
+
+  // Tarjan's algorithm, as in bp_flow_int, plus T.
+  void strongconnect(int e) {
+    int v = e>>1;
+    index.insert(e);
+    lowlink[e] = index.pos(e);
+    queue.push(e);
+    queued[e] = true;
+
+    if(!(e&1)) {
+      for(int fi : out_flows[v]) {
+        if(fwd(fi))
+          visit(e, (flows[fi].sink<<1)|1);
+      }
+    } else if(v < nsinks) {
+      for(int fi : in_flows[v]) {
+        if(bwd(fi))
+          visit(e, flows[fi].src<<1);
+      }
+      if(up(v))
+        visit(e, t_node());
+    } else {
+      for(int d : irange(nsinks)) {
+        if(down(d))
+          visit(e, (d<<1)|1);
+      }
+    }
+    if(lowlink[e] == (int) index.pos(e)) {
+      int w;
+      do {
+        w = queue.last();
+        queue.pop();
+        queued[w] = false;
+        sccs[w] = e;
+      } while(w != e);
+    }
+  }
+
+  void compute_sccs(void) {
+    index.clear();
+    queue.clear();
+    for(int ii : irange(nsrcs)) {
+      if(!index.elem(ii<<1))
+        strongconnect(ii<<1);
+    }
+    for(int ii : irange(nsinks+1)) {
+      if(!index.elem((ii<<1)|1))
+        strongconnect((ii<<1)|1);
+    }
+  }
+
+  bool prop_counts(void) {
+    for(int d : irange(nsinks)) {
+      int ci = sink_count[d];
+      if(ci < 0)
+        continue;
+      int poss = 0;
+      int fixed = 0;
+      for(int fi : in_flows[d]) {
+        poss += ub(flows[fi].at);
+        fixed += lb(flows[fi].at);
+      }
+      intvar& c(counts[ci]);
+      if(poss < ub(c)) {
+        if(!set_ub(c, poss, ex_thunk(ex<&P::ex_count_ub>, d, expl_thunk::Ex_BTPRED)))
+          return false;
+      }
+      if(fixed > lb(c)) {
+        if(!set_lb(c, fixed, ex_thunk(ex<&P::ex_count_lb>, d, expl_thunk::Ex_BTPRED)))
+          return false;
+      }
+    }
+    return true;
+  }
+
+  clause* eager_expl(int skip) {
+    ex_buf.clear();
+    make_expl(true, skip, ex_buf);
+    expl_builder e(s->persist.alloc_expl(1 + ex_buf.size()));
+    for(clause_elt& el : ex_buf)
+      e.push(el);
+    return *e;
+  }
+
+  bool process_sccs(void) {
+    for(int fi : irange(flows.size())) {
+      bflow& f(flows[fi]);
+      if(sccs[f.src<<1] != sccs[(f.sink<<1)|1]) {
+        if(used_flow[fi] && !lb(f.at)) {
+          if(!enqueue(*s, f.at,
+              ex_thunk(ex<&P::ex_pos>, fi, expl_thunk::Ex_BTPRED)))
+            return false;
+        } else if(!used_flow[fi] && ub(f.at)) {
+          if(!enqueue(*s, ~f.at,
+              ex_thunk(ex<&P::ex_neg>, fi, expl_thunk::Ex_BTPRED)))
+            return false;
+        }
+      }
+    }
+    // If the arc between a value and T lies on no cycle,
+    // the count is stuck at the current flow.
+    for(int d : irange(nsinks)) {
+      int ci = sink_count[d];
+      if(ci < 0 || sccs[(d<<1)|1] == sccs[t_node()])
+        continue;
+      intvar& c(counts[ci]);
+      if(sink_flow[d] < ub(c)) {
+        mark_reach(t_node());
+        if(!set_ub(c, sink_flow[d], eager_expl(d)))
+          return false;
+      }
+      if(sink_flow[d] > lb(c)) {
+        mark_reach((d<<1)|1);
+        if(!set_lb(c, sink_flow[d], eager_expl(d)))
+          return false;
+      }
+    }
+    return true;
+  }
+
+public:
+  bp_flow_gcc(solver_data* s, vec<intvar>& xs,
+    vec<int>& cover, vec<intvar>& _counts)
+    : propagator(s, PRIO_LOW), counts(_counts)
+    , nsrcs(xs.size()), nsinks(0) {
+    std::unordered_map<int, int> sink_of;
+    for(int ci : irange(cover.size())) {
+      sink_of.insert(std::make_pair(cover[ci], nsinks++));
+      sink_count.push(ci);
+    }
+    for(int si : irange(nsrcs)) {
+      intvar x(xs[si]);
+      make_eager(x);
+      out_flows.push();
+      src_pred.push(0);
+      src_flow.push(-1);
+      for(int k : x.domain(s->ctx())) {
+        if(!x.in_domain(s->ctx(), k))
+          continue;
+        auto it = sink_of.find(k);
+        if(it == sink_of.end()) {
+          it = sink_of.insert(std::make_pair(k, nsinks++)).first;
+          sink_count.push(-1);
+        }
+        int fi = flows.size();
+        flows.push(bflow { si, it->second, x == k });
+        used_flow.push(false);
+        out_flows[si].push(fi);
+      }
+    }
+    in_flows.growTo(nsinks);
+    sink_pred.growTo(nsinks, 0);
+    sink_flow.growTo(nsinks, 0);
+    for(int fi : irange(flows.size())) {
+      in_flows[flows[fi].sink].push(fi);
+      attach(s, flows[fi].at, watch<&P::wake_arc>(fi, Wt_IDEM));
+      attach(s, ~flows[fi].at, watch<&P::wake_arc>(fi, Wt_IDEM));
+    }
+    for(int ci : irange(counts.size()))
+      counts[ci].attach(E_LU, watch<&P::wake_count>(ci, Wt_IDEM));
+
+    src_seen.growTo(nsrcs);
+    sink_seen.growTo(nsinks+1);
+    int n_nodes = 2 * std::max(nsrcs, nsinks+1);
+    sccs.growTo(n_nodes, 0);
+    lowlink.growTo(n_nodes, 0);
+    index.growTo(n_nodes);
+    queued.growTo(n_nodes, false);
+
+    // If there is no feasible flow, the first
+    // call to propagate reports the failure.
+    repair(ex_buf);
+    ex_buf.clear();
+    queue_prop();
+  }
+
+  bool propagate(vec<clause_elt>& confl) {
+    save_flow();
+    if(!repair(confl)) {
+      // Explanations are computed from the current flow, which
+      // must stay feasible for the states they are asked about.
+      restore_flow();
+      return false;
+    }
+    if(!prop_counts())
+      return false;
+    compute_sccs();
+    return process_sccs();
+  }
+
+  void cleanup(void) {
+    is_queued = false;
+    src_seen.clear();
+    sink_seen.clear();
+    queue.clear();
+  }
+
+  // Exhaustive search, for checking explanations.
+  bool check_sat(ctx_t& ctx) {
+    vec<int> occ(nsinks, 0);
+    return check_rec(ctx, 0, occ);
+  }
+  bool check_unsat(ctx_t& ctx) { return !check_sat(ctx); }
+
+  bool check_rec(ctx_t& ctx, int si, vec<int>& occ) {
+    if(si == nsrcs) {
+      for(int d : irange(nsinks)) {
+        if(sink_count[d] < 0)
+          continue;
+        const intvar& c(counts[sink_count[d]]);
+        if(occ[d] < c.lb(ctx) || occ[d] > c.ub(ctx))
+          return false;
+      }
+      return true;
+    }
+    for(int fi : out_flows[si]) {
+      const bflow& f(flows[fi]);
+      if(ctx[(~f.at).pid] >= (~f.at).val)
+        continue;
+      if(sink_count[f.sink] >= 0 && occ[f.sink] >= counts[sink_count[f.sink]].ub(ctx))
+        continue;
+      bool ok = true;
+      for(int fj : out_flows[si]) {
+        if(fj != fi && ctx[flows[fj].at.pid] >= flows[fj].at.val)
+          ok = false;
+      }
+      if(!ok)
+        continue;
+      occ[f.sink]++;
+      if(check_rec(ctx, si+1, occ))
+        return true;
+      occ[f.sink]--;
+    }
+    return false;
+  }
+
+  // Flow definitions.
+  vec< vec<int> > out_flows;
+  vec< vec<int> > in_flows;
+  vec<bflow> flows;
+  vec<intvar> counts;
+  // Index of each sink's count, or -1 if free.
+  vec<int> sink_count;
+  int nsrcs;
+  int nsinks;
+
+  // Persistent state: the current flow.
+  vec<bool> used_flow;
+  vec<int> src_flow;
+  vec<int> sink_flow;
+  vec<int> saved_flow;
+
+  // Bookkeeping for repair and explanation
+  boolset src_seen;
+  boolset sink_seen;
+  vec<int> src_pred;
+  vec<int> sink_pred;
+  vec<clause_elt> ex_buf;
+
+  // Bookkeeping for propagation
+  vec<int> sccs;
+  vec<int> lowlink;
+  p_sparseset index;
+  vec<bool> queued;
+
+  vec<int> queue;
+};
+
+bool global_cardinality(solver_data* s, vec<intvar>& xs, vec<int>& cover, vec<intvar>& counts) {
+  // Repeated values must have equal counts.
+  vec<int> vals;
+  vec<intvar> cs;
+  for(int ii : irange(cover.size())) {
+    int jj = 0;
+    for(; jj < vals.size(); ++jj) {
+      if(vals[jj] == cover[ii])
+        break;
+    }
+    if(jj < vals.size()) {
+      if(!int_eq(s, cs[jj], counts[ii]))
+        return false;
+    } else {
+      vals.push(cover[ii]);
+      cs.push(counts[ii]);
+    }
+  }
+  return bp_flow_gcc::post(s, xs, vals, cs);
+}
+
 #if 0
 struct arc_t {
   int src;
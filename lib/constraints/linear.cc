@@ -366,6 +366,8 @@ class lin_le_inc : public propagator, public prop_inst<lin_le_inc> {
       {
         // Normalize to remove any redundant/aliased terms.
         k = normalize_linex(s, ks, vs, k, xs);
+        // Fixed terms may have been folded into k.
+        slack.x = k;
         for(int ii = 0; ii < xs.size(); ++ii) {
           xs[ii].x.attach(E_LB, watch<&P::wake_x>(ii, Wt_IDEM));
         }
@@ -592,14 +594,18 @@ class lin_le_mtree : public propagator, public prop_inst<lin_le_mtree<V, R> > {
     return Wt_Keep;
   }
 
-  watch_result wake_x(int xi) {
-    // Update slack.
-    set(slack, slack - delta(xi));
-    if(mt.root_val() < -slack) {
-      if(lb(r) || slack < 0)
-        queue_prop();
+  // Lower bounds are delivered in batches, so a large sum
+  // pays for one slack update per round rather than per term.
+  static void wake_xs(void* ptr, vec<int>& changed) {
+    P* p(static_cast<P*>(ptr));
+    V d(0);
+    for(int xi : changed)
+      d += p->delta(xi);
+    p->set(p->slack, p->slack - d);
+    if(p->mt.root_val() < -p->slack) {
+      if(p->lb(p->r) || p->slack < 0)
+        p->queue_prop();
     }
-    return Wt_Keep;
   }
 
   // Explain why sum (i != skip) (c_i x_i) > cap.
@@ -664,7 +670,8 @@ class lin_le_mtree : public propagator, public prop_inst<lin_le_mtree<V, R> > {
 
 public:
   lin_le_mtree(solver_data* s, patom_t _r, vec<V>& cs, vec<R>& vs, V _k)
-    : propagator(s), r(_r), xs(), k(_k), mt(s, MaxEnv {this}, 0), slack(k) {
+    : propagator(s), r(_r), xs(), k(_k), mt(s, MaxEnv {this}, 0), slack(k),
+      changes(wake_xs, this, s->batch_queue, true) {
     // Normalize coefficients as usual.
     for(int ii : irange(vs.size())) {
       V c(cs[ii]);
@@ -679,7 +686,7 @@ public:
         k -= c * v_p;
         v -= v_p;
       }
-      v.attach(E_LB, this->template watch<&P::wake_x>(xs.size(), P::Wt_IDEM));
+      v.attach_batch(E_LB, changes, xs.size());
       xs.push(term { c, v });
     }
     set(slack, k);
@@ -730,6 +737,7 @@ public:
   // just forall_lt.
   weak_min_tree<V, MaxEnv> mt;
   Tint slack;
+  batch_set changes;
 };
 
 class int_linear_ne : public propagator, public prop_inst<int_linear_ne> {
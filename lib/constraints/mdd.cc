@@ -2,7 +2,12 @@
 #include <geas/utils/MurmurHash3.h>
 #include <geas/solver/solver.h>
 #include <geas/solver/solver_ext.h>
+#include <geas/engine/propagator.h>
+#include <geas/engine/propagator_ext.h>
 #include <geas/constraints/mdd.h>
+#include <geas/mtl/bool-set.h>
+
+using namespace btset;
 
 namespace geas {
   namespace mdd {
@@ -16,6 +21,8 @@ public:
   }
    
   mdd_id build(vec< vec<int> >& tuples);
+  mdd_id build_dfa(int arity, int num_states, int num_syms,
+                   const vec<int>& trans, int start, const vec<int>& accepts);
   mdd_info& lookup(mdd_id r) { return *(mdds[r]); }
 protected:
   vec<mdd_info*> mdds;
@@ -43,9 +50,9 @@ struct mddfier {
     edge* end(void) const { return p + size; }
   };
 
-  mddfier(vec<vec<int> >& _tuples)
-    : tuples(_tuples) {
-    for(int xi = 0; xi < tuples[0].size(); ++xi)
+  mddfier(int arity)
+    : tuples(nullptr) {
+    for(int xi = 0; xi < arity; ++xi)
       levels.push();
   }
 
@@ -91,28 +98,29 @@ struct mddfier {
   }
 
   node_id build_node(int level, int* pb, int* pe) {
+    vec< vec<int> >& ts(*tuples);
     // First, we sort the permutation by tuple-value.
-    std::sort(pb, pe, [this, level](int i, int j) { return tuples[i][level] < tuples[j][level]; });
+    std::sort(pb, pe, [&ts, level](int i, int j) { return ts[i][level] < ts[j][level]; });
     vec<edge> children;
-    if(level == tuples[0].size() - 1) {
+    if(level == ts[0].size() - 1) {
       // Last level. Just add the (unique) edges directly
-      int v = tuples[*pb][level];
+      int v = ts[*pb][level];
       children.push(edge { v, 0 });
       for(++pb; pb != pe; ++pb) {
-        if(tuples[*pb][level] == v)
+        if(ts[*pb][level] == v)
           continue;
-        v = tuples[*pb][level];
+        v = ts[*pb][level];
         children.push(edge { v, 0 });
       }
     } else {
       // Shouldn't be any duplicates at other levels, because
       // we're bundling them together at the recursive call.
       while(pb != pe) {
-        int v(tuples[*pb][level]);
+        int v(ts[*pb][level]);
         // Collect the range corresponding to this value
         int* pm(pb);
         for(++pm; pm != pe; ++pm) {
-          if(v < tuples[*pm][level])
+          if(v < ts[*pm][level])
             break;
         }
         children.push(edge { v, build_node(level+1, pb, pm) });
@@ -129,15 +137,68 @@ struct mddfier {
     node_id dest;
   };
 
-  mdd_info* operator()(void) {
-    vec<int> perm(tuples.size(), 0);
+  mdd_info* of_tuples(vec< vec<int> >& _tuples) {
+    tuples = &_tuples;
+    vec<int> perm(_tuples.size(), 0);
     for(int ii = 0; ii < perm.size(); ++ii)
       perm[ii] = ii;
 
     // Should only be one root.
     node_id r(build_node(0, perm.begin(), perm.end()));
     assert(r == 0);
+    return finish();
+  }
+
+  // Unfolds a DFA (states 1..num_states, 0 failing) over
+  // levels.size() steps. Nodes are built bottom-up, so states
+  // with the same residual language share a node. Returns
+  // nullptr if no string of that length is accepted.
+  mdd_info* of_dfa(int num_states, int num_syms, const vec<int>& trans,
+                   int start, const vec<int>& accepts) {
+    int L = levels.size();
+    // Which states are reachable at each level.
+    vec< vec<bool> > reach(L);
+    reach[0].growTo(num_states+1, false);
+    reach[0][start] = true;
+    for(int l = 1; l < L; ++l) {
+      reach[l].growTo(num_states+1, false);
+      for(int q = 1; q <= num_states; ++q) {
+        if(!reach[l-1][q])
+          continue;
+        for(int c = 0; c < num_syms; ++c)
+          reach[l][trans[(q-1)*num_syms + c]] = true;
+      }
+    }
+
+    // below[q]: node for state q at the next level; -1 if dead.
+    vec<int> below(num_states+1, -1);
+    vec<int> here(num_states+1, -1);
+    for(int q : accepts)
+      below[q] = 0;
+    vec<edge> children;
+    for(int l = L-1; l >= 0; --l) {
+      for(int q = 1; q <= num_states; ++q) {
+        here[q] = -1;
+        if(!reach[l][q])
+          continue;
+        children.clear();
+        for(int c = 0; c < num_syms; ++c) {
+          int d = trans[(q-1)*num_syms + c];
+          if(d > 0 && below[d] >= 0)
+            children.push(edge { c+1, (node_id) below[d] });
+        }
+        if(children.size() > 0)
+          here[q] = get_node(l, children);
+      }
+      here.copyTo(below);
+    }
+    if(below[start] < 0)
+      return nullptr;
+    assert(below[start] == 0);
+    return finish();
+  }
 
+  mdd_info* finish(void) {
     // Now build the mdd_info.
     mdd_info* m(new mdd_info());
     for(int ii = 0; ii < levels.size(); ++ii) {
@@ -153,6 +214,8 @@ struct mddfier {
       m->val_support.push();
 
       m->edge_value_id.push();
+      m->edge_src.push();
+      m->edge_dest.push();
     }
     m->edge_TL.push();
     // True terminal
@@ -161,7 +224,7 @@ struct mddfier {
     // Allocate bit-vectors
     for(int ii = 0; ii < levels.size(); ++ii) {
       vec<key>& level(levels[ii]);  
-      int ei = 0;
+      unsigned int ei = 0;
       vec< vec<int> > hd_supports(m->num_nodes[ii]);
       vec< vec<int> > tl_supports(m->num_nodes[ii+1]);
       vec< vec<int> > val_supports;
@@ -193,6 +256,8 @@ struct mddfier {
           tl_supports[flat[*b].dest].push(ei);
           val_supports[v_id].push(ei);
           m->edge_value_id[ii].push(v_id);
+          m->edge_src[ii].push(flat[*b].node);
+          m->edge_dest[ii].push(flat[*b].dest);
           ++ei;
         }
       }
@@ -213,7 +278,7 @@ struct mddfier {
   }
 
   vec<int> tuple_perm;
-  vec< vec<int> >& tuples;
+  vec< vec<int> >* tuples;
 
   vec< vec<key> > levels;
 
@@ -223,107 +288,271 @@ struct mddfier {
 mdd_id mdd_manager::build(vec< vec<int> >& tuples) {
   mdd_id mi(mdds.size());
 
-  mddfier mddfy(tuples);
+  mddfier mddfy(tuples[0].size());
 
   /*
   mddfier::node_id n_id(mddfy()); 
   fprintf(stderr, "node id: %d\n", n_id);
 
   */
-  mdd_info* m(mddfy());
+  mdd_info* m(mddfy.of_tuples(tuples));
   mdds.push(m);
           
   return mi;
 }
 
-mdd_id of_tuples(solver_data* s, vec< vec<int> >& tuples) {
-  return mdd_manager::get(s)->build(tuples);
-}
-mdd_info& lookup(solver_data* s, mdd_id m) {
-  return mdd_manager::get(s)->lookup(m);
+mdd_id mdd_manager::build_dfa(int arity, int num_states, int num_syms,
+                              const vec<int>& trans, int start, const vec<int>& accepts) {
+  mddfier mddfy(arity);
+  mdd_info* m(mddfy.of_dfa(num_states, num_syms, trans, start, accepts));
+  if(!m)
+    return -1;
+  mdd_id mi(mdds.size());
+  mdds.push(m);
+  return mi;
 }
 
+// Membership of xs in an MDD. The live edges of each level are
+// kept as a trailed bitset. Removing a value kills its edges;
+// a node left with no live incoming (or outgoing) edges kills
+// its outgoing (or incoming) edges in turn, so only the levels
+// touched by removals are revisited. A value with no live edges
+// left is pruned.
+class mdd_prop : public propagator, public prop_inst<mdd_prop> {
+  struct edge_ref {
+    int level;
+    int e;
+  };
 
+  watch_result wakeup(int vi) {
+    int l(val_level[vi]);
+    unsigned int k(vi - vals_start[l]);
+    if(live_vals[l].elem(k)) {
+      trail_push(s->persist, live_vals[l].sz);
+      live_vals[l].remove(k);
+      kill_value(vi);
+      pending.push(vi);
+      queue_prop();
+    }
+    return Wt_Keep;
   }
-}
-#if 0
-// Assumes there are no skipped levels.
-struct val_info {
-  unsigned int var;
-  int val;
-};
 
-struct mdd_info {
-  size_t arity;
-  size_t num_edges;
-
-  vec< vec<int> > domains;
-  vec< vec<support_set> > val_supports;
-
-  vec< val_info > val_index;
-};
-
-using btset = btset::bitset;
-using namespace bitset;
+  void kill_value(int vi) {
+    trail_push(s->persist, dead_vals.sz);
+    dead_pos[vi] = dead_vals.size();
+    dead_vals.insert(vi);
+  }
 
-namespace geas {
+  // Remove the edges es from level l, queueing any which were live.
+  void kill_edges(int l, const support_set& es) {
+    p_sparse_bitset& live(live_edges[l]);
+    for(support_set::elem_ty e : es) {
+      if(!live.idx.elem(e.w))
+        continue;
+      word_ty rem(live[e.w] & e.bits);
+      if(!rem)
+        continue;
+      trail_change(s->persist, live[e.w], live[e.w] & ~e.bits);
+      if(!live[e.w]) {
+        trail_push(s->persist, live.idx.sz);
+        live.idx.remove(e.w);
+      }
+      touched.add(l);
+      for(; rem; rem &= rem-1)
+        edge_q.push(edge_ref { l, (int) (e.w * word_bits() + __builtin_ctzll(rem)) });
+    }
+  }
 
-class mdd_prop : public propagator, public prop_inst<mdd_prop> {
-  // Parameters
-  mdd_info& mdd;
-  vec<intvar> xs;
-  
-  // Persistent state. Live edges and surviving values.
-  btset live_edges;
+  bool has_support(int l, unsigned int k) {
+    p_sparse_bitset& live(live_edges[l]);
+    int vi(vals_start[l] + k);
+    const support_set& ss(m.val_support[l][k]);
+    support_set::elem_ty r(ss[residual[vi]]);
+    if(live.idx.elem(r.w) && (live[r.w] & r.bits))
+      return true;
+    for(unsigned int ii = 0; ii < ss.size(); ++ii) {
+      if(live.idx.elem(ss[ii].w) && (live[ss[ii].w] & ss[ii].bits)) {
+        residual[vi] = ii;
+        return true;
+      }
+    }
+    return false;
+  }
 
-  vec<p_sparseset> live_vals;
+  // Values dead before dead_idx are unavailable; at level l0,
+  // only k0 is considered.
+  void mk_expl(unsigned int dead_idx, int l0, int k0, vec<clause_elt>& expl) {
+    mdd::mark_forbidden(m, ex_space, [&](int l, int k) {
+        if(l == l0)
+          return k == k0;
+        return dead_vals.pos(vals_start[l] + k) >= dead_idx;
+      });
+    mdd::retrieve_expln(m, ex_space, [&](int l, int k) {
+        if(l != l0)
+          xs[l].explain_neq(m.values[l][k], expl);
+      });
+  }
 
-  p_sparseset killed_vals;
+  void ex_val(int vi, pval_t _p, vec<clause_elt>& expl) {
+    int l(val_level[vi]);
+    mk_expl(dead_pos[vi], l, vi - vals_start[l], expl);
+  }
 
-  static watch_result wake(void* ptr, int xi) {
-    mdd_prop* p(static_cast<mdd_prop*>(ptr));
-    p->changes.add(xi);
-    p->queue_prop();
-    return Wt_Keep;
+  void ex_fail(vec<clause_elt>& expl) {
+    mk_expl(dead_vals.size(), -1, -1, expl);
   }
 
-  public: 
-    struct valpair { int var; intvar::val_t val; };
-
-    mdd_prop(solver_data* s, mdd& _m, vec<intvar>& _vs)
-      : propagator(s), vs(_vs) {
-      
-      int idx = 0;
-      for(int ii : num_range(vs.size())) {
-        intvar v(vs[ii]);
-        for(intvar::val_t k : v.domain(s)) {
-          attach(s, v != k, watch_callback(wake, this, idx));
-          valpairs.push( valpair {ii, k} );
-          idx++;
+public:
+  mdd_prop(solver_data* s, mdd_id _m, vec<intvar>& _xs)
+    : propagator(s), m(lookup(s, _m)), xs(_xs)
+    , dead_vals(0)
+    , touched(xs.size()) {
+    assert(xs.size() == m.values.size());
+    ex_space.reserve(m);
+
+    int num_vals = 0;
+    for(int l = 0; l < xs.size(); ++l) {
+      vals_start.push(num_vals);
+      num_vals += m.values[l].size();
+    }
+    dead_vals.growTo(num_vals);
+    dead_pos.growTo(num_vals, 0);
+    residual.growTo(num_vals, 0);
+
+    for(int l = 0; l < xs.size(); ++l) {
+      live_edges.push(p_sparse_bitset(m.num_edges[l]));
+      live_edges[l].fill(m.num_edges[l]);
+      live_vals.push(p_sparseset(m.values[l].size()));
+
+      make_sparse(xs[l], m.values[l]);
+      for(int k = 0; k < m.values[l].size(); ++k) {
+        int vi(vals_start[l] + k);
+        patom_t at(xs[l] != m.values[l][k]);
+        val_atoms.push(at);
+        val_level.push(l);
+        if(in_domain(xs[l], m.values[l][k])) {
+          attach(s, at, watch<&P::wakeup>(vi));
+          live_vals[l].insert(k);
+        } else {
+          kill_value(vi);
+          pending.push(vi);
         }
       }
     }
+    queue_prop();
+  }
 
-    void root_simplify(void) {
-      
+  bool check_unsat(ctx_t& ctx) { return !check_sat(ctx); }
+  bool check_sat(ctx_t& ctx) {
+    vec<char> reached(1, 1);
+    for(int l = 0; l < xs.size(); ++l) {
+      vec<char> next(m.num_nodes[l+1], 0);
+      for(unsigned int e = 0; e < m.num_edges[l]; ++e) {
+        if(reached[m.edge_src[l][e]]
+           && xs[l].in_domain_exhaustive(ctx, m.values[l][m.edge_value_id[l][e]]))
+          next[m.edge_dest[l][e]] = 1;
+      }
+      next.moveTo(reached);
     }
-    
-    bool propagate(vec<clause_elt>& confl) {
-#ifdef LOG_ALL
-      std::cout << "[[Running mdd]]" << std::endl;
-#endif
+    return reached[0];
+  }
 
-      return true;
+  bool propagate(vec<clause_elt>& confl) {
+    for(int vi : pending) {
+      int l(val_level[vi]);
+      kill_edges(l, m.val_support[l][vi - vals_start[l]]);
+    }
+    pending.clear();
+
+    int L(xs.size());
+    while(edge_q.size() > 0) {
+      edge_ref r(edge_q.last());
+      edge_q.pop();
+      int l(r.level);
+      if(l > 0) {
+        int n(m.edge_src[l][r.e]);
+        if(!live_edges[l].has_intersection(m.edge_HD[l][n]))
+          kill_edges(l-1, m.edge_TL[l][n]);
+      }
+      if(l+1 < L) {
+        int n(m.edge_dest[l][r.e]);
+        if(!live_edges[l].has_intersection(m.edge_TL[l+1][n]))
+          kill_edges(l+1, m.edge_HD[l+1][n]);
+      }
+    }
+    if(live_edges[0].is_empty()) {
+      touched.clear();
+      ex_fail(confl);
+      return false;
+    }
+
+    for(int l : touched) {
+      unsigned int sz(live_vals[l].size());
+      for(unsigned int k : live_vals[l].rev()) {
+        if(has_support(l, k))
+          continue;
+        if(live_vals[l].size() == sz)
+          trail_push(s->persist, live_vals[l].sz);
+        live_vals[l].remove(k);
+        int vi(vals_start[l] + k);
+        kill_value(vi);
+        if(!enqueue(*s, val_atoms[vi], expl<&P::ex_val>(vi))) {
+          touched.clear();
+          return false;
+        }
+      }
     }
+    touched.clear();
+    return true;
+  }
+
+  void cleanup(void) {
+    is_queued = false;
+    pending.clear();
+    edge_q.clear();
+    touched.clear();
+  }
 
-    // Persistent information
-    vec<valpair> valpairs;
-    vec<intvar> vs;
+protected:
+  mdd_info& m;
+  vec<intvar> xs;
+  vec<patom_t> val_atoms;
+  vec<int> val_level;
+  vec<int> vals_start;
 
-    // Transient data
-    boolset changes;
+  // Persistent state
+  vec<p_sparse_bitset> live_edges;
+  vec<p_sparseset> live_vals;
+  vec<unsigned int> residual;
+
+  // Values in the order they were killed, for explanations.
+  p_sparseset dead_vals;
+  vec<int> dead_pos;
+
+  // Transient data
+  vec<int> pending;
+  vec<edge_ref> edge_q;
+  boolset touched;
+
+  mdd::expl_space ex_space;
 };
 
+mdd_id of_tuples(solver_data* s, vec< vec<int> >& tuples) {
+  return mdd_manager::get(s)->build(tuples);
+}
+mdd_id of_dfa(solver_data* s, int arity, int num_states, int num_syms,
+             const vec<int>& trans, int start, const vec<int>& accepts) {
+  return mdd_manager::get(s)->build_dfa(arity, num_states, num_syms, trans, start, accepts);
+}
+
+mdd_info& lookup(solver_data* s, mdd_id m) {
+  return mdd_manager::get(s)->lookup(m);
 }
 
-#endif
+bool post(solver_data* s, mdd_id m, vec<intvar>& xs) {
+  return mdd_prop::post(s, m, xs);
+}
+
+
+  }
+}
@@ -0,0 +1,114 @@
+//======== Regular constraints, by unfolding into an MDD ============
+// DFAs are hash-consed by a per-solver manager, and each is unfolded
+// at most once per sequence length.
+#include <algorithm>
+#include <unordered_map>
+#include <geas/utils/MurmurHash3.h>
+#include <geas/solver/solver_data.h>
+#include <geas/solver/solver_ext.h>
+#include <geas/constraints/builtins.h>
+#include <geas/constraints/mdd.h>
+
+using namespace geas;
+
+class regular_manager : public solver_ext<regular_manager> {
+  struct entry {
+    regular::dfa d;
+    // Sequence length -> unfolded MDD (-1 if empty).
+    std::unordered_map<int, mdd::mdd_id> unfolded;
+  };
+public:
+  regular_manager(solver_data* _s) : s(_s) { }
+  ~regular_manager(void) {
+    for(entry* e : dfas)
+      delete e;
+  }
+
+  regular_id build(const regular::dfa& d);
+  mdd::mdd_id unfold(regular_id r, int length);
+  const regular::dfa& lookup(regular_id r) const { return dfas[r]->d; }
+protected:
+  static uint32_t hash(const regular::dfa& d) {
+    uint32_t h;
+    MurmurHash3_x86_32(d.trans.begin(), d.trans.size() * sizeof(int),
+      (d.num_states * 31 + d.num_syms) * 31 + d.start, &h);
+    return h;
+  }
+  static bool same(const regular::dfa& x, const regular::dfa& y) {
+    if(x.num_states != y.num_states || x.num_syms != y.num_syms
+       || x.start != y.start || x.accepts.size() != y.accepts.size())
+      return false;
+    for(int ii = 0; ii < x.trans.size(); ++ii) {
+      if(x.trans[ii] != y.trans[ii])
+        return false;
+    }
+    for(int ii = 0; ii < x.accepts.size(); ++ii) {
+      if(x.accepts[ii] != y.accepts[ii])
+        return false;
+    }
+    return true;
+  }
+
+  solver_data* s;
+  vec<entry*> dfas;
+  std::unordered_multimap<uint32_t, regular_id> index;
+};
+
+regular_id regular_manager::build(const regular::dfa& d) {
+  assert(d.trans.size() == d.num_states * d.num_syms);
+  entry* e(new entry);
+  e->d.num_states = d.num_states;
+  e->d.num_syms = d.num_syms;
+  e->d.start = d.start;
+  d.trans.copyTo(e->d.trans);
+  // Normalize the accepting states, so equal DFAs compare equal.
+  d.accepts.copyTo(e->d.accepts);
+  std::sort(e->d.accepts.begin(), e->d.accepts.end());
+  int* a_end = std::unique(e->d.accepts.begin(), e->d.accepts.end());
+  e->d.accepts.shrink(e->d.accepts.end() - a_end);
+
+  uint32_t h(hash(e->d));
+  auto range(index.equal_range(h));
+  for(auto it = range.first; it != range.second; ++it) {
+    if(same(dfas[it->second]->d, e->d)) {
+      delete e;
+      return it->second;
+    }
+  }
+  regular_id r(dfas.size());
+  dfas.push(e);
+  index.insert(std::make_pair(h, r));
+  return r;
+}
+
+mdd::mdd_id regular_manager::unfold(regular_id r, int length) {
+  entry* e(dfas[r]);
+  auto it(e->unfolded.find(length));
+  if(it != e->unfolded.end())
+    return it->second;
+  const regular::dfa& d(e->d);
+  mdd::mdd_id m(mdd::of_dfa(s, length, d.num_states, d.num_syms, d.trans, d.start, d.accepts));
+  e->unfolded.insert(std::make_pair(length, m));
+  return m;
+}
+
+namespace geas {
+
+namespace regular {
+  regular_id build(solver_data* s, const dfa& d) {
+    return regular_manager::get(s)->build(d);
+  }
+
+  bool post(solver_data* s, regular_id r, vec<intvar>& xs) {
+    if(xs.size() == 0) {
+      const dfa& d(regular_manager::get(s)->lookup(r));
+      return std::binary_search(d.accepts.begin(), d.accepts.end(), d.start);
+    }
+    mdd::mdd_id m(regular_manager::get(s)->unfold(r, xs.size()));
+    if(m < 0)
+      return false;
+    return mdd::post(s, m, xs);
+  }
+}
+
+}
@@ -32,13 +32,7 @@ struct table_info {
     : arity(_arity), num_tuples(_num_tuples)
     , domains(arity), supports(arity)
     , row_index(num_tuples)
-    , m_id(-1)
-    , available(1)
-    , reaching(1)
-    , reaching_succ(1) {
-    for(int ii = 0; ii < arity; ++ii)
-      forbidden.push(p_sparse_bitset(1));
-  }
+    , m_id(-1) { }
 
   size_t arity;
   size_t num_tuples;
@@ -66,10 +60,7 @@ struct table_info {
   vec<mdd::mdd_id> val_mdds;
 
   // Scratch space.
-  p_sparse_bitset available;
-  p_sparse_bitset reaching;
-  p_sparse_bitset reaching_succ;
-  vec<p_sparse_bitset> forbidden;
+  mdd::expl_space ex_space;
 };
 
 table_info* construct_table_info(vec< vec<int> >& tuples) {
@@ -206,81 +197,14 @@ class compact_table : public propagator, public prop_inst<compact_table> {
     return dead_pos[table.vals_start[xi] + live_vals[xi][1]] < (int) dead_idx;
   }
 
-  void mdd_mark_forbidden(mdd::mdd_info& m, unsigned int dead_idx) {
-    /*
-    p_sparse_bitset& reaching(table.reaching);
-    p_sparse_bitset& reaching_succ(table.reaching_succ);
-    p_sparse_bitset& available(table.available);
-    vec<p_sparse_bitset>& forbidden(table.forbidden);
-    */
-
-    table.reaching.clear();
-    table.reaching.fill(m.num_edges.last());
-    for(int l = m.values.size()-1; l > 0; --l) {
-      table.available.clear();
-      for(int k : irange(m.values[l].size())) {
-        if(dead_vals.pos(m.values[l][k]) < dead_idx)
-          continue;
-        table.available.union_with(m.val_support[l][k]);
-      }
-
-      table.forbidden[l].set(table.reaching);
-      table.forbidden[l].remove(table.available);
-      table.reaching.intersect_with(table.available);
-
-      table.reaching_succ.clear();
-      for(int ni = 0; ni < m.num_nodes[l]; ++ni) {
-        if(table.reaching.has_intersection(m.edge_HD[l][ni]))
-          table.reaching_succ.union_with(m.edge_TL[l][ni]);
-      }
-      // table.reaching.set(table.reaching_succ);
-      std::swap(table.reaching, table.reaching_succ);
-    }
-    table.forbidden[0].set(table.reaching);
-  }
-  void mdd_retrieve_expln(mdd::mdd_info& m, unsigned int dead_idx, vec<clause_elt>& expl) {
-    /*
-    p_sparse_bitset& reaching(table.reaching);
-    p_sparse_bitset& reaching_succ(table.reaching_succ);
-    vec<p_sparse_bitset>& forbidden(table.forbidden);
-    */
-
-    table.reaching.fill(m.num_edges[0]);
-    for(int l = 0; l < m.values.size(); ++l) {
-      for(int w : table.forbidden[l].idx) {
-        if(!table.reaching.idx.elem(w))
-          continue;
-        word_ty f_bits(table.forbidden[l][w]);
-        // If there is some edge which must be blocked here, add
-        // the corresponding value to the explanation, and remove
-        // all matching edges.
-        while(table.reaching[w] & f_bits) {
-          int f_edge = word_bits() * w + __builtin_ctzll(table.reaching[w] & f_bits);
-          int v_id = m.edge_value_id[l][f_edge];
-          table.reaching.remove(m.val_support[l][v_id]);
-          int xi(table.val_index[m.values[l][v_id]].var);
-          int k(table.domains[xi][table.val_index[m.values[l][v_id]].val_id]);
-          xs[xi].explain_neq(k, expl);
-        }
-      }
-      if(table.reaching.is_empty())
-        return;
-      
-      assert(l+1 < m.values.size());
-      table.reaching_succ.clear();
-      for(int ni = 0; ni < m.num_nodes[l+1]; ++ni) {
-        if(table.reaching.has_intersection(m.edge_TL[l+1][ni])) {
-          table.reaching_succ.union_with(m.edge_HD[l+1][ni]);
-        }
-      }
-      // table.reaching.set(table.reaching_succ);
-      std::swap(table.reaching, table.reaching_succ);
-    }
-  }
-
   void expl_from_mdd(mdd::mdd_info& m, unsigned int dead_idx, vec<clause_elt>& expl) {
-    mdd_mark_forbidden(m, dead_idx);
-    mdd_retrieve_expln(m, dead_idx, expl);
+    mdd::mark_forbidden(m, table.ex_space, [&](int l, int k) {
+        return dead_vals.pos(m.values[l][k]) >= dead_idx;
+      });
+    mdd::retrieve_expln(m, table.ex_space, [&](int l, int k) {
+        table_info::val_info info(table.val_index[m.values[l][k]]);
+        xs[info.var].explain_neq(table.domains[info.var][info.val_id], expl);
+      });
   }
   /*
   void expl_from_mdd(vec<int>& proj_vars, mdd::mdd_info& m, unsigned int dead_idx, vec<clause_elt>& expl) {
@@ -460,12 +384,7 @@ restart_expl:
       fprintf(stderr, "MDD id: %d (%d nodes, %d edges) {P %p}\n", table.val_mdds[vi], num_nodes, num_edges, &table);
       */
 
-      int width_max = std::accumulate(mi.num_edges.begin(), mi.num_edges.end(), 0, [](unsigned int i, unsigned int j) { return std::max(i, j); });
-      table.available.growTo(width_max);
-      table.reaching.growTo(width_max);
-      table.reaching_succ.growTo(width_max);
-      for(p_sparse_bitset& f : table.forbidden)
-        f.growTo(width_max);
+      table.ex_space.reserve(mi);
 
     }
 
@@ -509,12 +428,7 @@ restart_expl:
       */
 
       // Grow the scratch-space.
-      int width_max = std::accumulate(mi.num_edges.begin(), mi.num_edges.end(), 0, [](unsigned int i, unsigned int j) { return std::max(i, j); });
-      table.available.growTo(width_max);
-      table.reaching.growTo(width_max);
-      table.reaching_succ.growTo(width_max);
-      for(p_sparse_bitset& f : table.forbidden)
-        f.growTo(width_max);
+      table.ex_space.reserve(mi);
     }
 #ifdef EXPLAIN_BY_MDD
     expl_from_mdd(mdd::lookup(s, table.m_id), dead_vals.size(), expl);
@@ -15,13 +15,30 @@ static inline void bump_clause_act(solver_data* s, clause& cl) {
 }
 static inline void decay_clause_act(solver_data* s) {
   if((s->learnt_act_inc *= s->opts.learnt_act_growthrate) > 1e20) {
-    for(clause* c : s->infer.learnts) {
-      c->extra.act *= 1e-20;
-    }
+    // Tier2 clauses may be demoted, so scale them too.
+    for(cref c : s->infer.learnts)
+      s->infer.arena[c].extra.act *= 1e-20;
+    for(cref c : s->infer.learnts_tier2)
+      s->infer.arena[c].extra.act *= 1e-20;
     s->learnt_act_inc *= 1e-20;
   }
 }
 
+// Charge an explanation to the propagator which made the inference.
+// Only when profiling: it costs a lookup per explanation. The
+// owner map is built here, so posting doesn't pay for it.
+static inline void count_explain(solver_data* s, const expl_thunk& eth) {
+  if(!s->opts.prop_profile)
+    return;
+  if(s->prop_owner.size() != (size_t) s->propagators.size()) {
+    for(propagator* p : s->propagators)
+      s->prop_owner[p] = p;
+  }
+  auto it = s->prop_owner.find(eth.ptr);
+  if(it != s->prop_owner.end())
+    ++it->second->prof.explains;
+}
+
 #if 0
 static inline void bump_pred_act(solver_data* s, pid_t p) {
   // FIXME: Update order in heap, also.
@@ -40,48 +57,113 @@ static inline void bump_pred_act(solver_data* s, pid_t p) {
 #endif
 
 struct cmp_clause_act {
-  bool operator()(clause* x, clause* y) { return x->extra.act > y->extra.act; }
+  cmp_clause_act(clause_arena& _arena) : arena(_arena) { }
+  bool operator()(cref x, cref y) { return arena[x].extra.act > arena[y].extra.act; }
+  clause_arena& arena;
 };
 
-inline void remove_watch(watch_node* watch, clause* cl) {
-  // Locate the clause_head matching cl. 
-  for(clause_head& elt : watch->ws) {
-    if(elt.c == cl) {
-      elt = watch->ws.last();
-      watch->ws.pop();
-      return;
-    }
-  }
-  GEAS_ERROR;
+inline void remove_watch(watch_node* watch, cref cl) {
+  if(!watch->ws.remove_long(cl))
+    GEAS_ERROR;
 }
 
 inline watch_node* find_watchlist(solver_data* s, clause_elt& elt) {
-#ifdef CACHE_WATCH
-  assert(elt.watch);
-  return elt.watch;
-#else
-  patom_t p(~elt.atom);
+  if(elt.watch)
+    return s->infer.deref_watch(elt.watch);
+  patom_t p(~elt.atom());
   return s->infer.get_watch(p.pid, p.val);
-#endif
 }
 
-inline void detach_clause(solver_data* s, clause* cl) {
+inline void detach_clause(solver_data* s, cref cr) {
+  clause* cl(s->infer.arena.lea(cr));
+  if(cl->extra.ternary) {
+    for(clause_elt& e : *cl) {
+      if(!find_watchlist(s, e)->ws.remove_tern(cr))
+        GEAS_ERROR;
+    }
+    return;
+  }
   // At least the current watches should be cached
   if(!cl->extra.one_watch) {
     /*
     assert((*cl)[0].watch);
     remove_watch((*cl)[0].watch, cl);
     */
-    remove_watch(find_watchlist(s, (*cl)[0]), cl);
+    remove_watch(find_watchlist(s, (*cl)[0]), cr);
   }
   /*
   assert((*cl)[1].watch);
   remove_watch((*cl)[1].watch, cl);
   */
-  remove_watch(find_watchlist(s, (*cl)[1]), cl);
+  remove_watch(find_watchlist(s, (*cl)[1]), cr);
 }
 
-inline bool is_locked(solver_data* s, clause* c) {
+// Decision level at which at (currently entailed) became true.
+// Walks back through the trail entries for at.pid to find where
+// it crossed at.val.
+int atom_level(solver_data* s, patom_t at) {
+  if(s->state.p_root[at.pid] >= at.val)
+    return 0;
+  infer_info& inf(s->infer);
+  int pos = inf.pred_tpos[at.pid];
+  int last = pos;
+  while(pos >= 0 && inf.trail[pos].old_val >= at.val) {
+    last = pos;
+    pos = inf.trail[pos].prev;
+  }
+  if(pos >= 0)
+    return inf.level_of(pos);
+  // Set without a trail entry (by a lazy initializer), so
+  // no later than the oldest entry we have.
+  return last >= 0 ? inf.level_of(last) : inf.trail_lim.size();
+}
+
+static inline void new_lbd(solver_data* s) {
+  conflict_info& ci(s->confl);
+  if(ci.level_stamp.size() <= s->infer.trail_lim.size())
+    ci.level_stamp.growTo(s->infer.trail_lim.size()+1, 0);
+  ++ci.lbd_stamp;
+}
+
+// Returns true if l is a new (non-root) level.
+static inline bool mark_level(solver_data* s, int l) {
+  conflict_info& ci(s->confl);
+  if(!l || ci.level_stamp[l] == ci.lbd_stamp)
+    return false;
+  ci.level_stamp[l] = ci.lbd_stamp;
+  return true;
+}
+
+int clause_lbd(solver_data* s, clause& c) {
+  new_lbd(s);
+  int lbd = 0;
+  if(s->state.is_entailed(c[0].atom()) && mark_level(s, atom_level(s, c[0].atom())))
+    ++lbd;
+  for(clause_elt e : c.tail()) {
+    if(mark_level(s, atom_level(s, ~e.atom())))
+      ++lbd;
+  }
+  return lbd;
+}
+
+// The learnt c was used in conflict analysis; refresh its glue,
+// and promote it if it has improved.
+static inline void update_glue(solver_data* s, clause& c) {
+  c.extra.used = 1;
+  if(c.extra.tier == clause_extra::T_Core)
+    return;
+  int lbd = clause_lbd(s, c);
+  if(lbd + 1 < (int) c.extra.lbd) {
+    c.extra.lbd = lbd;
+    if(lbd <= s->opts.lbd_core)
+      c.extra.tier = clause_extra::T_Core;
+    else if(lbd <= s->opts.lbd_tier2)
+      c.extra.tier = clause_extra::T_Tier2;
+  }
+}
+
+inline bool is_locked(solver_data* s, cref cr) {
+  clause* c(s->infer.arena.lea(cr));
   int depth = c->extra.depth;
   if(s->infer.trail.size() <= depth)
     return false;
@@ -90,22 +172,96 @@ inline bool is_locked(solver_data* s, clause* c) {
   return r.kind == reason::R_Clause && r.cl == c;
 }
 
+// Move all live clauses into a fresh arena, dropping the space
+// left by deleted (or shrunk) clauses. Watches, the clause lists
+// and reasons on the trail are redirected to the new copies.
+void compact_clauses(solver_data* s) {
+  infer_info& inf(s->infer);
+  clause_arena to;
+  // Reserve up front, so the new arena doesn't move underneath us.
+  to.reserve(inf.arena.size() - inf.arena.wasted_words());
+
+  // Nodes before the watch head only watch atoms fixed at the root,
+  // and their clauses were removed by simplify_at_root.
+  for(infer_info::watch_head h : inf.pred_watch_heads) {
+    for(watch_node* w = h.ptr; w; w = w->succ) {
+      for(tern_watch& t : w->ws.tern())
+        t.c = inf.arena.relocate(t.c, to);
+      for(clause_head& ch : w->ws.longs())
+        ch.c = inf.arena.relocate(ch.c, to);
+    }
+  }
+  for(cref& c : inf.clauses)
+    c = inf.arena.relocate(c, to);
+  for(cref& c : inf.learnts_core)
+    c = inf.arena.relocate(c, to);
+  for(cref& c : inf.learnts_tier2)
+    c = inf.arena.relocate(c, to);
+  for(cref& c : inf.learnts)
+    c = inf.arena.relocate(c, to);
+  for(infer_info::entry& e : inf.trail) {
+    if(e.expl.kind == reason::R_Clause && inf.arena.contains(e.expl.cl))
+      e.expl.cl = to.lea(inf.arena.relocate(inf.arena.ref(e.expl.cl), to));
+  }
+  inf.arena.swap(to);
+}
+
 void reduce_db(solver_data* s) {
-  // Find the median of the clauses by activity
-  vec<clause*>& learnts(s->infer.learnts);
-  clause** mid = &learnts[s->learnt_dbmax/2];
-  std::nth_element(learnts.begin(), mid, learnts.end(), cmp_clause_act());
+  infer_info& inf(s->infer);
+  clause_arena& arena(inf.arena);
+
+  // Clause tiers are updated during conflict analysis; move
+  // promoted clauses to their new tier. Tier2 clauses which
+  // haven't been used since the last reduction drop to local.
+  cref* tj = inf.learnts_tier2.begin();
+  for(cref c : inf.learnts_tier2) {
+    clause_extra& e(arena[c].extra);
+    if(e.tier == clause_extra::T_Core) {
+      inf.learnts_core.push(c);
+    } else if(!e.used) {
+      e.tier = clause_extra::T_Local;
+      inf.learnts.push(c);
+    } else {
+      e.used = 0;
+      *tj = c; ++tj;
+    }
+  }
+  inf.learnts_tier2.shrink_(inf.learnts_tier2.end() - tj);
+
+  vec<cref>& learnts(inf.learnts);
+  cref* lj = learnts.begin();
+  for(cref c : learnts) {
+    switch(arena[c].extra.tier) {
+      case clause_extra::T_Core:
+        inf.learnts_core.push(c);
+        break;
+      case clause_extra::T_Tier2:
+        inf.learnts_tier2.push(c);
+        break;
+      default:
+        *lj = c; ++lj;
+    }
+  }
+  learnts.shrink_(learnts.end() - lj);
+  s->stats.num_core = inf.learnts_core.size();
+  s->stats.num_tier2 = inf.learnts_tier2.size();
+
+  // Keep the most active local clauses, so that together
+  // with tier2 we have half the budget.
+  int keep = std::max(0, s->learnt_dbmax/2 - inf.learnts_tier2.size());
+  cref* mid = learnts.begin() + std::min(learnts.size(), keep);
+  std::nth_element(learnts.begin(), mid, learnts.end(), cmp_clause_act(arena));
   int shrunk_lits = 0;
   
-  for(clause* c : range(mid, learnts.end())) {
+  for(cref c : range(mid, learnts.end())) {
     // If this clause is locked, we can't detach it
     if(is_locked(s, c)) {
       *mid = c; ++mid; 
       continue;
     }
-    shrunk_lits += c->size();
+    shrunk_lits += s->infer.arena[c].size();
     detach_clause(s, c);
-    free(c);
+    s->infer.arena.release(c);
   }
   int num_shrunk = learnts.end() - mid;
   s->stats.num_learnts -= num_shrunk;
@@ -113,6 +269,9 @@ void reduce_db(solver_data* s) {
   learnts.shrink(num_shrunk);
   
   s->learnt_dbmax *= s->opts.learnt_growthrate;
+
+  if(s->infer.arena.fragmented())
+    compact_clauses(s);
 }
 
 // Pre: Conflict stuff is in 
@@ -173,9 +332,9 @@ static int clevel_count(solver_data* s) {
 
 
 static void add(solver_data* s, clause_elt elt) {
-  assert(s->state.is_inconsistent(elt.atom));
-  pid_t pid = elt.atom.pid^1;
-  pval_t val = pval_contra(elt.atom.val);
+  assert(s->state.is_inconsistent(elt.atom()));
+  pid_t pid = elt.atom().pid^1;
+  pval_t val = pval_contra(elt.atom().val);
   assert(s->state.is_entailed(patom_t(pid, val)));
   if(!s->confl.pred_seen.elem(pid)) {
     // Not yet in the explanation
@@ -189,9 +348,7 @@ static void add(solver_data* s, clause_elt elt) {
 
     s->confl.pred_seen.insert(pid);
     s->confl.pred_eval[pid] = val;
-#ifdef CACHE_WATCH
     s->confl.pred_hint[pid] = elt.watch;
-#endif
 
     if(s->state.p_last[pid] < val) {
 #ifdef CHECK_CLEVEL
@@ -201,13 +358,11 @@ static void add(solver_data* s, clause_elt elt) {
     }
   } else {
     // Check whether the atom is already entailed.
-    // pval_t val = elt.atom.val;
+    // pval_t val = elt.atom().val;
     pval_t e_val = s->confl.pred_eval[pid];
     if(val <= e_val) {
-#ifdef CACHE_WATCH
       if(val == e_val && elt.watch)
         s->confl.pred_hint[pid] = elt.watch;
-#endif
       return;
     }
     
@@ -217,9 +372,7 @@ static void add(solver_data* s, clause_elt elt) {
       s->confl.clevel++;
 
     s->confl.pred_eval[pid] = val;
-#ifdef CACHE_WATCH
     s->confl.pred_hint[pid] = elt.watch;
-#endif
   }
 #ifdef CHECK_PRED_EVALS
   assert(s->state.is_entailed(patom_t(pid, s->confl.pred_eval[pid])));
@@ -271,7 +424,7 @@ static inline void bt_infer_to_pos(solver_data* s, unsigned int pos) {
   for(infer_info::entry e : rev_range(&inf.trail[pos], inf.trail.end())) {
     st.p_vals[e.pid] = e.old_val; 
   }
-  inf.trail.shrink_(inf.trail.size() - pos);
+  inf.shrink_trail(pos);
 }
 
 inline void apply_atom(ctx_t& ctx, patom_t at) {
@@ -283,7 +436,7 @@ bool check_inference(solver_data* s, propagator* p, patom_t z, vec<clause_elt>&
   vec<pval_t> ctx(s->state.p_root);
   apply_atom(ctx, ~z);
   for(clause_elt e : expl) {
-    apply_atom(ctx, ~e.atom); 
+    apply_atom(ctx, ~e.atom()); 
   }
   return p->check_unsat(ctx);
 }
@@ -291,7 +444,7 @@ bool check_inference(solver_data* s, propagator* p, patom_t z, vec<clause_elt>&
 bool check_confl(solver_data* s, propagator* p, vec<clause_elt>& expl) {
   vec<pval_t> ctx(s->state.p_root);
   for(clause_elt e : expl) {
-    apply_atom(ctx, ~e.atom); 
+    apply_atom(ctx, ~e.atom()); 
   }
   return p->check_unsat(ctx);
 }
@@ -323,10 +476,12 @@ static forceinline void add_reason(solver_data* s, unsigned int pos, pval_t ex_v
         // Skip the first literal (which we're resolving on)
         // assert(is_locked(s, r.cl));
         bump_clause_act(s, *r.cl);
+        if(r.cl->extra.is_learnt)
+          update_glue(s, *r.cl);
         auto it = r.cl->begin();
         for(++it; it != r.cl->end(); ++it) {
 #ifdef PROOF_LOG
-          log::add_atom(*s, (*it).atom);
+          log::add_atom(*s, (*it).atom());
 #endif
           add(s, *it);
         }
@@ -362,6 +517,7 @@ static forceinline void add_reason(solver_data* s, unsigned int pos, pval_t ex_v
           }
         }
         vec<clause_elt>& es(s->confl.expl_buf); es.clear();
+        count_explain(s, r.eth);
         r.eth(ex_val, es);
 #ifdef CHECK_PRED_EVALS
         for(pid_t p : s->confl.pred_seen)
@@ -370,14 +526,14 @@ static forceinline void add_reason(solver_data* s, unsigned int pos, pval_t ex_v
 #ifdef CHECK_EXPLNS
         if(r.eth.origin) {
           for(auto at : es) {
-            assert(still_entailed(s, pos, ~at.atom));
+            assert(still_entailed(s, pos, ~at.atom()));
           }
           assert(check_inference(s, static_cast<propagator*>(r.eth.origin), patom_t(s->infer.trail[pos].pid, ex_val), es));
         }
 #endif
         for(clause_elt e : es) {
 #ifdef PROOF_LOG
-          log::add_atom(*s, e.atom);
+          log::add_atom(*s, e.atom());
 #endif
           add(s, e);
 #ifdef CHECK_PRED_EVALS
@@ -394,70 +550,160 @@ static forceinline void add_reason(solver_data* s, unsigned int pos, pval_t ex_v
   }
 }
 
-// TODO: Fix proof logging
-#if 0
-static forceinline bool atom_is_redundant(solver_data* s, patom_t at) {
-  pid_t pid = at.pid^1;
-  pval_t val = pval_max - at.val + 1;
-  assert(s->state.is_entailed(patom_t(pid, val)));
-  if(!s->confl.pred_seen.elem(pid))
-    return false;
+// Learnt minimization. An atom of the learnt is redundant if the
+// rest imply it: each antecedent (from the reason of the trail
+// entry that set it) holds at the root, is implied by the learnt's
+// bound on the same predicate, or is itself redundant. Only atoms
+// set earlier on the trail may be used, so the argument is never
+// circular.
+enum { Min_Depth = 32 };
+
+// Trail position at which the (entailed) atom became true,
+// or -1 if it was set without a trail entry.
+static int atom_pos(solver_data* s, patom_t at) {
+  infer_info& inf(s->infer);
+  int pos = inf.pred_tpos[at.pid];
+  while(pos >= 0 && inf.trail[pos].old_val >= at.val)
+    pos = inf.trail[pos].prev;
+  return pos;
+}
+
+static bool entry_redundant(solver_data* s, int pos, pval_t val, int depth);
 
-  pval_t e_val = s->confl.pred_eval[pid];
-  return val <= e_val;
+// Is at implied by the atoms of the learnt set before trail
+// position lim?
+static bool atom_redundant(solver_data* s, patom_t at, int lim, int depth) {
+  if(s->state.p_root[at.pid] >= at.val)
+    return true;
+  if(s->state.p_vals[at.pid] < at.val)
+    return false;
+  int pos = atom_pos(s, at);
+  if(pos < 0 || pos >= lim)
+    return false;
+  conflict_info& ci(s->confl);
+  if(ci.pred_seen.elem(at.pid) && ci.pred_eval[at.pid] >= at.val
+     && atom_pos(s, patom_t(at.pid, ci.pred_eval[at.pid])) < lim)
+    return true;
+  // Nothing at a level without learnt atoms can be implied by them.
+  if(ci.level_stamp[s->infer.level_of(pos)] != ci.lbd_stamp)
+    return false;
+  return entry_redundant(s, pos, at.val, depth+1);
 }
 
-static forceinline bool is_redundant(solver_data* s, reason r) {
+static bool reason_redundant(solver_data* s, int pos, pval_t val, int depth) {
+  reason r(s->infer.trail[pos].expl);
   switch(r.kind) {
     case reason::R_Atom:
-      // add(s, r.at);
-      return atom_is_redundant(s, r.at);
-      break;
+      return atom_redundant(s, ~r.at, pos, depth);
     case reason::R_Clause:
       {
-        // Skip the first literal (which we're resolving on)
-        // assert(is_locked(s, r.cl));
         auto it = r.cl->begin();
         for(++it; it != r.cl->end(); ++it) {
-          if(!atom_is_redundant(s, (*it).atom))
+          if(!atom_redundant(s, ~(*it).atom(), pos, depth))
             return false;
-          return true;
         }
+        return true;
       }
-      break;
     case reason::R_LE:
-      {
-        // p <= q + offset.
-        pval_t ex_val(s->confl.pred_eval[e.pid]);
-        patom_t at(~patom_t(r.le.p, ex_val + r.le.offset));
-        return atom_is_redundant(s, at);
-      }
-      break;
+      return atom_redundant(s, patom_t(r.le.p, val + r.le.offset), pos, depth);
     case reason::R_Thunk:
       {
-        if(r.eth.flags) {
-          // If the explanation needs backtracking,
-          // don't.
+        // Explanations which need the trail unwound aren't worth it.
+        if(r.eth.flags)
           return false;
-        }
-        vec<clause_elt>& es(s->confl.expl_buf); es.clear();
-        pval_t ex_val(s->confl.pred_eval[e.pid]);
-        r.eth(ex_val, es);
+        vec<clause_elt>& es(s->confl.min_bufs[depth]); es.clear();
+        count_explain(s, r.eth);
+        r.eth(val, es);
         for(clause_elt e : es) {
-          if(!atom_is_redundant(s, e.at))
+          if(!atom_redundant(s, ~e.atom(), pos, depth))
             return false;
         }
         return true;
       }
-      break;
-    case reason::R_NIL:
-      return true;
-      break;
     default:
-      GEAS_NOT_YET;
+      // A decision.
+      return false;
   }
 }
-#endif
+
+// Is [trail[pos].pid >= val] redundant, by the reason for pos?
+// Results are cached per trail position: weaker atoms set by
+// the same entry are redundant too, and stronger ones are
+// assumed not to be.
+static bool entry_redundant(solver_data* s, int pos, pval_t val, int depth) {
+  if(depth > Min_Depth)
+    return false;
+  conflict_info& ci(s->confl);
+  if(ci.min_stamp[pos] != ci.confl_num) {
+    ci.min_stamp[pos] = ci.confl_num;
+    ci.min_ok[pos] = pval_min;
+    ci.min_fail[pos] = pval_err;
+  }
+  if(val <= ci.min_ok[pos])
+    return true;
+  if(val >= ci.min_fail[pos])
+    return false;
+  if(reason_redundant(s, pos, val, depth)) {
+    ci.min_ok[pos] = val;
+    return true;
+  }
+  ci.min_fail[pos] = val;
+  return false;
+}
+
+// Remove redundant atoms from the learnt (in pred_seen, with the
+// asserting atom at already removed). Levels of the learnt must
+// be marked, as by learnt_lbd. Returns the number removed.
+static int minimize_learnt(solver_data* s, patom_t at) {
+  conflict_info& ci(s->confl);
+  infer_info& inf(s->infer);
+  ci.min_stamp.growTo(inf.trail.size(), 0);
+  ci.min_ok.growTo(inf.trail.size(), pval_min);
+  ci.min_fail.growTo(inf.trail.size(), pval_err);
+  ci.min_bufs.growTo(Min_Depth+2);
+
+  vec<pid_t>& drop(ci.min_drop); drop.clear();
+  for(pid_t p : ci.pred_seen) {
+    pval_t val(ci.pred_eval[p]);
+    int pos = atom_pos(s, patom_t(p, val));
+    if(pos >= 0 && entry_redundant(s, pos, val, 0))
+      drop.push(p);
+  }
+  for(pid_t p : drop)
+    remove(s, p);
+  int removed = drop.size();
+
+  // Binary clauses (l0 \/ y) on the asserting literal l0 = ~at:
+  // if y implies the negation of another literal, that literal
+  // resolves away. Those watched on any [at.pid >= v], v <= at.val,
+  // apply.
+  watch_node* w(inf.pred_watch_heads[at.pid].ptr);
+  while(w->succ && w->succ_val <= at.val) {
+    w = w->succ;
+    for(patom_t y : w->ws.bin()) {
+      if(ci.pred_seen.elem(y.pid) && ci.pred_eval[y.pid] <= y.val) {
+        remove(s, y.pid);
+        ++removed;
+      }
+    }
+  }
+  return removed;
+}
+
+// Number of distinct levels in the learnt (the asserting atom, at
+// the current level, and those in pred_seen). Leaves the levels
+// marked. Bounds on the same predicate may become true at
+// different levels, so levels are taken per atom.
+static int learnt_lbd(solver_data* s) {
+  new_lbd(s);
+  mark_level(s, s->infer.trail_lim.size());
+  int lbd = 1;
+  for(pid_t p : s->confl.pred_seen) {
+    if(mark_level(s, atom_level(s, patom_t(p, s->confl.pred_eval[p]))))
+      ++lbd;
+  }
+  return lbd;
+}
 
 // Is the given trail entry required in the conflict?
 inline bool needed(solver_data* s, infer_info::entry& entry) {
@@ -472,11 +718,8 @@ inline bool l_needed(solver_data* s, persistence::pred_entry entry) {
 
 inline clause_elt get_clause_elt(solver_data* s, pid_t p) {
   return clause_elt(
-    patom_t(p^1, pval_contra(s->confl.pred_eval[p]))
-#ifdef CACHE_WATCH
-    , s->confl.pred_hint[p]
-#endif
-  );
+    patom_t(p^1, pval_contra(s->confl.pred_eval[p])),
+    s->confl.pred_hint[p]);
 }
 
 // Backtrack to the first level at which some conflict literal occurred.
@@ -517,7 +760,7 @@ int compute_learnt(solver_data* s, vec<clause_elt>& confl) {
 #endif
   for(clause_elt e : confl) {
 #ifdef PROOF_LOG
-    log::add_atom(*s, e.atom);
+    log::add_atom(*s, e.atom());
 #endif
     add(s, e);
   }
@@ -603,6 +846,18 @@ int compute_learnt(solver_data* s, vec<clause_elt>& confl) {
   confl.push(get_clause_elt(s, e.pid));
   remove(s, e.pid);
 
+  // Minimize, and compute the LBD, while the trail is intact.
+  s->confl.learnt_lbd = learnt_lbd(s);
+#ifndef PROOF_LOG
+  if(s->opts.learnt_minimize) {
+    int removed = minimize_learnt(s, patom_t(e.pid, s->confl.pred_eval[e.pid]));
+    if(removed) {
+      s->stats.minimized_lits += removed;
+      s->confl.learnt_lbd = learnt_lbd(s);
+    }
+  }
+#endif
+
   // Identify the backtrack level and position the
   // second watch.
   int bt_level = 0;
@@ -664,7 +919,7 @@ bool confl_is_current(solver_data* s, vec<clause_elt>& confl) {
   if(s->persist.level() == 0)
     return true;
   for(clause_elt& e : confl) {
-    if(!s->state.is_inconsistent_prev(e.atom))
+    if(!s->state.is_inconsistent_prev(e.atom()))
       return true;
   }
   return false;
@@ -706,9 +961,9 @@ static inline bool aconfl_needed(solver_data* s, infer_info::entry& entry) {
 
 
 static inline void aconfl_add(solver_data* s, clause_elt elt) {
-  assert(s->state.is_inconsistent(elt.atom));
-  pid_t pid = elt.atom.pid^1;
-  pval_t val = pval_contra(elt.atom.val);
+  assert(s->state.is_inconsistent(elt.atom()));
+  pid_t pid = elt.atom().pid^1;
+  pval_t val = pval_contra(elt.atom().val);
   assert(s->state.is_entailed(patom_t(pid, val)));
   if(s->state.is_entailed_l0(patom_t(pid, val)))
     return;
@@ -718,13 +973,14 @@ static inline void aconfl_add(solver_data* s, clause_elt elt) {
 
     s->confl.pred_seen.insert(pid);
     s->confl.pred_eval[pid] = val;
+    s->confl.pred_hint[pid] = elt.watch;
 
     // Check if this is an assumption
     if(!s->confl.pred_is_assump[pid] || s->confl.pred_assval[pid] < val)
       s->confl.clevel++;
   } else {
     // Check whether the atom is already entailed.
-    // pval_t val = elt.atom.val;
+    // pval_t val = elt.atom().val;
     pval_t e_val = s->confl.pred_eval[pid];
     if(val <= e_val) {
       return;
@@ -740,6 +996,7 @@ static inline void aconfl_add(solver_data* s, clause_elt elt) {
     }
 
     s->confl.pred_eval[pid] = val;
+    s->confl.pred_hint[pid] = elt.watch;
   }
   assert(s->state.is_entailed(patom_t(pid, s->confl.pred_eval[pid])));
   // Should be equivalent
@@ -762,7 +1019,7 @@ static inline void aconfl_add_reason(solver_data* s, unsigned int pos, pval_t ex
         auto it = r.cl->begin();
         for(++it; it != r.cl->end(); ++it) {
 #ifdef PROOF_LOG
-          log::add_atom(*s, (*it).atom);
+          log::add_atom(*s, (*it).atom());
 #endif
           aconfl_add(s, *it);
         }
@@ -798,18 +1055,19 @@ static inline void aconfl_add_reason(solver_data* s, unsigned int pos, pval_t ex
           }
         }
         vec<clause_elt>& es(s->confl.expl_buf); es.clear();
+        count_explain(s, r.eth);
         r.eth(ex_val, es);
 #ifdef CHECK_EXPLNS
         if(r.eth.origin) {
           for(auto at : es) {
-            assert(still_entailed(s, pos, ~at.atom));
+            assert(still_entailed(s, pos, ~at.atom()));
           }
           assert(check_inference(s, static_cast<propagator*>(r.eth.origin), patom_t(s->infer.trail[pos].pid, ex_val), es));
         }
 #endif
         for(clause_elt e : es) {
 #ifdef PROOF_LOG
-          log::add_atom(*s, e.atom);
+          log::add_atom(*s, e.atom());
 #endif
           aconfl_add(s, e);
         }
@@ -841,7 +1099,7 @@ void retrieve_assumption_nogood(solver_data* s, vec<patom_t>& confl) {
   switch(s->last_confl.kind) {
     case C_Infer:
       for(clause_elt& e : s->infer.confl) {
-        assert(s->state.is_inconsistent(e.atom));
+        assert(s->state.is_inconsistent(e.atom()));
         aconfl_add(s, e);
       }
       break;
@@ -914,7 +1172,7 @@ assumption_finished:
   // Now collect the conflict
   for(unsigned int p : s->confl.pred_seen) {
     assert(s->confl.pred_is_assump[p]);
-    confl.push(get_clause_elt(s, p).atom);
+    confl.push(get_clause_elt(s, p).atom());
   }
     
   // And clean up the solver state
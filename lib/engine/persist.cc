@@ -12,7 +12,7 @@ void push_level(solver_data* s) {
   s->infer.trail_lim.push(s->infer.trail.size());
 
   // p.bvar_trail_lim.push(p.bvar_trail.size());
-  p.dtrail_lim.push(p.data_trail.size());
+  p.dtrail_lim.push(p.data_pos());
 
   p.pwatch_lim.push(p.pwatch_trail.size());
 
@@ -29,7 +29,7 @@ void push_level(solver_data* s) {
     *c = false;
   p.reset_flags.clear();
   
-  p.expl_trail_lim.push(p.expl_trail.size());
+  p.expl_mem.push_level();
 }
 
 // Doesn't call destructors
@@ -38,49 +38,40 @@ inline void dropTo_(vec<T>& v, int sz) {
   v.shrink_(v.size() - sz);
 }
 
-inline void restore_data_elt(solver_data* s, persistence::data_entry e) {
-  switch(e.sz) {
-    case 1:
-      *((uint8_t*) e.ptr) = ((uint8_t) e.val);
-      break;
-    case 2:
-      *((uint16_t*) e.ptr) = ((uint16_t) e.val);
-      break;
-    case 4:
-      *((uint32_t*) e.ptr) = ((uint32_t) e.val); 
-      break;
-    default:
-      *((uint64_t*) e.ptr) = ((uint64_t) e.val);
-  }
+template<class T>
+inline void restore_data(vec< persistence::data_entry<T> >& trail, unsigned int p_lim) {
+  for(auto e : rev_range(&trail[p_lim], trail.end()))
+    *(e.ptr) = e.val;
+  dropTo_(trail, p_lim);
+}
+
+// Segments hold disjoint locations, so the order between them is irrelevant.
+inline void restore_data(persistence& p, const persistence::dtrail_pos& d) {
+  restore_data(p.data8, d.pos[persistence::DT_8]);
+  restore_data(p.data16, d.pos[persistence::DT_16]);
+  restore_data(p.data32, d.pos[persistence::DT_32]);
+  restore_data(p.data64, d.pos[persistence::DT_64]);
 }
 
 inline void bt_data(solver_data* s, unsigned int l) {
   persistence& p(s->persist);
   assert(l < p.dtrail_lim.size());
 
-  unsigned int p_lim = p.dtrail_lim[l];
-  for(auto e : rev_range(&p.data_trail[p_lim], p.data_trail.end()))
-    restore_data_elt(s, e);
-  dropTo_(p.data_trail, p_lim);
+  restore_data(p, p.dtrail_lim[l]);
   dropTo_(p.dtrail_lim, l);
 }
 
-void bt_data_to_pos(solver_data* s, unsigned int p_lim) {
+void bt_data_to_pos(solver_data* s, const persistence::dtrail_pos& d) {
   persistence& p(s->persist);
-  assert(p_lim >= p.dtrail_lim.last());
-  for(auto e : rev_range(&p.data_trail[p_lim], p.data_trail.end()))
-    restore_data_elt(s, e);
-  dropTo_(p.data_trail, p_lim);
+#ifndef NDEBUG
+  for(int w = 0; w < persistence::DT_WIDTHS; ++w)
+    assert(d.pos[w] >= p.dtrail_lim.last().pos[w]);
+#endif
+  restore_data(p, d);
 }
 
 inline void bt_explns(solver_data* s, unsigned int l) {
-  persistence& p(s->persist);
-  unsigned int e_lim = p.expl_trail_lim[l];
-  for(clause* c : rev_range(p.expl_trail.begin() + e_lim, p.expl_trail.end()))
-    // delete c;
-    free(c);
-  dropTo_(p.expl_trail, e_lim);
-  dropTo_(p.expl_trail_lim, l); 
+  s->persist.expl_mem.bt_to_level(l);
 }
 
 // inline
@@ -92,7 +83,7 @@ void bt_preds(solver_data* s, unsigned int l) {
   // Don't use the implication graph for restoration;
   // use pred_ltrail instead.
   assert(l < inf.trail_lim.size());
-  dropTo_(inf.trail, inf.trail_lim[l]);
+  inf.shrink_trail(inf.trail_lim[l]);
   dropTo_(inf.trail_lim, l);
   
   assert(l < p.pred_ltrail_lim.size());
@@ -3,12 +3,11 @@
 
 namespace geas {
 
+static const char* kind_unknown(void) { return "propagator"; }
+
 propagator::propagator(solver_data* _s, char _priority)
-    : is_queued(false), prop_id(_s->propagators.size()), s(_s)
-#ifdef TRACK_EXEC_COUNT
-    , exec_count(0)
-#endif
-    , priority(_priority)
+    : is_queued(false), prop_id(_s->propagators.size()), kind(kind_unknown), s(_s)
+    , priority(_priority), base_priority(_priority)
     {
 //#ifdef PROOF_LOG
     cons_id = s->log.scope_constraint;
@@ -18,6 +17,7 @@ propagator::propagator(solver_data* _s, char _priority)
   }
 
 void propagator::queue_prop(void) {
+  ++prof.wakeups;
   if(!is_queued) {
     s->prop_queue[priority].insert(this);
     s->queue_has_prop |= 1<<priority;
@@ -26,6 +26,28 @@ void propagator::queue_prop(void) {
 }
 
 bool propagator::check_sat(void) { return check_sat(s->state.p_vals); }
+
+// pretty is "... [with T = geas::foo<int>; ...]" under gcc,
+// "... [T = geas::foo<int>]" under clang.
+std::string prop_kind_name(const char* pretty) {
+  std::string k(pretty);
+  size_t start = k.find("T = ");
+  if(start == std::string::npos)
+    return k;
+  start += 4;
+  size_t end = k.find_first_of(";]", start);
+  k = k.substr(start, end == std::string::npos ? std::string::npos : end - start);
+  std::string r;
+  for(size_t ii = 0; ii < k.size(); ++ii) {
+    if(k.compare(ii, 6, "geas::") == 0)
+      ii += 5;
+    else if(k.compare(ii, 13, "{anonymous}::") == 0)
+      ii += 12;
+    else if(k[ii] != ' ')
+      r.push_back(k[ii]);
+  }
+  return r;
+}
 bool propagator::execute(vec<clause_elt>& confl) {
   return propagate(confl);
 }
@@ -1,3 +1,5 @@
+#include <vector>
+#include <unordered_map>
 #include <geas/mtl/Heap.h>
 #include <geas/solver/solver_data.h>
 #include <geas/solver/branch.h>
@@ -535,15 +537,46 @@ public:
     return true;
   }
 
-  patom_t branch(solver_data* s) {
-    // Restore not-necessarily-fixed predicates
-    // upon backtracking
+  // Restore not-necessarily-fixed predicates
+  // upon backtracking
+  void restore(solver_data* s) {
     if(rem_count < removed.size()) {
       for(int xi : irange(rem_count, removed.size())) {
         s->pred_heap.insert(removed[xi]);
       }
       removed.shrink(removed.size() - rem_count);
     }
+  }
+
+  // Activity of the pred we would branch on next.
+  // Returns false if all preds are fixed.
+  bool next_act(solver_data* s, double& act) {
+    restore(s);
+    if(is_fixed(s))
+      return false;
+    act = s->infer.pred_act[s->pred_heap.getMin()];
+    return true;
+  }
+
+  // A restart re-makes each decision whose pred is more active
+  // than the best unfixed pred; we can keep those levels, rather
+  // than replaying them.
+  unsigned int reusable_level(solver_data* s, unsigned int lim) {
+    unsigned int level = s->infer.trail_lim.size();
+    double act;
+    if(!next_act(s, act))
+      return level;
+
+    for(unsigned int l = lim; l < level; ++l) {
+      pid_t p = s->infer.trail[s->infer.trail_lim[l]].pid;
+      if(!(s->infer.pred_act[p>>1] > act))
+        return l;
+    }
+    return level;
+  }
+
+  patom_t branch(solver_data* s) {
+    restore(s);
 
     pid_t pi = pid_None;
     while(!s->pred_heap.empty()) {
@@ -581,28 +614,199 @@ public:
   int rem_count;
 };
 
+// Atom slots for one (even) pred. Narrow preds index an array
+// by offset from the root lower bound; wide ones, and values
+// outside the initial domain, go in a hash map.
+class atom_ids {
+public:
+  enum { DENSE_LIMIT = 32 };
+
+  atom_ids(void) : base(0) { }
+  atom_ids(pval_t lb, pval_t ub) : base(lb) {
+    if(lb <= ub && ub - lb < DENSE_LIMIT)
+      dense.growTo(ub - lb + 1, -1);
+  }
+
+  int find(pval_t v) const {
+    if(base <= v && v - base < (pval_t) dense.size())
+      return dense[v - base];
+    auto it = sparse.find(v);
+    return it == sparse.end() ? -1 : it->second;
+  }
+  void set(pval_t v, int ai) {
+    if(base <= v && v - base < (pval_t) dense.size())
+      dense[v - base] = ai;
+    else if(ai < 0)
+      sparse.erase(v);
+    else
+      sparse[v] = ai;
+  }
+
+protected:
+  pval_t base;
+  vec<int> dense;
+  std::unordered_map<pval_t, int> sparse;
+};
+
+// Activity over atoms [p >= v], rather than preds. An atom and its
+// negation share an entry, keyed on the even pred.
+// Instead of trailing removals from the heap, an atom found
+// fixed is parked with the level it was popped at, and put back
+// once search backtracks below that level. Atoms fixed at the
+// root are dropped for good, and their slots recycled; so the
+// table tracks the atoms still open, not every atom ever bumped.
 class atom_act_brancher : public brancher {
+  struct parked { int atom; int level; };
 public:
   atom_act_brancher(solver_data* _s)
-    : s(_s) {
-       
+    : s(_s), heap(act_cmp { act }), inc(1.0), sweep_lim(64),
+      fallback(_s) {
+    s->atom_act = this;
+  }
+  ~atom_act_brancher(void) {
+    if(s->atom_act == this)
+      s->atom_act = nullptr;
+  }
+
+  void bump(patom_t at, double mult) {
+    if(at.pid&1)
+      at = ~at;
+    if(s->polarity[at.pid>>1].nobranch)
+      return;
+    int ai = pred_ids(at.pid).find(at.val);
+    if(ai < 0) {
+      if(free_slots.size() > 0) {
+        ai = free_slots.last();
+        free_slots.pop();
+        atoms[ai] = at;
+        act[ai] = 0.0;
+      } else {
+        ai = atoms.size();
+        atoms.push(at);
+        act.push(0.0);
+      }
+      pred_ids(at.pid).set(at.val, ai);
+      heap.insert(ai);
+    }
+    act[ai] += mult * inc;
+    if(heap.inHeap(ai))
+      heap.decrease(ai);
+  }
+
+  void decay(void) {
+    inc *= s->opts.pred_act_growthrate;
+    if(inc > 1e100) {
+      for(double& a : act)
+        a *= 1e-100;
+      inc *= 1e-100;
+    }
+  }
+
+  bool is_fixed(solver_data* s) {
+    return fallback.is_fixed(s);
   }
 
   patom_t branch(solver_data* s) {
-    GEAS_NOT_YET;
-    return at_Undef;
+    int level = s->infer.trail_lim.size();
+    while(pending.size() > 0 && pending.last().level > level) {
+      heap.insert(pending.last().atom);
+      pending.pop();
+    }
+    if(level == 0 && atoms.size() - free_slots.size() >= sweep_lim)
+      sweep_root();
+
+    while(!heap.empty()) {
+      int ai = heap.getMin();
+      patom_t at(atoms[ai]);
+      if(!atom_fixed(at))
+        return (s->polarity[at.pid>>1].branch) ? at : ~at;
+      heap.removeMin();
+      if(level > 0)
+        pending.push(parked { ai, level });
+      else
+        release(ai);
+    }
+    // All the active atoms are fixed, but the preds may not be.
+    return fallback.branch(s);
+  }
+
+protected:
+  bool atom_fixed(patom_t at) const {
+    return s->state.is_entailed(at) || s->state.is_inconsistent(at);
+  }
+
+  atom_ids& pred_ids(pid_t p) {
+    pid_t pi = p>>1;
+    while(ids.size() <= pi) {
+      pid_t q = ids.size()<<1;
+      ids.push_back(atom_ids(s->state.p_root[q], pval_inv(s->state.p_root[q^1])));
+    }
+    return ids[pi];
+  }
+
+  void release(int ai) {
+    patom_t at(atoms[ai]);
+    pred_ids(at.pid).set(at.val, -1);
+    atoms[ai] = at_Undef;
+    free_slots.push(ai);
+  }
+
+  // Drop everything fixed at the root, not just those that
+  // reach the top of the heap. Only at level 0, where nothing is
+  // pending. Amortized against the number of live atoms.
+  void sweep_root(void) {
+    assert(pending.size() == 0);
+    for(int ai = 0; ai < atoms.size(); ai++) {
+      if(atoms[ai] == at_Undef || !atom_fixed(atoms[ai]))
+        continue;
+      if(heap.inHeap(ai))
+        heap.remove(ai);
+      release(ai);
+    }
+    sweep_lim = std::max(64, 2 * (atoms.size() - free_slots.size()));
   }
 
   solver_data* s;
+
+  vec<patom_t> atoms;
+  vec<double> act;
+  std::vector<atom_ids> ids;
+  vec<int> free_slots;
+  Heap<act_cmp> heap;
+  vec<parked> pending;
+  double inc;
+  int sweep_lim;
+
+  pred_act_brancher fallback;
 };
 
 brancher* pred_act_branch(solver_data* s) {
   return new pred_act_brancher(s);
 }
 
-brancher* atom_act_branch(solver_data* s);
+brancher* atom_act_branch(solver_data* s) {
+  return new atom_act_brancher(s);
+}
+
+void bump_atoms(solver_data* s, double mult, int touched_start) {
+  atom_act_brancher* b(s->atom_act);
+  for(int ti = touched_start; ti < s->persist.touched_preds.size(); ti++) {
+    pid_t p = s->persist.touched_preds[ti];
+    b->bump(patom_t(p, s->state.p_vals[p]), mult);
+  }
+  b->decay();
+}
+
+unsigned int reusable_level(solver_data* s, unsigned int lim) {
+  if(s->branchers.size() > 0)
+    return lim;
+  return s->last_branch->reusable_level(s, lim);
+}
+
 brancher* default_brancher(solver_data* s) {
 //  return new simple_branch();
+  if(s->opts.atom_branch)
+    return atom_act_branch(s);
   return pred_act_branch(s);
 }
 
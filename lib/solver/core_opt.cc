@@ -0,0 +1,451 @@
+#include <climits>
+#include <unordered_map>
+
+#include <geas/solver/solver_data.h>
+#include <geas/solver/core_opt.h>
+#include <geas/constraints/builtins.h>
+#include <geas/constraints/linear-par.h>
+#include <geas/vars/slice.h>
+
+core_options default_core_options = {
+  1.0, // core_ratio
+  50,  // trim_limit
+  20,  // probe_limit
+  1,   // stratify
+  0,   // harden
+};
+
+namespace geas {
+
+typedef intvar::val_t val_t;
+
+// The IntCore reformulation from the fzn frontend. The objective
+// is maintained as
+//   obj_lb + sum_t t.coeff * max(0, t.x - t.lb) + (pending cores)
+// and each t.x is assumed to be at most t.lb.
+class core_engine {
+public:
+  // A term of the reformulated objective.
+  struct oterm {
+    intvar x;
+    int coeff;
+    val_t lb;
+  };
+  // A core which has been factored out: sum xs >= lb at cost coeff.
+  // The penalty variable is only introduced once the core is
+  // violated by some solution (or we're done collecting cores).
+  struct delayed_core {
+    val_t lb;
+    int coeff;
+    vec<intvar> xs;
+  };
+
+  core_engine(solver& _s, const core_options& _o, limits _l,
+              solver::solution_fn _on_sol, void* _ptr)
+    : s(_s), sd(*_s.data), o(_o), l(_l), cl(_l), st0(_s.data->stats),
+      on_sol(_on_sol), ptr(_ptr), stopped(false),
+      k(0), min_coeff(1), obj_lb(0), obj_ub(0) {
+    if(l.time > 0)
+      cl.time = o.core_ratio * l.time;
+    if(l.conflicts > 0)
+      cl.conflicts = std::max(1, (int) (o.core_ratio * l.conflicts));
+  }
+
+  // Set up the terms, given the first solution is in sd.incumbent.
+  void init(vec<int>& ks, vec<intvar>& xs, int _k) {
+    k = _k;
+    obj_lb = k;
+    int max_coeff = 1;
+    for(int ii = 0; ii < xs.size(); ++ii) {
+      if(ks[ii] == 0)
+        continue;
+      intvar x(ks[ii] > 0 ? xs[ii] : -xs[ii]);
+      int c(ks[ii] > 0 ? ks[ii] : -ks[ii]);
+      obj_ks.push(c);
+      obj_xs.push(x);
+      val_t lb(x.lb(sd.ctx0()));
+      obj_lb += c * lb;
+      add_term(x, c, lb);
+      max_coeff = std::max(max_coeff, c);
+    }
+    min_coeff = o.stratify ? max_coeff : 1;
+    obj_ub = eval(sd.incumbent)+1;
+    improve(sd.incumbent);
+  }
+
+  // Collect cores until the lower bound meets the incumbent,
+  // or the core budget is used up.
+  solver::result run(void) {
+    vec<patom_t> core;
+    while(obj_lb < obj_ub) {
+      if(limits_exhausted(cl, st0, sd.stats))
+        return solver::UNKNOWN;
+      core.clear();
+      switch(try_state(core)) {
+        case solver::SAT:
+          if(o.harden && !harden())
+            return solver::SAT;
+          if(!split_cores())
+            decrease_coeff();
+          break;
+        case solver::UNSAT:
+          trim_core(core);
+          // No assumptions involved, so the incumbent is optimal.
+          if(core.size() == 0)
+            return solver::SAT;
+          factor_core(core);
+          break;
+        default:
+          stopped = !limits_exhausted(cl, st0, sd.stats);
+          return solver::UNKNOWN;
+      }
+    }
+    return solver::SAT;
+  }
+
+  // Introduce the pending cores, then run branch-and-bound
+  // on the rebuilt objective with the rest of the budget.
+  solver::result finish(void) {
+    if(stopped || limits_exhausted(l, st0, sd.stats))
+      return solver::UNKNOWN;
+    for(delayed_core& d : pending)
+      apply_core(d);
+    pending.clear();
+    if(obj_lb >= obj_ub)
+      return solver::SAT;
+
+    // r >= obj_lb + sum_t t.coeff * max(0, t.x - t.lb), and r >= obj.
+    intvar r(s.new_intvar(obj_lb, obj_ub-1));
+    vec<int> cs;
+    vec<int_slice> ss;
+    for(const oterm& t : terms) {
+      cs.push(t.coeff);
+      ss.push(int_slice::from_intvar(t.x).re_zero(t.lb));
+    }
+    cs.push(-1);
+    ss.push(int_slice::from_intvar(r));
+    if(!lin_leq<int, int_slice>::post(&sd, cs, ss, -obj_lb))
+      return solver::SAT;
+    vec<int> ks(obj_ks);
+    vec<intvar> xs(obj_xs);
+    ks.push(-1);
+    xs.push(r);
+    if(!linear_le(&sd, ks, xs, -k))
+      return solver::SAT;
+
+    solver::result res = s.minimize(r, limits_remaining(l, st0, sd.stats), 0,
+                                    bb_solution, this);
+    return res == solver::UNSAT ? solver::SAT : res;
+  }
+
+  // Leave the best solution where get_model() finds it.
+  void restore(void) {
+    if(best.vals.size() > 0)
+      sd.incumbent = best;
+  }
+
+protected:
+  val_t eval(const model& m) const {
+    val_t v = k;
+    for(int ii = 0; ii < obj_xs.size(); ++ii)
+      v += obj_ks[ii] * m[obj_xs[ii]];
+    return v;
+  }
+
+  // Any solution we run across (while trimming or probing,
+  // as well) may improve the incumbent.
+  void improve(const model& m) {
+    val_t v = eval(m);
+    if(v < obj_ub) {
+      obj_ub = v;
+      best = m;
+      if(on_sol)
+        on_sol(ptr, best, v);
+    }
+  }
+
+  static void bb_solution(void* ptr, const model& m, val_t) {
+    static_cast<core_engine*>(ptr)->improve(m);
+  }
+
+  limits step_limits(int step) {
+    limits r(limits_remaining(cl, st0, sd.stats));
+    if(r.conflicts == 0 || r.conflicts > step)
+      r.conflicts = step;
+    return r;
+  }
+
+  void add_term(intvar x, int coeff, val_t lb) {
+    if(term_idx.find(x.p) != term_idx.end()) {
+      // Cores are mapped back to terms by predicate, so
+      // a variable with a live term gets a stand-in y >= x.
+      intvar y(s.new_intvar(x.lb(sd.ctx0()), x.ub(sd.ctx0())));
+      vec<int> cs { 1, -1 };
+      vec<intvar> vs { x, y };
+      linear_le(&sd, cs, vs, 0);
+      x = y;
+    }
+    term_idx[x.p] = terms.size();
+    terms.push(oterm { x, coeff, lb });
+  }
+
+  void remove_term(int ti) {
+    term_idx.erase(terms[ti].x.p);
+    if(ti < terms.size()-1) {
+      terms[ti] = terms.last();
+      term_idx[terms[ti].x.p] = ti;
+    }
+    terms.pop();
+  }
+
+  // Solve with each (sufficiently weighted) term at its threshold.
+  solver::result try_state(vec<patom_t>& core) {
+    vec<patom_t> assumps;
+    for(const oterm& t : terms) {
+      if(t.coeff >= min_coeff)
+        assumps.push(t.x <= t.lb);
+    }
+    solver::result r = solver::UNSAT;
+    if(s.assume(assumps.begin(), assumps.end()))
+      r = s.solve(limits_remaining(cl, st0, sd.stats));
+    if(r == solver::SAT)
+      improve(sd.incumbent);
+    else if(r == solver::UNSAT)
+      s.get_conflict(core);
+    s.clear_assumptions();
+    return r;
+  }
+
+  // Drop any atom whose assumption isn't needed for the
+  // conflict (within trim_limit conflicts per check).
+  // The bounds in the original core may not hold for the
+  // trimmed one, so we take the last conflict found instead.
+  void trim_core(vec<patom_t>& core) {
+    if(o.trim_limit <= 0 || core.size() < 2)
+      return;
+    vec<patom_t> keep;
+    vec<patom_t> assumps;
+    vec<patom_t> last;
+    bool trimmed = false;
+    for(int ii = 0; ii < core.size(); ++ii) {
+      if(limits_exhausted(cl, st0, sd.stats))
+        break;
+      assumps.clear();
+      for(patom_t at : keep)
+        assumps.push(~at);
+      for(int jj = ii+1; jj < core.size(); ++jj)
+        assumps.push(~core[jj]);
+      solver::result r = solver::UNSAT;
+      if(s.assume(assumps.begin(), assumps.end()))
+        r = s.solve(step_limits(o.trim_limit));
+      if(r == solver::SAT) {
+        improve(sd.incumbent);
+      } else if(r == solver::UNSAT) {
+        last.clear();
+        s.get_conflict(last);
+        trimmed = true;
+      }
+      s.clear_assumptions();
+      if(r != solver::UNSAT)
+        keep.push(core[ii]);
+    }
+    if(trimmed)
+      last.moveTo(core);
+  }
+
+  // The core says some term must exceed its threshold; move
+  // the smallest coefficient of the core into a delayed core.
+  void factor_core(vec<patom_t>& core) {
+    delayed_core d;
+    int c_min = INT_MAX;
+    val_t delta = 0;
+    val_t sum = 0;
+    for(patom_t at : core) {
+      assert(term_idx.find(at.pid) != term_idx.end());
+      const oterm& t(terms[term_idx[at.pid]]);
+      val_t b = t.x.lb_of_pval(at.val);
+      delta = d.xs.size() == 0 ? b - t.lb : std::min(delta, b - t.lb);
+      c_min = std::min(c_min, t.coeff);
+      sum += t.lb;
+      d.xs.push(t.x);
+    }
+    obj_lb += c_min * delta;
+    for(intvar x : d.xs) {
+      int ti = term_idx[x.p];
+      terms[ti].coeff -= c_min;
+      if(terms[ti].coeff == 0)
+        remove_term(ti);
+    }
+    d.lb = sum + delta;
+    d.coeff = c_min;
+    pending.push(std::move(d));
+  }
+
+  // Core exhaustion: find how far x >= lb can be raised,
+  // doubling the step each time.
+  val_t probe_lb(intvar x, val_t lb) {
+    if(o.probe_limit <= 0)
+      return lb;
+    val_t ub = x.ub(sd.ctx0());
+    val_t step = 0;
+    vec<patom_t> core;
+    while(lb <= ub && !limits_exhausted(cl, st0, sd.stats)) {
+      val_t lb_probe = std::min(ub, lb + step);
+      solver::result r = solver::UNSAT;
+      if(s.assume(x <= lb_probe))
+        r = s.solve(step_limits(o.probe_limit));
+      core.clear();
+      if(r == solver::SAT)
+        improve(sd.incumbent);
+      else if(r == solver::UNSAT)
+        s.get_conflict(core);
+      s.clear_assumptions();
+      if(r != solver::UNSAT)
+        break;
+      lb = lb_probe+1;
+      if(core.size() > 0)
+        lb = std::max(lb, (val_t) x.lb_of_pval(core[0].val));
+      step = 1 + 2*step;
+    }
+    return lb;
+  }
+
+  // p >= sum xs. Over narrow terms (0/1, as from MaxSAT, in
+  // particular) this is a bool_linear_ge on the unary atoms
+  // [x >= v], as in the fzn frontend, which propagates and
+  // explains in terms of the atoms the cores are made of. Wide
+  // terms would need an atom per value, so they (and penalties
+  // over earlier penalties, usually) go through linear_le.
+  void post_penalty(intvar p, const vec<intvar>& xs) {
+    enum { Unary_Lim = 32 };
+    val_t width = 0;
+    for(intvar x : xs)
+      width += x.ub(sd.ctx0()) - x.lb(sd.ctx0());
+    if(width <= Unary_Lim) {
+      vec<int> cs;
+      vec<patom_t> ats;
+      val_t k = 0;
+      for(intvar x : xs) {
+        val_t lb = x.lb(sd.ctx0());
+        k += lb;
+        for(val_t v = lb+1; v <= x.ub(sd.ctx0()); ++v) {
+          cs.push(1);
+          ats.push(x >= v);
+        }
+      }
+      bool_linear_ge(&sd, at_True, p, cs, ats, k);
+    } else {
+      vec<int> cs;
+      vec<intvar> vs(xs);
+      for(int ii = 0; ii < xs.size(); ++ii)
+        cs.push(1);
+      cs.push(-1);
+      vs.push(p);
+      linear_le(&sd, cs, vs, 0);
+    }
+  }
+
+  // Introduce the penalty term for a delayed core.
+  void apply_core(delayed_core& d) {
+    intvar p;
+    if(d.xs.size() == 1) {
+      p = d.xs[0];
+    } else {
+      val_t ub = d.lb + std::max((val_t) 0, obj_ub - obj_lb) / d.coeff;
+      p = s.new_intvar(d.lb, ub);
+      post_penalty(p, d.xs);
+    }
+    val_t lb = probe_lb(p, d.lb);
+    obj_lb += d.coeff * (lb - d.lb);
+    add_term(p, d.coeff, lb);
+  }
+
+  val_t violation(const model& m, const delayed_core& d) const {
+    val_t v = -d.lb;
+    for(intvar x : d.xs)
+      v += m[x];
+    return v;
+  }
+
+  // Introduce the delayed cores violated by the current solution.
+  bool split_cores(void) {
+    vec<delayed_core> vio;
+    int jj = 0;
+    for(int ii = 0; ii < pending.size(); ++ii) {
+      if(violation(sd.incumbent, pending[ii]) > 0)
+        vio.push(std::move(pending[ii]));
+      else if(ii != jj)
+        pending[jj++] = std::move(pending[ii]);
+      else
+        ++jj;
+    }
+    pending.shrink(pending.size() - jj);
+    for(delayed_core& d : vio)
+      apply_core(d);
+    return vio.size() > 0;
+  }
+
+  void decrease_coeff(void) {
+    int c = 1;
+    for(const oterm& t : terms) {
+      if(t.coeff < min_coeff)
+        c = std::max(c, t.coeff);
+    }
+    min_coeff = c;
+  }
+
+  // No improving solution takes a term more than
+  // (obj_ub - obj_lb)/coeff beyond its threshold.
+  bool harden(void) {
+    val_t gap = obj_ub - obj_lb;
+    for(const oterm& t : terms) {
+      val_t x_ub = t.lb + gap / t.coeff;
+      if(x_ub < t.x.ub(sd.ctx0()) && !s.post(t.x <= x_ub))
+        return false;
+    }
+    return true;
+  }
+
+  solver& s;
+  solver_data& sd;
+  const core_options& o;
+  limits l;
+  limits cl; // Budget for the core phase
+  statistics st0;
+  solver::solution_fn on_sol;
+  void* ptr;
+  bool stopped;
+
+  // The original objective, with positive coefficients.
+  vec<int> obj_ks;
+  vec<intvar> obj_xs;
+  int k;
+
+  vec<oterm> terms;
+  std::unordered_map<pid_t, int> term_idx;
+  vec<delayed_core> pending;
+
+  int min_coeff;
+  val_t obj_lb;
+  val_t obj_ub;
+  model best;
+};
+
+solver::result minimize_core(solver& s, vec<int>& ks, vec<intvar>& xs, int k,
+                             limits l, const core_options& o,
+                             solver::solution_fn on_sol, void* ptr) {
+  core_engine e(s, o, l, on_sol, ptr);
+  solver::result r = s.solve(l);
+  if(r != solver::SAT)
+    return r;
+  // Terms and constraints are added at the root.
+  s.clear_assumptions();
+  e.init(ks, xs, k);
+  r = o.core_ratio > 0 ? e.run() : solver::UNKNOWN;
+  if(r == solver::UNKNOWN)
+    r = e.finish();
+  e.restore();
+  return r;
+}
+
+}
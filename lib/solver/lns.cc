@@ -0,0 +1,204 @@
+#include <algorithm>
+
+#include <geas/solver/solver_data.h>
+#include <geas/solver/lns.h>
+
+lns_options default_lns_options = {
+  200,  // conflicts
+  0.7,  // fix_ratio
+  0.05, // fix_step
+  1,    // guided
+  1,    // seed
+};
+
+namespace geas {
+
+typedef intvar::val_t val_t;
+
+class lns_engine {
+public:
+  lns_engine(solver& _s, intvar _obj, vec<intvar>& _xs, const lns_options& o,
+             limits _l, solver::solution_fn _on_sol, void* _ptr)
+    : s(_s), sd(*_s.data), obj(_obj), xs(_xs), l(_l), st0(_s.data->stats),
+      on_sol(_on_sol), ptr(_ptr),
+      budget(std::max(1, o.conflicts)),
+      ratio(std::min(1.0, std::max(0.0, o.fix_ratio))), step(o.fix_step),
+      guided(o.guided), seed(o.seed ? o.seed : 1) { }
+
+  solver::result run(void) {
+    incumbent = sd.incumbent;
+    best = incumbent[obj];
+    vec<patom_t> core;
+    while(!limits_exhausted(l, st0, sd.stats)) {
+      // Only improving solutions from here on.
+      s.clear_assumptions();
+      if(!s.post(obj < best))
+        return solver::SAT;
+
+      core.clear();
+      bool complete = fix_count() == 0;
+      bool improved = false;
+      statistics nb0(sd.stats);
+      solver::result r = solver::UNSAT;
+      if(fix_neighbourhood()) {
+        // Improve within the neighbourhood for as long
+        // as the budget allows.
+        while(true) {
+          limits nl(complete ? limits_remaining(l, st0, sd.stats) : step_limits(nb0));
+          if(nl.conflicts < 0 || limits_exhausted(l, st0, sd.stats)) {
+            r = solver::UNKNOWN;
+            break;
+          }
+          r = s.solve(nl);
+          if(r != solver::SAT)
+            break;
+          improve();
+          improved = true;
+          // As in solver::minimize, the bound is posted by solve,
+          // keeping the assumptions (and whatever else it can).
+          sd.obj_bound = obj < best;
+        }
+      }
+      if(r == solver::UNSAT) {
+        s.get_conflict(core);
+        // No assumptions involved, so the incumbent is optimal.
+        if(core.size() == 0)
+          return solver::SAT;
+        // Nothing (else) to find here; look further afield.
+        ratio = std::max(0.0, ratio - step);
+      } else if(complete) {
+        return solver::UNKNOWN;
+      } else if(!improved) {
+        ratio = std::min(1.0, ratio + step);
+        budget += budget/8 + 1;
+      }
+    }
+    return solver::UNKNOWN;
+  }
+
+  // Leave the best solution where get_model() finds it.
+  void restore(void) {
+    s.clear_assumptions();
+    sd.obj_bound = at_Undef;
+    sd.incumbent = incumbent;
+  }
+
+protected:
+  unsigned int random(void) {
+    seed ^= seed << 13; seed ^= seed >> 17; seed ^= seed << 5;
+    return seed;
+  }
+
+  int fix_count(void) const { return (int) (ratio * xs.size()); }
+
+  void improve(void) {
+    incumbent = sd.incumbent;
+    best = incumbent[obj];
+    if(on_sol)
+      on_sol(ptr, incumbent, best);
+  }
+
+  // What remains of the budget for the current neighbourhood
+  // (started at nb0); negative conflicts once it is used up.
+  limits step_limits(const statistics& nb0) {
+    limits r(limits_remaining(l, st0, sd.stats));
+    int left = budget - (sd.stats.conflicts - nb0.conflicts);
+    if(left <= 0)
+      r.conflicts = -1;
+    else if(r.conflicts == 0 || r.conflicts > left)
+      r.conflicts = left;
+    return r;
+  }
+
+  // Assume some of the xs take their incumbent values.
+  // Returns false if the assumptions are already inconsistent.
+  bool fix_neighbourhood(void) {
+    int target = fix_count();
+    if(target == 0)
+      return true;
+
+    // A random prefix of a random permutation.
+    order.clear();
+    for(int ii = 0; ii < xs.size(); ++ii)
+      order.push(ii);
+    for(int ii = 0; ii < order.size(); ++ii)
+      std::swap(order[ii], order[ii + random() % (order.size() - ii)]);
+
+    if(!guided) {
+      vec<patom_t> as;
+      for(int ii = 0; ii < target; ++ii) {
+        intvar x(xs[order[ii]]);
+        val_t v(incumbent[x]);
+        as.push(x >= v);
+        as.push(x <= v);
+      }
+      return s.assume(as.begin(), as.end());
+    }
+
+    // Assume one at a time; anything fixed by propagation
+    // in the meantime counts towards the target. A value which
+    // cannot improve on the incumbent (given the rest) is
+    // left free instead.
+    int fixed = 0;
+    for(int ii = 0; ii < order.size() && fixed < target; ++ii) {
+      intvar x(xs[order[ii]]);
+      if(x.lb(&sd) == x.ub(&sd)) {
+        ++fixed;
+        continue;
+      }
+      val_t v(incumbent[x]);
+      if(!s.assume(x >= v)) {
+        if(!sd.solver_is_consistent)
+          return false;
+        s.retract();
+        continue;
+      }
+      if(!s.assume(x <= v)) {
+        s.retract();
+        s.retract();
+        continue;
+      }
+      ++fixed;
+    }
+    return true;
+  }
+
+  solver& s;
+  solver_data& sd;
+  intvar obj;
+  vec<intvar>& xs;
+  limits l;
+  statistics st0;
+  solver::solution_fn on_sol;
+  void* ptr;
+
+  int budget;
+  double ratio;
+  double step;
+  int guided;
+  unsigned int seed;
+
+  // The best solution so far, which neighbourhoods are built around.
+  model incumbent;
+  val_t best;
+
+  vec<int> order;
+};
+
+solver::result minimize_lns(solver& s, intvar obj, vec<intvar>& xs,
+                            limits l, const lns_options& o,
+                            solver::solution_fn on_sol, void* ptr) {
+  if(s.data->stats.solutions == 0) {
+    solver::result r = s.solve(l);
+    if(r != solver::SAT)
+      return r;
+    if(on_sol)
+      on_sol(ptr, s.data->incumbent, s.data->incumbent[obj]);
+  }
+  lns_engine e(s, obj, xs, o, l, on_sol, ptr);
+  solver::result r = e.run();
+  e.restore();
+  return r;
+}
+
+}
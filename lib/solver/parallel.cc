@@ -0,0 +1,379 @@
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <geas/solver/parallel.h>
+#include <geas/solver/solver_data.h>
+#include <geas/vars/intvar.h>
+
+namespace geas {
+
+parallel_options default_parallel_options = {
+  4, // num_workers
+  8, // share_size
+};
+
+// Atoms are exchanged in a canonical form. Predicates created while
+// building the model have the same pid in every worker. Lazily
+// introduced equality atoms are named by (variable index, value)
+// instead, flagged by EQ_FLAG in the pid field.
+enum { EQ_FLAG = 1u<<31 };
+
+learnt_exchange::learnt_exchange(int workers)
+  : num_workers(workers),
+    rings(new ring[workers]),
+    cursors(new uint64_t[workers * workers]) {
+  for(int wi = 0; wi < workers; ++wi) {
+    rings[wi].head.store(0, std::memory_order_relaxed);
+    for(slot& sl : rings[wi].slots)
+      sl.seq.store(0, std::memory_order_relaxed);
+  }
+  for(int ii = 0; ii < workers * workers; ++ii)
+    cursors[ii] = 0;
+}
+
+learnt_exchange::~learnt_exchange(void) {
+  delete[] rings;
+  delete[] cursors;
+}
+
+void learnt_exchange::publish(int w, const vec<patom_t>& lits) {
+  assert(lits.size() <= MAX_LITS);
+  ring& r(rings[w]);
+  uint64_t t = r.head.load(std::memory_order_relaxed);
+  slot& sl(r.slots[t % RING_SZ]);
+
+  // Odd sequence numbers mark a slot being written.
+  sl.seq.store(2*t+1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  sl.sz.store(lits.size(), std::memory_order_relaxed);
+  for(int ii = 0; ii < lits.size(); ++ii) {
+    sl.pids[ii].store(lits[ii].pid, std::memory_order_relaxed);
+    sl.vals[ii].store(lits[ii].val, std::memory_order_relaxed);
+  }
+  sl.seq.store(2*t+2, std::memory_order_release);
+  r.head.store(t+1, std::memory_order_release);
+}
+
+void learnt_exchange::collect(int w, vec< vec<patom_t> >& out) {
+  for(int src = 0; src < num_workers; ++src) {
+    if(src == w)
+      continue;
+    ring& r(rings[src]);
+    uint64_t& cursor(cursors[w * num_workers + src]);
+    uint64_t head = r.head.load(std::memory_order_acquire);
+    // Anything older than RING_SZ has been overwritten.
+    if(head > RING_SZ && cursor < head - RING_SZ)
+      cursor = head - RING_SZ;
+
+    for(; cursor < head; ++cursor) {
+      slot& sl(r.slots[cursor % RING_SZ]);
+      uint64_t seq = sl.seq.load(std::memory_order_acquire);
+      if(seq != 2*cursor+2)
+        continue;
+      out.push();
+      vec<patom_t>& cl(out.last());
+      unsigned int sz = sl.sz.load(std::memory_order_relaxed);
+      if(sz > MAX_LITS)
+        sz = MAX_LITS;
+      for(unsigned int ii = 0; ii < sz; ++ii)
+        cl.push(patom_t(sl.pids[ii].load(std::memory_order_relaxed),
+                        sl.vals[ii].load(std::memory_order_relaxed)));
+      std::atomic_thread_fence(std::memory_order_acquire);
+      // Overwritten while we were reading it.
+      if(sl.seq.load(std::memory_order_relaxed) != seq)
+        out.pop();
+    }
+  }
+}
+
+struct parallel_solver::worker_t {
+  worker_t(parallel_solver* _ps, int _id, options& _opts)
+    : ps(_ps), id(_id), s(_opts), shared_preds(0),
+      num_exported(0), num_imported(0),
+      refuted(false), res(solver::UNKNOWN) { }
+
+  parallel_solver* ps;
+  int id;
+  solver s;
+  int share_size;
+
+  // Predicates which existed after the model was built.
+  pid_t shared_preds;
+
+  vec<patom_t> out_buf;
+  vec< vec<patom_t> > in_buf;
+  vec<clause_elt> cl_buf;
+
+  int num_exported;
+  int num_imported;
+
+  bool refuted; // An imported clause is false at the root.
+  solver::result res;
+};
+
+// Translate an atom to/from the canonical form.
+static bool export_atom(parallel_solver::worker_t* w, patom_t at, patom_t& out) {
+  if(at.pid < w->shared_preds) {
+    out = at;
+    return true;
+  }
+  intvar_manager::eq_key k;
+  if(!get_ivar_man(w->s.data)->lazy_eq_key(at.pid, k))
+    return false;
+  // Equality atoms are Boolean; we only exchange [b] and ~[b].
+  patom_t b((at.pid&1) ? ~at : at);
+  if(b.val != from_int(1))
+    return false;
+  out = patom_t(EQ_FLAG | (k.var_idx<<1) | (at.pid&1), k.val);
+  return true;
+}
+
+static patom_t import_atom(parallel_solver::worker_t* w, patom_t at) {
+  if(!(at.pid & EQ_FLAG))
+    return at.pid < (pid_t) num_preds(w->s.data) ? at : at_Undef;
+  intvar_manager::eq_key k { (int) ((at.pid & ~EQ_FLAG)>>1), at.val };
+  patom_t eq(get_ivar_man(w->s.data)->find_eqatom(k));
+  if(eq == at_Undef)
+    return at_Undef;
+  return (at.pid&1) ? ~eq : eq;
+}
+
+static void export_learnt(void* ptr, vec<clause_elt>& learnt) {
+  parallel_solver::worker_t* w(static_cast<parallel_solver::worker_t*>(ptr));
+  // Glue clauses are worth sharing even if they're long.
+  if(learnt.size() > w->share_size
+     && (learnt.size() > learnt_exchange::MAX_LITS
+         || w->s.data->confl.learnt_lbd > w->s.data->opts.lbd_core))
+    return;
+
+  w->out_buf.clear();
+  for(clause_elt e : learnt) {
+    patom_t at;
+    if(!export_atom(w, e.atom(), at))
+      return;
+    w->out_buf.push(at);
+  }
+  w->ps->get_exchange().publish(w->id, w->out_buf);
+  ++w->num_exported;
+}
+
+// Only called at the root.
+static void import_learnts(parallel_solver::worker_t* w) {
+  solver_data* s(w->s.data);
+  assert(s->infer.trail_lim.size() == 0);
+
+  w->in_buf.clear();
+  w->ps->get_exchange().collect(w->id, w->in_buf);
+  for(vec<patom_t>& cl : w->in_buf) {
+    w->cl_buf.clear();
+    for(patom_t at : cl) {
+      patom_t l(import_atom(w, at));
+      if(l == at_Undef)
+        goto next_clause;
+      w->cl_buf.push(l);
+    }
+    if(!add_clause(*s, w->cl_buf)) {
+      w->refuted = true;
+      return;
+    }
+    ++w->num_imported;
+  next_clause:
+    continue;
+  }
+}
+
+static void worker_on_restart(void* ptr) {
+  parallel_solver::worker_t* w(static_cast<parallel_solver::worker_t*>(ptr));
+  import_learnts(w);
+  if(w->refuted)
+    w->s.abort();
+}
+
+// Make the workers search differently: perturb the initial
+// predicate activities and, for odd workers, the default phase.
+static void diversify(solver_data* s, int id) {
+  if(id == 0)
+    return;
+  uint64_t seed = 0x9E3779B97F4A7C15ULL * (id+1);
+  for(int pi = 0; pi < s->infer.pred_act.size(); ++pi) {
+    seed ^= seed << 13; seed ^= seed >> 7; seed ^= seed << 17;
+    s->infer.pred_act[pi] += 1e-3 * ((double) (seed % 1024)) / 1024;
+    if(s->pred_heap.inHeap(pi))
+      s->pred_heap.decrease(pi);
+  }
+  if(id&1) {
+    for(auto& pol : s->polarity) {
+      if(!pol.has_preference)
+        pol.branch = 1;
+    }
+  }
+}
+
+static options worker_options(const options& opts, int id) {
+  options o(opts);
+  switch(id % 4) {
+    case 1:
+      o.restart_limit = std::max(1, o.restart_limit/2);
+      o.restart_growthrate = 1.1;
+      if(o.restart_policy == RESTART_AUTO)
+        o.restart_policy = RESTART_LUBY;
+      break;
+    case 2:
+      o.restart_limit *= 2;
+      o.restart_growthrate = 1.02;
+      if(o.restart_policy == RESTART_AUTO)
+        o.restart_policy = RESTART_INNER_OUTER;
+      break;
+    case 3:
+      o.restart_growthrate = 1.2;
+      o.learnt_growthrate = 1.05;
+      break;
+    default:
+      break;
+  }
+  return o;
+}
+
+parallel_solver::parallel_solver(model_builder build, void* data,
+    const parallel_options& popts, const options& opts)
+  : exchange(popts.num_workers), finished(false), win(-1) {
+  for(int wi = 0; wi < popts.num_workers; ++wi) {
+    options o(worker_options(opts, wi));
+    worker_t* w(new worker_t(this, wi, o));
+    w->share_size = std::min((int) learnt_exchange::MAX_LITS, popts.share_size);
+    workers.push(w);
+
+    if(!build(w->s, wi, data))
+      w->refuted = true;
+    solver_data* s(w->s.data);
+    s->is_worker = true;
+    w->shared_preds = num_preds(s);
+    diversify(s, wi);
+    s->on_learnt.push(learnt_callback(export_learnt, w));
+    s->on_restart.push(event_callback(worker_on_restart, w));
+  }
+}
+
+parallel_solver::~parallel_solver(void) {
+  for(worker_t* w : workers)
+    delete w;
+}
+
+solver& parallel_solver::worker(int wi) { return workers[wi]->s; }
+
+int parallel_solver::num_exported(void) const {
+  int n = 0;
+  for(worker_t* w : workers)
+    n += w->num_exported;
+  return n;
+}
+
+int parallel_solver::num_imported(void) const {
+  int n = 0;
+  for(worker_t* w : workers)
+    n += w->num_imported;
+  return n;
+}
+
+solver::result parallel_solver::solve(limits l) {
+  std::mutex m;
+  std::condition_variable cv;
+  int num_done = 0;
+
+  finished = false;
+  win = -1;
+  // Workers don't clear their own abort flags, so an abort
+  // before a worker starts searching still takes effect.
+  for(worker_t* w : workers)
+    w->s.data->abort_solve = 0;
+  clear_sigint();
+  set_handlers();
+
+  vec<std::thread*> threads;
+  for(worker_t* w : workers) {
+    threads.push(new std::thread([w, l, this, &m, &cv, &num_done](void) {
+      solver::result r = solver::UNKNOWN;
+      if(!w->refuted && !finished) {
+        if(w->s.level() > 0)
+          w->s.restart();
+        import_learnts(w);
+        if(!w->refuted)
+          r = w->s.solve(l);
+      }
+      if(w->refuted)
+        r = solver::UNSAT;
+
+      std::lock_guard<std::mutex> lk(m);
+      w->res = r;
+      ++num_done;
+      if(r != solver::UNKNOWN && win < 0) {
+        win = w->id;
+        finished = true;
+      }
+      cv.notify_all();
+    }));
+  }
+
+  {
+    // The workers don't watch for SIGINT; we forward it.
+    std::unique_lock<std::mutex> lk(m);
+    while(!cv.wait_for(lk, std::chrono::milliseconds(10),
+                       [&](void) { return finished || num_done == workers.size(); })) {
+      if(sigint_caught())
+        break;
+    }
+  }
+  abort();
+  for(std::thread* t : threads) {
+    t->join();
+    delete t;
+  }
+  clear_handlers();
+  clear_sigint();
+
+  if(win < 0)
+    return solver::UNKNOWN;
+  return workers[win]->res;
+}
+
+void parallel_solver::abort(void) {
+  for(worker_t* w : workers)
+    w->s.abort();
+}
+
+model parallel_solver::get_model(void) {
+  assert(win >= 0);
+  return workers[win]->s.get_model();
+}
+
+statistics parallel_solver::get_statistics(void) const {
+  statistics st = {};
+  for(worker_t* w : workers) {
+    statistics& ws(w->s.data->stats);
+    st.conflicts += ws.conflicts;
+    st.restarts += ws.restarts;
+    st.solutions += ws.solutions;
+    st.time = std::max(st.time, ws.time);
+    st.num_learnts += ws.num_learnts;
+    st.num_learnt_lits += ws.num_learnt_lits;
+    st.num_core += ws.num_core;
+    st.num_tier2 += ws.num_tier2;
+    for(int ii = 0; ii < GEAS_LBD_HIST; ++ii)
+      st.lbd_hist[ii] += ws.lbd_hist[ii];
+    st.minimized_lits += ws.minimized_lits;
+    st.reused_levels += ws.reused_levels;
+    st.replay_time += ws.replay_time;
+    st.inprocess_lits += ws.inprocess_lits;
+    st.inprocess_subsumed += ws.inprocess_subsumed;
+    st.inprocess_time += ws.inprocess_time;
+    st.watches_freed += ws.watches_freed;
+    st.watch_mem_freed += ws.watch_mem_freed;
+    st.equiv_atoms += ws.equiv_atoms;
+    st.equiv_preds += ws.equiv_preds;
+    st.failed_lits += ws.failed_lits;
+  }
+  return st;
+}
+
+}
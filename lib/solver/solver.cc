@@ -2,7 +2,13 @@
 #include <algorithm>
 #include <csignal>
 #include <climits>
+#include <map>
 #include <math.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
 #include <geas/solver/solver.h>
 #include <geas/solver/solver_data.h>
 #include <geas/solver/solver_debug.h>
@@ -17,9 +23,6 @@
 //#define INLINE_ATTR forceinline
 //#define INLINE_SATTR static INLINE_ATTR
 
-#define KEEP_GLUE
-// #define RESTART_LUBY
-
 // Default options
 options default_options = {
   // 50000, // int learnt_dbmax; 
@@ -34,12 +37,25 @@ options default_options = {
 
   1000, // int restart_limit;
   1.05, // double restart_growthrate;
+  RESTART_AUTO, // restart_kind restart_policy;
 
   1,     // one_watch
   0,     // global_diff
 
 //  200, // eager_threshold
    10, // eager_threshold
+
+  2, // lbd_core
+  6, // lbd_tier2
+  1, // learnt_minimize
+
+  1, // restart_reuse
+  1, // adaptive_priority
+  0, // atom_branch
+  0, // inprocess_effort
+  1, // bin_equiv
+
+  0, // prop_profile
 };
 
 limits no_limit = {
@@ -53,6 +69,11 @@ using std::endl;
 using std::min;
 using std::max;
 using std::sort;
+using std::lower_bound;
+using std::upper_bound;
+using std::unique;
+using std::pair;
+using std::make_pair;
 
 #ifdef LOG_RESTART
 static double domains_total = 0;
@@ -75,11 +96,19 @@ void set_handlers(void) {
 void clear_handlers(void) {
   signal(SIGINT, SIG_DFL);
 }
+bool sigint_caught(void) { return global_abort; }
+void clear_sigint(void) { global_abort = 0; }
 
 pval_t patom_t::val_max = pval_max;
 
 typedef solver_data sdata;
 
+// Parallel workers leave the handler to the front-end.
+static inline void release_handlers(sdata& s) {
+  if(!s.is_worker)
+    clear_handlers();
+}
+
 // #define MANAGERS_MAX 10
 struct man_template_t {
   void* (*create)(solver_data* s);
@@ -153,17 +182,21 @@ solver_data::solver_data(const options& _opts)
     : opts(_opts),
       stats(),
       active_prop(nullptr),
+      atom_act(nullptr),
       last_branch(default_brancher(this)), 
       pred_heap(act_cmp { infer.pred_act }),
       queue_has_prop(0),
       // Assumption handling
       assump_end(0),
       init_end(0), init_saved(0),
+      obj_bound(at_Undef),
       // Dynamic parameters
       learnt_act_inc(opts.learnt_act_inc),
       pred_act_inc(opts.pred_act_inc),
       learnt_dbmax(opts.learnt_dbmax),
-      abort_solve(0),
+      next_watch_sweep(0),
+      equiv_imps(-1),
+      abort_solve(0), is_worker(false),
       solver_is_consistent(1) {
   new_pred(*this, 0, 0);
   man_registry& r(get_reg());
@@ -210,7 +243,7 @@ std::ostream& operator<<(std::ostream& o, const patom_t& at) {
   return o;
 }
 std::ostream& operator<<(std::ostream& o, const clause_elt& e) {
-  o << e.atom;
+  o << e.atom();
   return o;
 }
 
@@ -226,6 +259,66 @@ struct stat_reporter {
   solver_data* s;
 };
 
+// Timestamp for propagator profiling (only taken with
+// opts.prop_profile).
+static inline uint64_t prof_clock(void) {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+void solver::get_propagator_profile(vec<prop_profile>& out) {
+  out.clear();
+  std::map<const char*, int> kind_idx;
+  vec<prop_profile> ps;
+  for(propagator* p : data->propagators) {
+    const char* kind = p->kind();
+    auto it = kind_idx.find(kind);
+    if(it == kind_idx.end()) {
+      it = kind_idx.insert(make_pair(kind, ps.size())).first;
+      ps.push(prop_profile { kind, 0, 0, 0, 0, 0, 0, 0 });
+    }
+    prop_profile& k(ps[it->second]);
+    k.count++;
+    k.wakeups += p->prof.wakeups;
+    k.execs += p->prof.execs;
+    k.cycles += p->prof.cycles;
+    k.prunings += p->prof.prunings;
+    k.conflicts += p->prof.conflicts;
+    k.explains += p->prof.explains;
+  }
+  // Most expensive first.
+  std::sort(ps.begin(), ps.end(),
+    [](const prop_profile& i, const prop_profile& j) { return i.cycles > j.cycles; });
+  for(const prop_profile& k : ps)
+    out.push(k);
+}
+
+// One line per kind of propagator, as key=value pairs.
+void print_propagator_profile(solver& s, FILE* f) {
+  vec<prop_profile> ps;
+  s.get_propagator_profile(ps);
+  for(const prop_profile& p : ps) {
+    fprintf(f, "%%%%%%geas-prop: kind=%s count=%d wakeups=%lld execs=%lld cycles=%lld"
+               " prunings=%lld conflicts=%lld explains=%lld\n",
+      p.kind, p.count, p.wakeups, p.execs, p.cycles,
+      p.prunings, p.conflicts, p.explains);
+  }
+}
+
+struct prof_reporter {
+  prof_reporter(solver& _s)
+    : s(_s) { }
+
+  ~prof_reporter(void) {
+    if(s.data->opts.prop_profile)
+      print_propagator_profile(s, stderr);
+  }
+  solver& s;
+};
+
 // Record that the value of p has changed at the
 // current decision level.
 INLINE_SATTR void touch_pred(solver_data& s, pid_t p) {
@@ -274,6 +367,7 @@ static pid_t alloc_pred(sdata& s, pval_t lb, pval_t ub, unsigned char flags) {
     s.pred_heap.insert(pi>>1);
 
   s.polarity.push();
+  s.polarity.last().nobranch = (flags&PR_NOBRANCH) != 0;
   
   queue_pred(&s, pi);
   queue_pred(&s, pi^1);
@@ -326,8 +420,7 @@ pid_t new_pred(sdata& s, pred_init init_lb, pred_init init_ub, unsigned char fla
     // s.init_end++;
     push_init(s, pinit_data { p, init_lb });
     if(lb != s.state.p_last[p]) {
-      infer_info::entry e = { p, s.state.p_last[p], init_lb.expl() };
-      s.infer.trail.push(e);
+      s.infer.push_trail(p, s.state.p_last[p], init_lb.expl());
       // s.persist.pred_ltrail.push(persistence::pred_entry {p, last});
       touch_pred(s, p);
     }
@@ -338,8 +431,7 @@ pid_t new_pred(sdata& s, pred_init init_lb, pred_init init_ub, unsigned char fla
     // s.init_end++;
     push_init(s, pinit_data { p^1, init_ub });
     if(ub != s.state.p_last[p^1]) {
-      infer_info::entry e = { p^1, s.state.p_last[p^1], init_ub.expl() };
-      s.infer.trail.push(e);
+      s.infer.push_trail(p^1, s.state.p_last[p^1], init_ub.expl());
       // s.persist.pred_ltrail.push(persistence::pred_entry {p^1, last});
       touch_pred(s, p);
     }
@@ -391,8 +483,7 @@ void process_initializers(solver_data& s) {
       s.wake_vals[p] = curr;
 
       if(curr != last) {
-        infer_info::entry e = { p, last, inits[ii].init.expl() };
-        s.infer.trail.push(e);
+        s.infer.push_trail(p, last, inits[ii].init.expl());
         // Shouldn't be needed, because the initializer will be called again.
         // s.persist.pred_ltrail.push(persistence::pred_entry {p, last});
         touch_pred(s, p);
@@ -451,11 +542,11 @@ void set_confl(sdata& s, patom_t p, reason r, vec<clause_elt>& confl) {
 retry_level:
 #ifdef CHECK_STATE
   for(clause_elt& e : confl) {
-    assert(s.state.is_inconsistent(e.atom));
+    assert(s.state.is_inconsistent(e.atom()));
   }
 #endif
   for(clause_elt& e : confl) {
-    if(!s.state.is_inconsistent_prev(e.atom))
+    if(!s.state.is_inconsistent_prev(e.atom()))
       return;
   }
   // Nothing at the current level: find the appropriate level.
@@ -735,7 +826,7 @@ bool _enqueue(sdata& s, patom_t p, reason r) {
 
   // infer_info::entry e = { p.pid, old_val, r };
   // s.infer.trail.push(e);
-  s.infer.trail.push(infer_info::entry { p.pid, old_val, r });
+  s.infer.push_trail(p.pid, old_val, r);
 #ifdef PROOF_LOG
   // e.expl.origin = s.log.active_constraint;
   s.infer.trail.last().expl.origin = s.log.active_constraint;
@@ -748,97 +839,97 @@ bool _enqueue(sdata& s, patom_t p, reason r) {
   return true;
 }
 
-// Modifies elt.watch;
-INLINE_SATTR vec<clause_head>& find_watchlist(solver_data& s, clause_elt& elt) {
-  // Find the appropriate watch_node.
-#ifdef CACHE_WATCH
-  if(elt.watch) {
-#ifdef DEBUG_WMAP
-    assert(elt.watch->curr_val == ~(elt.atom).val);
-#endif
-    return elt.watch->ws;
-  }
-#endif
-
-  patom_t p(~elt.atom);
+// Find the watch_node for ~elt, caching it in elt.watch.
+static watch_node* elt_watch(solver_data& s, clause_elt& elt) {
+  if(elt.watch)
+    return s.infer.deref_watch(elt.watch);
+  patom_t p(~elt.atom());
   watch_node* watch = s.infer.get_watch(p.pid, p.val);
-#ifdef DEBUG_WMAP
-  assert(watch->curr_val == ~(elt.atom).val);
-#endif
-#ifdef CACHE_WATCH
-  elt.watch = watch;
-#endif
-  return watch->ws;
+  elt.watch = s.infer.watch_ref(watch);
+  return watch;
 }
 
-/* static */
-__attribute__((noinline)) vec<clause_head>& lookup_watchlist(solver_data& s, clause_elt& elt) {
-  // Find the appropriate watch_node.
-#ifdef CACHE_WATCH
-  if(elt.watch) {
-#ifdef DEBUG_WMAP
-    assert(elt.watch->curr_val == ~(elt.atom).val);
-#endif
-    return elt.watch->ws;
-  }
-#endif
+// Modifies elt.watch;
+INLINE_SATTR watch_buf& find_watchlist(solver_data& s, clause_elt& elt) {
+  return elt_watch(s, elt)->ws;
+}
 
-  patom_t p(~elt.atom);
+/* static */
+__attribute__((noinline)) watch_buf& lookup_watchlist(solver_data& s, clause_elt& elt) {
+  if(elt.watch)
+    return s.infer.deref_watch(elt.watch)->ws;
+  patom_t p(~elt.atom());
   watch_node* watch = s.infer.lookup_watch(p.pid, p.val);
-#ifdef DEBUG_WMAP
-  assert(watch->curr_val == ~(elt.atom).val);
-#endif
-#ifdef CACHE_WATCH
-  elt.watch = watch;
-#endif
+  elt.watch = s.infer.watch_ref(watch);
   return watch->ws;
 }
 
+// Watch a binary clause, as an implication each way.
+static void attach_binary(solver_data& s, clause_elt& x, clause_elt& y) {
+  find_watchlist(s, x).push_bin(y.atom());
+  find_watchlist(s, y).push_bin(x.atom());
+  ++s.infer.num_imps;
+}
 
-/* static */
-__attribute__((noinline)) vec<patom_t>& find_bin_watchlist(solver_data& s, clause_elt& elt) {
-  // Find the appropriate watch_node.
-#ifdef CACHE_WATCH
-  if(elt.watch) {
-#ifdef DEBUG_WMAP
-    assert(elt.watch->curr_val == ~(elt.atom).val);
-#endif
-    return elt.watch->bin_ws;
-  }
-#endif
+// Watch a ternary clause on all three literals.
+static void attach_ternary(solver_data& s, cref cr) {
+  clause& c(s.infer.arena[cr]);
+  c.extra.ternary = 1;
+  find_watchlist(s, c[0]).push_tern(tern_watch(c[1].atom(), c[2].atom(), cr));
+  find_watchlist(s, c[1]).push_tern(tern_watch(c[0].atom(), c[2].atom(), cr));
+  find_watchlist(s, c[2]).push_tern(tern_watch(c[0].atom(), c[1].atom(), cr));
+}
 
-  patom_t p(~elt.atom);
-  watch_node* watch = s.infer.get_watch(p.pid, p.val);
-#ifdef DEBUG_WMAP
-  assert(watch->curr_val == ~(elt.atom).val);
-#endif
-#ifdef CACHE_WATCH
-  elt.watch = watch;
-#endif
-  return watch->bin_ws;
+// Some literal of each ternary clause in ws has become false.
+static bool propagate_ternary(solver_data& s, watch_buf& ws) {
+  for(const tern_watch& t : ws.tern()) {
+    patom_t x(t.x());
+    patom_t y(t.y());
+    if(s.state.is_entailed(x) || s.state.is_entailed(y))
+      continue;
+    patom_t u;
+    if(s.state.is_inconsistent(x))
+      u = y;
+    else if(s.state.is_inconsistent(y))
+      u = x;
+    else
+      continue;
+    // Only now look at the clause: the propagated
+    // literal must come first in the reason.
+    clause& c(s.infer.arena[t.c]);
+    if(c[0].atom() != u) {
+      clause_elt& e(c[1].atom() == u ? c[1] : c[2]);
+      clause_elt tmp(e);
+      e = c[0];
+      c[0] = tmp;
+    }
+    if(!enqueue(s, u, &c))
+      return false;
+  }
+  return true;
 }
 
 INLINE_SATTR
 bool update_watchlist(solver_data& s,
-    clause_elt elt, vec<clause_head>& ws) {
+    clause_elt elt, watch_buf& ws) {
 #ifdef CHECK_STATE
-  assert(s.state.is_inconsistent(elt.atom));
+  assert(s.state.is_inconsistent(elt.atom()));
 #endif
-  int jj = 0;
-  int ii;
-  for(ii = 0; ii < ws.size(); ii++) {
-    clause_head& ch = ws[ii];
-    if(s.state.is_entailed(ch.e0)) {
+  unsigned int jj = 0;
+  unsigned int ii;
+  for(ii = 0; ii < ws.num_long(); ii++) {
+    clause_head& ch = ws.long_at(ii);
+    if(s.state.is_entailed(ch.e0())) {
       // If the clause is satisfied, just
       // copy the watch and keep going;
-      ws[jj++] = ch;
+      ws.long_at(jj++) = ch;
       continue;
     }
 
     /*
     if(!ch.c) {
       // Binary clause.
-      if(!enqueue(s, ch.e0, elt.atom)) {
+      if(!enqueue(s, ch.e0(), elt.atom())) {
         // Copy remaining watches and signal conflict.
         for(; ii < ws.size(); ii++)
           ws[jj++] = ws[ii];
@@ -850,26 +941,24 @@ bool update_watchlist(solver_data& s,
     }
     */
     // Normal case: look for a new watch
-    clause& c(*ch.c);
-    // if(c[1].atom != elt.atom) {
-    if(c[1].atom.pid != elt.atom.pid) {
-#ifdef CACHE_WATCH
-      elt.watch = c[0].watch;
-#endif
+    clause& c(s.infer.arena[ch.c]);
+    // if(c[1].atom() != elt.atom()) {
+    // Take the false literal from the clause, so we keep
+    // its cached watch.
+    if(c[1].atom().pid != elt.atom().pid) {
+      elt = c[0];
       c[0] = c[1];
     } else {
-#ifdef CACHE_WATCH
-      elt.watch = c[1].watch;
-#endif
+      elt = c[1];
     }
 
     /*
-    if(s.state.is_entailed(c[0].atom)) {
+    if(s.state.is_entailed(c[0].atom())) {
       // If we've found something true, don't bother
       // updating the watches: just record the satisfying atom
       // in the head.
       c[1] = elt;
-      ch.e0 = c[0].atom;
+      ch.set_e0(c[0].atom());
       ws[jj++] = ch;
       goto next_clause;
     }
@@ -877,14 +966,14 @@ bool update_watchlist(solver_data& s,
 
     /*
     for(int li = 2; li < c.size(); li++) {
-      if(!s.state.is_inconsistent(c[li].atom)) {
+      if(!s.state.is_inconsistent(c[li].atom())) {
         // Literal is not yet false. New watch is found.
         clause_elt new_watch = c[li];
         c[1] = new_watch;
         c[li] = elt;
         // Modifies c[1].watch in place
-        ch.e0 = elt.atom;
-        // ch.e0 = c[0].atom;
+        ch.set_e0(elt.atom());
+        // ch.set_e0(c[0].atom());
         find_watchlist(s, c[1]).push(ch);
         goto next_clause;
       }
@@ -893,35 +982,35 @@ bool update_watchlist(solver_data& s,
     clause_elt* b(&(c[2]));
     clause_elt* e(c.end());
     for(; b != e; ++b) {
-      if(!s.state.is_inconsistent((*b).atom)) {
+      if(!s.state.is_inconsistent((*b).atom())) {
         clause_elt new_watch = (*b);
         c[1] = new_watch;
         (*b) = elt;
         // Modifies c[1].watch in place
-        ch.e0 = elt.atom;
-        // ch.e0 = c[0].atom;
-        find_watchlist(s, c[1]).push(ch);
+        ch.set_e0(elt.atom());
+        // ch.set_e0(c[0].atom());
+        find_watchlist(s, c[1]).push_long(ch);
         goto next_clause;
       }
     }
     // No watches found; either unit or conflicting.
     c[1] = elt;
-    ws[jj++] = ch;
+    ws.long_at(jj++) = ch;
 //    assert(c[0].watch);
 //    assert(c[1].watch);
     // Save the trail location, so we can tell if it's locked. (NOW DONE IN ENQUEUE)
     // c.extra.depth = s.infer.trail.size();
-    if(!enqueue(s, c[0].atom, &c)) {
-      for(ii++; ii < ws.size(); ii++)
-        ws[jj++] = ws[ii];
-      ws.shrink(ii - jj);
+    if(!enqueue(s, c[0].atom(), &c)) {
+      for(ii++; ii < ws.num_long(); ii++)
+        ws.long_at(jj++) = ws.long_at(ii);
+      ws.shrink_long(jj);
       return false;
     }
 
 next_clause:
     continue;
   }
-  ws.shrink(ws.size() - jj);
+  ws.shrink_long(jj);
   return true;
 }
 
@@ -949,11 +1038,14 @@ bool propagate_pred(solver_data& s, pid_t p) {
     assert(curr->succ);
     curr = curr->succ;
 
-    for(patom_t at : curr->bin_ws) {
+    for(patom_t at : curr->ws.bin()) {
       if(!enqueue(s, at, ~atom))
         return false;
     }
 
+    if(!propagate_ternary(s, curr->ws))
+      return false;
+
     if(!update_watchlist(s, ~atom, curr->ws)) {
       return false;
     }
@@ -985,8 +1077,6 @@ void wakeup_pred(solver_data& s, pid_t p) {
   for(watch_callback call : s.pred_callbacks[p]) {
     call();
   }
-  s.wake_vals[p] = s.state.p_vals[p];
-  s.wake_queued[p] = false;
 }
 
 void attach(solver_data* s, patom_t p, const watch_callback& cb) {
@@ -1057,6 +1147,15 @@ prop_restart:
     touch_pred(s, pi);
     wakeup_pred(s, pi);
   }
+  // Batched watchers see the round's changes together,
+  // before wake_vals catches up.
+  for(batch_set* b : s.batch_queue)
+    b->deliver();
+  s.batch_queue.clear();
+  for(pid_t pi : s.wake_queue) {
+    s.wake_vals[pi] = s.state.p_vals[pi];
+    s.wake_queued[pi] = false;
+  }
   s.wake_queue.clear();
 
   // Process enqueued propagators
@@ -1069,10 +1168,15 @@ prop_restart:
       s.log.active_constraint = p->cons_id;
 #endif
       s.active_prop = (void*) p;
-#ifdef TRACK_EXEC_COUNT
-      p->exec_count++;
-#endif
-      if(!p->propagate(s.infer.confl)) {
+      int trail_sz = s.infer.trail.size();
+      uint64_t t0 = s.opts.prop_profile ? prof_clock() : 0;
+      bool ok = p->propagate(s.infer.confl);
+      if(s.opts.prop_profile)
+        p->prof.cycles += prof_clock() - t0;
+      p->prof.execs++;
+      p->prof.prunings += s.infer.trail.size() - trail_sz;
+      if(!ok) {
+        p->prof.conflicts++;
 #ifdef LOG_PROP
         cerr << "[>Done-]" << endl;
 #endif
@@ -1130,14 +1234,14 @@ void add_learnt(solver_data* s, vec<clause_elt>& learnt, bool one_watch) {
   // GEAS_WARN("Collection of learnt clauses not yet implemented.");
 #ifdef CHECK_STATE
   for(int ei = 1; ei < learnt.size(); ei++)
-    assert(s->state.is_inconsistent(learnt[ei].atom));
+    assert(s->state.is_inconsistent(learnt[ei].atom()));
 #endif
 
   // Construct the clause
   int jj = 0;
   for(clause_elt e : learnt) {
     // Remove anything dead at l0.
-    if(s->state.is_inconsistent_l0(e.atom))
+    if(s->state.is_inconsistent_l0(e.atom()))
       continue;
     learnt[jj++] = e;
   }
@@ -1145,10 +1249,17 @@ void add_learnt(solver_data* s, vec<clause_elt>& learnt, bool one_watch) {
 
   s->stats.num_learnts++;
   s->stats.num_learnt_lits += jj;
+
+  // Root-level literals don't contribute to the LBD.
+  int lbd = min(s->confl.learnt_lbd, learnt.size());
+  s->stats.lbd_hist[min(lbd, GEAS_LBD_HIST)-1]++;
+
+  for(learnt_callback& call : s->on_learnt)
+    call(learnt);
   
   // Unit at root level
   if(learnt.size() == 1) {
-    enqueue(*s, learnt[0].atom, reason()); 
+    enqueue(*s, learnt[0].atom(), reason()); 
     return;
   }
   
@@ -1157,62 +1268,59 @@ void add_learnt(solver_data* s, vec<clause_elt>& learnt, bool one_watch) {
   /*  */ if(learnt.size() == 2) /* / if(0) */ {
     // Add the two watches
     /*
-    clause_head h0(learnt[0].atom);
-    clause_head h1(learnt[1].atom);
+    clause_head h0(learnt[0].atom());
+    clause_head h1(learnt[1].atom());
 
     find_watchlist(*s, learnt[0]).push(h1);
     find_watchlist(*s, learnt[1]).push(h0); 
     */
-    find_bin_watchlist(*s, learnt[0]).push(learnt[1].atom);
-    find_bin_watchlist(*s, learnt[1]).push(learnt[0].atom);
-    enqueue(*s, learnt[0].atom, learnt[1].atom);
+    attach_binary(*s, learnt[0], learnt[1]);
+    enqueue(*s, learnt[0].atom(), learnt[1].atom());
   } else {
     // Normal clause
-#ifdef KEEP_GLUE
-    bool is_glue = true;
-    for(int ii = 1; ii < learnt.size(); ii++)
-      if(s->state.is_inconsistent_prev(learnt[ii].atom))
-        is_glue = false;
-#else
-    bool is_glue = false;
-#endif
-
-    clause* c(clause_new(learnt));
+    cref cr(s->infer.alloc_clause(learnt));
+    clause* c(s->infer.arena.lea(cr));
     c->extra.is_learnt = true;
     c->extra.one_watch = one_watch;
+    c->extra.lbd = lbd;
     // c->extra.depth = s->infer.trail.size(); // NOW DONE IN ENQUEUE
 
     // Assumption:
     // learnt[0] is the asserting literal;
     // learnt[1] is at the current level
-    // clause_head h(learnt[2].atom, c);
-    clause_head h(learnt.last().atom, c);
-
-    if(!one_watch)
-      find_watchlist(*s, (*c)[0]).push(h);
-    find_watchlist(*s, (*c)[1]).push(h); 
-    enqueue(*s, learnt[0].atom, c);
-    if(is_glue)
-      s->infer.clauses.push(c);
-    else
-      s->infer.learnts.push(c);
+    if(learnt.size() == 3 && !one_watch) {
+      attach_ternary(*s, cr);
+    } else {
+      // clause_head h(learnt[2].atom(), cr);
+      clause_head h(learnt.last().atom(), cr);
+
+      if(!one_watch)
+        find_watchlist(*s, (*c)[0]).push_long(h);
+      find_watchlist(*s, (*c)[1]).push_long(h); 
+    }
+    enqueue(*s, learnt[0].atom(), c);
+    if(lbd <= s->opts.lbd_core) {
+      c->extra.tier = clause_extra::T_Core;
+      s->infer.learnts_core.push(cr);
+      s->stats.num_core++;
+    } else if(lbd <= s->opts.lbd_tier2) {
+      c->extra.tier = clause_extra::T_Tier2;
+      s->infer.learnts_tier2.push(cr);
+      s->stats.num_tier2++;
+    } else {
+      s->infer.learnts.push(cr);
+    }
   }
 }
 
 // Remove c from its watch lists.
-inline void detach_watch(vec<clause_head>& ws, clause* c) {
-  for(clause_head& w : ws) {
-    if(w.c == c) {
-      w = ws.last();
-      ws.pop();
-      return;
-    }
-  }
-  GEAS_ERROR;
+inline void detach_watch(watch_buf& ws, cref c) {
+  if(!ws.remove_long(c))
+    GEAS_ERROR;
 }
 
-inline void replace_watch(vec<clause_head>& ws, clause* c, clause_head h) {
-  for(clause_head& w : ws) {
+inline void replace_watch(watch_buf& ws, cref c, clause_head h) {
+  for(clause_head& w : ws.longs()) {
     if(w.c == c) {
       w = h;
       return;
@@ -1220,24 +1328,64 @@ inline void replace_watch(vec<clause_head>& ws, clause* c, clause_head h) {
   }
 }
 
-inline void detach_clause(solver_data& s, clause* c) {
+inline void detach_clause(solver_data& s, cref cr) {
   // We care about the watches for 
-  // fprintf(stderr, "%p\n", c);
+  clause* c(s.infer.arena.lea(cr));
+  if(c->extra.ternary) {
+    for(clause_elt& e : *c) {
+      if(!lookup_watchlist(s, e).remove_tern(cr))
+        GEAS_ERROR;
+    }
+    return;
+  }
   if(!c->extra.one_watch)
-    detach_watch(lookup_watchlist(s, (*c)[0]), c);
-  detach_watch(lookup_watchlist(s, (*c)[1]), c);
+    detach_watch(lookup_watchlist(s, (*c)[0]), cr);
+  detach_watch(lookup_watchlist(s, (*c)[1]), cr);
+}
+
+// Ternary clauses never lose a literal while staying ternary:
+// at a root fixpoint, a false literal leaves a binary clause.
+inline cref* simplify_ternary(solver_data& s, cref cr, cref* dest) {
+  clause& c(s.infer.arena[cr]);
+  bool sat = false;
+  int live = 0;
+  for(clause_elt& e : c) {
+    if(s.state.is_entailed_l0(e.atom()))
+      sat = true;
+    else if(!s.state.is_inconsistent_l0(e.atom()))
+      ++live;
+  }
+  if(!sat && live == 3) {
+    *dest = cr; ++dest;
+    return dest;
+  }
+  detach_clause(s, cr);
+  if(!sat) {
+    assert(live == 2);
+    clause_elt* ej = c.begin();
+    for(clause_elt& e : c) {
+      if(!s.state.is_inconsistent_l0(e.atom()))
+        *ej++ = e;
+    }
+    attach_binary(s, c[0], c[1]);
+  }
+  s.infer.arena.release(cr);
+  return dest;
 }
 
-inline clause** simplify_clause(solver_data& s, clause* c, clause** dest) {
+inline cref* simplify_clause(solver_data& s, cref cr, cref* dest) {
+  clause* c(s.infer.arena.lea(cr));
+  if(c->extra.ternary)
+    return simplify_ternary(s, cr, dest);
   /*
   clause_elt* ej = c->begin();
   for(clause_elt e : *c) {
     */
   // If a watch is true, delete it.
-  if(s.state.is_entailed_l0((*c)[0].atom)
-     || s.state.is_entailed_l0((*c)[1].atom)) {
-    detach_clause(s, c);
-    free(c);
+  if(s.state.is_entailed_l0((*c)[0].atom())
+     || s.state.is_entailed_l0((*c)[1].atom())) {
+    detach_clause(s, cr);
+    s.infer.arena.release(cr);
     return dest;
   }
   
@@ -1245,19 +1393,21 @@ inline clause** simplify_clause(solver_data& s, clause* c, clause** dest) {
   clause_elt* ej = c->begin()+2;
   for(int ei = 2; ei < c->size(); ei++) {
     clause_elt e = (*c)[ei]; 
-    if(s.state.is_entailed_l0(e.atom)) {
+    if(s.state.is_entailed_l0(e.atom())) {
       // Clause is satisfied at the root; remove it.
-      detach_clause(s, c);
-      free(c); 
+      detach_clause(s, cr);
+      s.infer.arena.release(cr);
       return dest;
     }
-    if(!s.state.is_inconsistent_l0(e.atom)) {
+    if(!s.state.is_inconsistent_l0(e.atom())) {
       // Literal may become true; keep it.
       *ej = e; ++ej;
     }
   }
+  int old_sz = c->sz;
   c->sz = ej - c->begin();
   assert(c->sz >= 2);
+  s.infer.arena.shrunk(cr, old_sz);
 
   if(c->sz == 2)  {
     // c has become a binary clause.
@@ -1268,22 +1418,24 @@ inline clause** simplify_clause(solver_data& s, clause* c, clause** dest) {
     // there may only be one survivor in the clause, so if we were
     // two-watching, it would already be asserted.
     // As it is, one of our watch-lists will already be dead.
-    detach_clause(s, c);
+    detach_clause(s, cr);
     /*
     if(!c->extra.one_watch)
-      replace_watch(find_watchlist(s, (*c)[0]), c, (*c)[1].atom);
-    replace_watch(find_watchlist(s, (*c)[1]), c, (*c)[0].atom);
+      replace_watch(find_watchlist(s, (*c)[0]), c, (*c)[1].atom());
+    replace_watch(find_watchlist(s, (*c)[1]), c, (*c)[0].atom());
     */
-    find_bin_watchlist(s, (*c)[0]).push((*c)[1].atom);
-    find_bin_watchlist(s, (*c)[1]).push((*c)[0].atom);
-    free(c);
+    attach_binary(s, (*c)[0], (*c)[1]);
+    s.infer.arena.release(cr);
     return dest;
   }
 
-  *dest = c; ++dest;
+  *dest = cr; ++dest;
   return dest;
 }
 
+// Conflicts between full sweeps of the watch maps.
+enum { Watch_Sweep_Conflicts = 10000 };
+
 // Precondition: propagate should have been run to fixpoint,
 // and we're at decision level 0.
 inline void simplify_at_root(solver_data& s) {
@@ -1300,95 +1452,69 @@ inline void simplify_at_root(solver_data& s) {
   // Watches may be invalidated when a clause is
   // deleted because it is satisfied at the root.
   // This is dealt with in simplify_clause.
-  clause** cj = s.infer.clauses.begin();
-  // for(clause* c : s.infer.clauses) {
+  cref* cj = s.infer.clauses.begin();
   for(int ci = 0; ci < s.infer.clauses.size(); ci++) {
-    clause* c(s.infer.clauses[ci]);
+    cref c(s.infer.clauses[ci]);
     cj = simplify_clause(s, c, cj); 
   }
   s.infer.clauses.shrink_(s.infer.clauses.end() - cj);
 
-  clause** lj = s.infer.learnts.begin();
-  for(clause* c : s.infer.learnts) {
-    lj = simplify_clause(s, c, lj);
+  for(vec<cref>* ls : { &s.infer.learnts_core, &s.infer.learnts_tier2, &s.infer.learnts }) {
+    cref* lj = ls->begin();
+    for(cref c : *ls)
+      lj = simplify_clause(s, c, lj);
+    ls->shrink_(ls->end() - lj);
+  }
+  s.stats.num_core = s.infer.learnts_core.size();
+  s.stats.num_tier2 = s.infer.learnts_tier2.size();
+
+  if(s.infer.arena.fragmented())
+    compact_clauses(&s);
+#endif
+
+  // Now that the clauses are simplified, collect the watch nodes
+  // for atoms fixed at the root. Every so often, also sweep up
+  // nodes left empty by deleted clauses.
+  bool sweep = s.stats.conflicts >= s.next_watch_sweep;
+  if(sweep)
+    s.next_watch_sweep = s.stats.conflicts + Watch_Sweep_Conflicts;
+  size_t bytes = 0;
+  int freed = 0;
+  if(sweep) {
+    for(int pi = 0; pi < s.infer.watch_maps.size(); ++pi)
+      freed += s.infer.collect_watches(pi, true, bytes);
+  } else {
+    for(int pi : s.persist.touched_preds)
+      freed += s.infer.collect_watches(pi, false, bytes);
   }
-  s.infer.learnts.shrink_(s.infer.learnts.end() - lj);
-#endif
-
-#if 1
+  // Dense maps keep their nodes; just skip past the fixed ones.
   for(int pi : s.persist.touched_preds) {
-    // Do garbage collection on the watch_node*-s.
+    if(s.infer.watch_maps[pi].kind != watch_map::W_DENSE)
+      continue;
     pval_t head_val = s.infer.pred_watch_heads[pi].val;
     watch_node* head = s.infer.pred_watch_heads[pi].ptr;
-    watch_node* dest = s.infer.pred_watches[pi];
-
-    while(head != dest) {
-      // assert(head->ws.size() == 0);
-#if 0
-      // FIXME: This is dangerous in combination with
-      // one-watch. See note in simplify_clause.
-      s.infer.watch_maps[pi].rem(head_val);
-      watch_node* w = head;
-      head_val = head->succ_val;
-      head = head->succ;
-      delete w;
-#else
+    while(head != s.infer.pred_watches[pi]) {
       head_val = head->succ_val;
       head = head->succ;
-#endif
     }
-
-    s.infer.pred_watch_heads[pi].val = head_val;
-    s.infer.pred_watch_heads[pi].ptr = head;
-    // Now that entailed watches are deleted, we're committed
-    // to simplifying all the clauses.
-    // TODO: Also collect inactive watch-nodes.
+    s.infer.pred_watch_heads[pi] = infer_info::watch_head { head_val, head };
   }
-#endif
-
-#if 0
-    for(int pi : irange(s.infer.pred_watches.size())) {
-      watch_node* w = s.infer.pred_watches[pi];
-      watch_node* su = w->succ;
-      pval_t succ_val = w->succ_val;
-      while(su) {
-        if(su->ws.size() == 0 && su->callbacks.size() == 0) {
-          s.infer.watch_maps[pi].rem(succ_val);
-          watch_node* r(su);
-          succ_val = r->succ_val;
-          su = r->succ;
-          delete r;
-        } else {
-          w->succ_val = succ_val;
-          w->succ = su;
-          w = su;
-          succ_val = su->succ_val;
-          su = su->succ;
-        }
-      }
-      w->succ = nullptr;
-      w->succ_val = pval_err;
-    }
-#endif
-
+  s.stats.watches_freed += freed;
+  s.stats.watch_mem_freed += bytes / (1024.0 * 1024.0);
 
 #ifdef LOG_RESTART
   int count = 0;
-  int stale = 0;
   for(watch_node* w : s.infer.pred_watches) {
     while(w->succ) {
       w = w->succ;
       ++count;
-      if(w->ws.size() == 0 && w->callbacks.size() == 0)
-        ++stale;
     }
   }
-  fprintf(stderr, "%% %d watch nodes, %d stale\n", count, stale);
+  fprintf(stderr, "%% %d watch nodes, %d freed (%zu bytes)\n", count, freed, bytes);
   fprintf(stderr, "%% %d propagations, %d clauses, %d learnts\n", num_props,
     s.infer.clauses.size(), s.infer.learnts.size());
   fprintf(stderr, "%% %lf possible values\n", domains_total);
 #endif
-  
 
   for(propagator* p : s.propagators)
     p->root_simplify();
@@ -1400,6 +1526,660 @@ inline void simplify_at_root(solver_data& s) {
   return;
 }
 
+// Watch a learnt, as add_learnt would.
+static void attach_learnt(solver_data& s, cref cr) {
+  clause* c(s.infer.arena.lea(cr));
+  c->extra.ternary = 0;
+  if(c->size() == 3 && !c->extra.one_watch) {
+    attach_ternary(s, cr);
+  } else {
+    clause_head h((*c)[c->size()-1].atom(), cr);
+    if(!c->extra.one_watch)
+      find_watchlist(s, (*c)[0]).push_long(h);
+    find_watchlist(s, (*c)[1]).push_long(h);
+  }
+}
+
+// The (detached) learnt cr has been shortened at the root from
+// old_sz literals. Watch it again, or replace it with a binary
+// clause or a unit. Returns false if cr was released.
+static bool reattach_learnt(solver_data& s, cref cr, int old_sz) {
+  clause* c(s.infer.arena.lea(cr));
+  int sz = c->size();
+  if(sz < old_sz) {
+    s.infer.arena.shrunk(cr, old_sz);
+    s.stats.num_learnt_lits -= old_sz - sz;
+    s.stats.inprocess_lits += old_sz - sz;
+    if(c->extra.lbd > (unsigned) sz)
+      c->extra.lbd = sz;
+  }
+  if(sz == 1) {
+    enqueue(s, (*c)[0].atom(), reason());
+    s.infer.arena.release(cr);
+    return false;
+  }
+  if(sz == 2) {
+    attach_binary(s, (*c)[0], (*c)[1]);
+    s.infer.arena.release(cr);
+    return false;
+  }
+  attach_learnt(s, cr);
+  return true;
+}
+
+// Vivification: assume the literals of each learnt false in
+// turn. Once propagation fixes the next literal, or fails, the
+// rest of the clause is redundant; literals it makes false
+// can be dropped too. Only core and tier2 learnts are worth
+// the effort, and each is only vivified once.
+// Returns false if a unit was derived (and the pass stopped).
+static bool vivify_learnts(solver_data& s, double limit) {
+  bool fixed = false;
+  for(vec<cref>* ls : { &s.infer.learnts_core, &s.infer.learnts_tier2 }) {
+    cref* lj = ls->begin();
+    for(cref cr : *ls) {
+      clause* c(s.infer.arena.lea(cr));
+      if(fixed || c->extra.vivified || getTime() > limit) {
+        *lj = cr; ++lj;
+        continue;
+      }
+      c->extra.vivified = 1;
+      detach_clause(s, cr);
+
+      int old_sz = c->size();
+      int jj = 0;
+      for(int ii = 0; ii < old_sz; ++ii) {
+        clause_elt e((*c)[ii]);
+        if(s.state.is_inconsistent(e.atom()))
+          continue;
+        (*c)[jj++] = e;
+        if(s.state.is_entailed(e.atom()))
+          break;
+        push_level(&s);
+        enqueue(s, ~e.atom(), reason());
+        if(!propagate(s)) {
+          s.infer.confl.clear();
+          break;
+        }
+        // Propagators may have allocated clauses.
+        c = s.infer.arena.lea(cr);
+      }
+      if(decision_level(s) > 0)
+        bt_to_level(&s, 0);
+      c = s.infer.arena.lea(cr);
+      // Every literal false at the root; simplify_at_root
+      // should have caught that.
+      assert(jj > 0);
+      c->sz = jj;
+      if(reattach_learnt(s, cr, old_sz)) {
+        *lj = cr; ++lj;
+      } else {
+        fixed |= (jj == 1);
+      }
+    }
+    ls->shrink_(ls->end() - lj);
+  }
+  return !fixed;
+}
+
+// Backward subsumption and self-subsuming resolution, with
+// each clause C (original or learnt) against the learnts D.
+// Bounds are compared on the same predicate: [p >= v] implies
+// [p >= v'] whenever v >= v'. So C subsumes D when each literal
+// of C implies some literal of D, and D is deleted. If all but
+// one literal c of C does, and some d in D implies ~c, then
+// d can be resolved away.
+// Returns false if a unit was derived (and the pass stopped).
+static bool subsume_learnts(solver_data& s, double limit) {
+  struct cand {
+    cref c;
+    int tier; // Learnt list, or -1 for an original clause.
+  };
+  vec<cref>* tiers[] = { &s.infer.learnts_core, &s.infer.learnts_tier2, &s.infer.learnts };
+  clause_arena& arena(s.infer.arena);
+
+  vec<cand> cands;
+  for(cref cr : s.infer.clauses)
+    cands.push(cand { cr, -1 });
+  for(int t = 0; t < 3; ++t) {
+    for(cref cr : *tiers[t])
+      cands.push(cand { cr, t });
+  }
+
+  // Occurrences of each variable (pair of preds) in the learnts.
+  int num_preds = s.state.p_vals.size();
+  vec< vec<int> > occ(num_preds/2);
+  for(int ci = 0; ci < cands.size(); ++ci) {
+    if(cands[ci].tier < 0)
+      continue;
+    for(clause_elt e : arena[cands[ci].c])
+      occ[e.atom().pid>>1].push(ci);
+  }
+
+  vec<int> order;
+  for(int ci = 0; ci < cands.size(); ++ci)
+    order.push(ci);
+  sort(order.begin(), order.end(),
+    [&](int x, int y) { return arena[cands[x].c].size() < arena[cands[y].c].size(); });
+
+  // Per pred: the bound in C, and whether it has been
+  // matched in the current D.
+  vec<pval_t> c_val(num_preds, 0);
+  vec<unsigned int> c_stamp(num_preds, 0);
+  vec<unsigned int> d_stamp(num_preds, 0);
+  vec<unsigned int> visited(cands.size(), 0);
+  vec<char> dead(cands.size(), 0);
+  unsigned int cs = 0;
+  unsigned int ds = 0;
+  bool fixed = false;
+
+  for(int ci : order) {
+    if(fixed || getTime() > limit)
+      break;
+    if(dead[ci])
+      continue;
+    clause& c(arena[cands[ci].c]);
+    ++cs;
+    // Pick the least frequent variable of C to find candidates.
+    int n_c = 0;
+    int best_v = -1;
+    for(clause_elt e : c) {
+      patom_t at(e.atom());
+      if(c_stamp[at.pid] == cs) {
+        // Repeated pred; not worth the trouble.
+        n_c = 0;
+        break;
+      }
+      c_stamp[at.pid] = cs;
+      c_val[at.pid] = at.val;
+      ++n_c;
+      int v = at.pid>>1;
+      if(best_v < 0 || occ[v].size() < occ[best_v].size())
+        best_v = v;
+    }
+    if(!n_c)
+      continue;
+    
+    for(int di : occ[best_v]) {
+      if(di == ci || dead[di] || visited[di] == cs)
+        continue;
+      visited[di] = cs;
+      cref dr(cands[di].c);
+      clause& d(arena[dr]);
+      if(d.size() < n_c)
+        continue;
+      ++ds;
+      int matched = 0;
+      int strip = -1;
+      for(int k = 0; k < d.size(); ++k) {
+        patom_t at(d[k].atom());
+        if(c_stamp[at.pid] == cs && c_val[at.pid] >= at.val) {
+          if(d_stamp[at.pid] != ds) {
+            d_stamp[at.pid] = ds;
+            ++matched;
+          }
+        } else if(strip < 0 && c_stamp[at.pid^1] == cs
+                  && at.val >= pval_contra(c_val[at.pid^1])) {
+          strip = k;
+        }
+      }
+      if(matched == n_c) {
+        detach_clause(s, dr);
+        s.stats.num_learnts--;
+        s.stats.num_learnt_lits -= d.size();
+        s.stats.inprocess_subsumed++;
+        arena.release(dr);
+        dead[di] = 1;
+      } else if(matched == n_c-1 && strip >= 0
+                && d_stamp[d[strip].atom().pid^1] != ds) {
+        detach_clause(s, dr);
+        int old_sz = d.size();
+        d[strip] = d[old_sz-1];
+        d.sz = old_sz-1;
+        d.extra.vivified = 0;
+        if(!reattach_learnt(s, dr, old_sz)) {
+          dead[di] = 1;
+          if(d.size() == 1) {
+            fixed = true;
+            break;
+          }
+        }
+      }
+    }
+  }
+
+  for(int t = 0; t < 3; ++t)
+    tiers[t]->clear();
+  for(int ci = 0; ci < cands.size(); ++ci) {
+    if(cands[ci].tier >= 0 && !dead[ci])
+      tiers[cands[ci].tier]->push(cands[ci].c);
+  }
+  return !fixed;
+}
+
+// Precondition: as for simplify_at_root, which should have
+// just been run. Strengthens the learnts until getTime()
+// reaches limit. Returns false if atoms were fixed at the
+// root, and need propagating.
+static bool inprocess(solver_data& s, double limit) {
+  double start = getTime();
+  bool ok = subsume_learnts(s, limit) && vivify_learnts(s, limit);
+  s.stats.num_core = s.infer.learnts_core.size();
+  s.stats.num_tier2 = s.infer.learnts_tier2.size();
+  if(s.infer.arena.fragmented())
+    compact_clauses(&s);
+  s.stats.inprocess_time += getTime() - start;
+  return ok;
+}
+
+static bool atom_lt(patom_t x, patom_t y) {
+  return x.pid < y.pid || (x.pid == y.pid && x.val < y.val);
+}
+
+// v + d, if it is a (non-trivial) bound.
+static bool shift_val(pval_t v, spval_t d, pval_t& out) {
+  if(d < 0) {
+    if(v <= (pval_t) -d)
+      return false;
+    out = v - (pval_t) -d;
+  } else {
+    if(pval_max - v < (pval_t) d)
+      return false;
+    out = v + d;
+  }
+  return true;
+}
+
+// The implication graph over atoms, at the root. Edges come
+// from binary clauses, primitive inequalities (pred_ineqs) and
+// the order of bounds on the same pred, each with its
+// contrapositive; so the graph contains the negation of each
+// atom it contains.
+struct imp_graph {
+  vec<patom_t> atoms; // Sorted by atom_lt.
+  vec<int> start; // Edges out of atoms[i] are succ[start[i]..start[i+1]).
+  vec<int> succ;
+
+  int index(patom_t at) const {
+    patom_t* it = lower_bound(atoms.begin(), atoms.end(), at, atom_lt);
+    return (it != atoms.end() && *it == at) ? it - atoms.begin() : -1;
+  }
+  // The strongest atom [p >= v'] with v' <= v, if any.
+  int below(pid_t p, pval_t v) const {
+    patom_t* it = upper_bound(atoms.begin(), atoms.end(), patom_t(p, v), atom_lt);
+    if(it == atoms.begin() || (it-1)->pid != p)
+      return -1;
+    return (it-1) - atoms.begin();
+  }
+};
+
+static void build_imp_graph(solver_data& s, imp_graph& g) {
+  vec< pair<patom_t, patom_t> > bins;
+  for(int p = 2; p < s.infer.pred_watches.size(); ++p) {
+    for(watch_node* w = s.infer.pred_watches[p]; w->succ; w = w->succ) {
+      patom_t x(p, w->succ_val);
+      for(patom_t y : w->succ->ws.bin()) {
+        if(s.state.is_entailed(x) || s.state.is_inconsistent(x)
+           || s.state.is_entailed(y) || s.state.is_inconsistent(y))
+          continue;
+        bins.push(make_pair(x, y));
+        g.atoms.push(x);
+        g.atoms.push(~x);
+        g.atoms.push(y);
+        g.atoms.push(~y);
+      }
+    }
+  }
+  sort(g.atoms.begin(), g.atoms.end(), atom_lt);
+  g.atoms.shrink_(g.atoms.end() - unique(g.atoms.begin(), g.atoms.end()));
+
+  int n = g.atoms.size();
+  vec< pair<int, int> > edges;
+  auto add_imp = [&](int i, int j) {
+    edges.push(make_pair(i, j));
+    edges.push(make_pair(g.index(~g.atoms[j]), g.index(~g.atoms[i])));
+  };
+  for(auto b : bins)
+    add_imp(g.index(b.first), g.index(b.second));
+  for(int i = 0; i < n; ++i) {
+    patom_t x(g.atoms[i]);
+    if(i+1 < n && g.atoms[i+1].pid == x.pid)
+      edges.push(make_pair(i+1, i));
+    for(infer_info::bin_le ineq : s.infer.pred_ineqs[x.pid]) {
+      pval_t t;
+      if(!shift_val(x.val, -ineq.offset, t))
+        continue;
+      int j = g.below(ineq.p, t);
+      if(j >= 0)
+        add_imp(i, j);
+    }
+  }
+
+  g.start.growTo(n+1, 0);
+  for(auto e : edges)
+    ++g.start[e.first+1];
+  for(int i = 0; i < n; ++i)
+    g.start[i+1] += g.start[i];
+  g.succ.growTo(edges.size());
+  vec<int> pos;
+  g.start.copyTo(pos);
+  for(auto e : edges)
+    g.succ[pos[e.first]++] = e.second;
+}
+
+// Tarjan's algorithm, without recursion. Components are
+// numbered in reverse topological order.
+static int imp_sccs(const imp_graph& g, vec<int>& comp) {
+  int n = g.atoms.size();
+  vec<int> idx(n, -1);
+  vec<int> low(n, 0);
+  vec<int> pos(n, 0);
+  vec<int> stack;
+  vec<int> calls;
+  comp.clear();
+  comp.growTo(n, -1);
+  int count = 0;
+  int ncomp = 0;
+  for(int r = 0; r < n; ++r) {
+    if(idx[r] >= 0)
+      continue;
+    idx[r] = low[r] = count++;
+    pos[r] = g.start[r];
+    stack.push(r);
+    calls.push(r);
+    while(calls.size() > 0) {
+      int v = calls.last();
+      if(pos[v] < g.start[v+1]) {
+        int w = g.succ[pos[v]++];
+        if(idx[w] < 0) {
+          idx[w] = low[w] = count++;
+          pos[w] = g.start[w];
+          stack.push(w);
+          calls.push(w);
+        } else if(comp[w] < 0) {
+          low[v] = min(low[v], idx[w]);
+        }
+        continue;
+      }
+      calls.pop();
+      if(low[v] == idx[v]) {
+        int w;
+        do {
+          w = stack.last();
+          stack.pop();
+          comp[w] = ncomp;
+        } while(w != v);
+        ++ncomp;
+      }
+      if(calls.size() > 0)
+        low[calls.last()] = min(low[calls.last()], low[v]);
+    }
+  }
+  return ncomp;
+}
+
+// Weighted union-find over the (even) preds: the value of
+// par[p] is the value of p plus off[p].
+static int pred_find(vec<int>& par, vec<spval_t>& off, int p, spval_t& d) {
+  d = 0;
+  while(par[p] != p) {
+    d += off[p];
+    p = par[p];
+  }
+  return p;
+}
+
+// Substitutes equivalent atoms in the clause cr, which has
+// been rewritten in place by subst. Returns false if the
+// clause was released; sets fixed if it became a unit.
+static bool normalize_clause(solver_data& s, cref cr, int old_sz, bool& fixed,
+                             vec<unsigned int>& seen, vec<int>& where, unsigned int stamp) {
+  clause* c(s.infer.arena.lea(cr));
+  int jj = 0;
+  for(int ii = 0; ii < old_sz; ++ii) {
+    clause_elt e((*c)[ii]);
+    patom_t at(e.atom());
+    if(s.state.is_entailed(at))
+      goto satisfied;
+    if(s.state.is_inconsistent(at))
+      continue;
+    if(seen[at.pid] == stamp) {
+      // [p >= v] or [p >= v'] is [p >= min(v, v')].
+      clause_elt& o((*c)[where[at.pid]]);
+      if(at.val < o.val) {
+        o.val = at.val;
+        o.watch = 0;
+      }
+      continue;
+    }
+    seen[at.pid] = stamp;
+    where[at.pid] = jj;
+    (*c)[jj++] = e;
+  }
+  for(int ii = 0; ii < jj; ++ii) {
+    patom_t at((*c)[ii].atom());
+    if(seen[at.pid^1] == stamp
+       && (*c)[where[at.pid^1]].val <= pval_contra(at.val))
+      goto satisfied;
+  }
+
+  c->sz = jj;
+  if(jj < old_sz)
+    s.infer.arena.shrunk(cr, old_sz);
+  if(jj == 0) {
+    // All equivalent to false, so the original was false too.
+    s.solver_is_consistent = false;
+    s.infer.arena.release(cr);
+    return false;
+  }
+  if(jj == 1) {
+    fixed = true;
+    if(!enqueue(s, (*c)[0].atom(), reason()))
+      s.solver_is_consistent = false;
+    s.infer.arena.release(cr);
+    return false;
+  }
+  if(jj == 2) {
+    attach_binary(s, (*c)[0], (*c)[1]);
+    s.infer.arena.release(cr);
+    return false;
+  }
+  attach_learnt(s, cr);
+  return true;
+
+satisfied:
+  s.infer.arena.release(cr);
+  return false;
+}
+
+// Precondition: as for inprocess.
+// Finds equivalent atoms (strongly connected components of the
+// binary implication graph) and equivalent preds (pairs of
+// inequalities p - q <= k, q - p <= -k), and rewrites the
+// clauses in terms of representatives. Then probes the roots
+// of the graph: an atom whose assertion fails is false.
+// Returns false if atoms were fixed at the root, and need
+// propagating; check solver_is_consistent.
+static bool bin_equiv(solver_data& s) {
+  enum { Probe_Limit = 1000 };
+
+  // Nothing new unless implications were added since the last
+  // call; dropping them (or fixing atoms) can't merge anything.
+  if(s.infer.num_imps == s.equiv_imps)
+    return true;
+  s.equiv_imps = s.infer.num_imps;
+
+  imp_graph g;
+  build_imp_graph(s, g);
+
+  vec<int> comp;
+  int ncomp = imp_sccs(g, comp);
+  int n = g.atoms.size();
+  vec<int> comp_rep(ncomp, -1);
+  int num_equiv = 0;
+  for(int i = 0; i < n; ++i) {
+    int ni = g.index(~g.atoms[i]);
+    if(comp[i] == comp[ni]) {
+      // x <-> ~x
+      s.solver_is_consistent = false;
+      return false;
+    }
+    if(comp_rep[comp[i]] < 0) {
+      comp_rep[comp[i]] = i;
+      comp_rep[comp[ni]] = ni;
+    } else if(i < ni) {
+      // Count x and ~x once.
+      ++num_equiv;
+    }
+  }
+
+  int num_preds = s.state.p_vals.size();
+  vec<int> par(num_preds, 0);
+  vec<spval_t> off(num_preds, 0);
+  for(int p = 0; p < num_preds; ++p)
+    par[p] = p;
+  int num_pequiv = 0;
+  for(int p = 2; p < num_preds; ++p) {
+    for(infer_info::bin_le ineq : s.infer.pred_ineqs[p]) {
+      int q = ineq.p;
+      if((p&1) != (q&1))
+        continue;
+      bool is_eq = false;
+      for(infer_info::bin_le r : s.infer.pred_ineqs[q])
+        is_eq |= (r.p == (pid_t) p && r.offset == -ineq.offset);
+      if(!is_eq)
+        continue;
+      // q = p - k, or for the negations, q^1 = p^1 + k.
+      int x = p & ~1;
+      int y = q & ~1;
+      spval_t k = (p&1) ? -ineq.offset : ineq.offset;
+      spval_t dx, dy;
+      int rx = pred_find(par, off, x, dx);
+      int ry = pred_find(par, off, y, dy);
+      if(rx == ry)
+        continue;
+      if(rx < ry) {
+        par[ry] = rx;
+        off[ry] = dx + k - dy;
+      } else {
+        par[rx] = ry;
+        off[rx] = dy - k - dx;
+      }
+      ++num_pequiv;
+    }
+  }
+  s.stats.equiv_atoms += num_equiv;
+  s.stats.equiv_preds += num_pequiv;
+
+  // [p >= v] is [pred_rep[p] >= v + pred_shift[p]].
+  vec<pid_t> pred_rep(num_preds, 0);
+  vec<spval_t> pred_shift(num_preds, 0);
+  for(int p = 0; p < num_preds; p += 2) {
+    spval_t d;
+    int r = pred_find(par, off, p, d);
+    pred_rep[p] = r;
+    pred_shift[p] = d;
+    pred_rep[p+1] = r+1;
+    pred_shift[p+1] = -d;
+  }
+  auto subst = [&](patom_t at) {
+    int i = g.index(at);
+    if(i >= 0)
+      at = g.atoms[comp_rep[comp[i]]];
+    pval_t v;
+    if(pred_rep[at.pid] != at.pid && shift_val(at.val, pred_shift[at.pid], v))
+      at = patom_t(pred_rep[at.pid], v);
+    return at;
+  };
+
+  bool fixed = false;
+  if(num_equiv + num_pequiv > 0) {
+    vec<unsigned int> seen(num_preds, 0);
+    vec<int> where(num_preds, 0);
+    unsigned int stamp = 0;
+    for(vec<cref>* ls : { &s.infer.clauses, &s.infer.learnts_core,
+                          &s.infer.learnts_tier2, &s.infer.learnts }) {
+      bool is_learnt = ls != &s.infer.clauses;
+      cref* cj = ls->begin();
+      for(cref cr : *ls) {
+        if(!s.solver_is_consistent) {
+          *cj = cr; ++cj;
+          continue;
+        }
+        clause* c(s.infer.arena.lea(cr));
+        bool changed = false;
+        for(clause_elt& e : *c)
+          changed |= (subst(e.atom()) != e.atom());
+        if(!changed) {
+          *cj = cr; ++cj;
+          continue;
+        }
+        detach_clause(s, cr);
+        for(clause_elt& e : *c) {
+          patom_t at(subst(e.atom()));
+          if(at != e.atom())
+            e = clause_elt(at);
+        }
+        int old_sz = c->size();
+        bool kept = normalize_clause(s, cr, old_sz, fixed, seen, where, ++stamp);
+        if(is_learnt) {
+          s.stats.num_learnt_lits -= old_sz - (kept ? c->size() : 0);
+          if(!kept)
+            s.stats.num_learnts--;
+        }
+        if(kept) {
+          *cj = cr; ++cj;
+        }
+      }
+      ls->shrink_(ls->end() - cj);
+    }
+    s.stats.num_core = s.infer.learnts_core.size();
+    s.stats.num_tier2 = s.infer.learnts_tier2.size();
+    if(!s.solver_is_consistent)
+      return false;
+    if(fixed && !propagate(s)) {
+      s.solver_is_consistent = false;
+      return false;
+    }
+  }
+
+  // Probe atoms with no (outside) predecessors.
+  vec<char> has_pred(ncomp, 0);
+  vec<char> has_succ(ncomp, 0);
+  for(int i = 0; i < n; ++i) {
+    for(int ei = g.start[i]; ei < g.start[i+1]; ++ei) {
+      int j = g.succ[ei];
+      if(comp[i] != comp[j]) {
+        has_succ[comp[i]] = 1;
+        has_pred[comp[j]] = 1;
+      }
+    }
+  }
+  int probes = 0;
+  for(int ci = ncomp-1; ci >= 0 && probes < Probe_Limit; --ci) {
+    if(has_pred[ci] || !has_succ[ci])
+      continue;
+    patom_t at(g.atoms[comp_rep[ci]]);
+    if(s.state.is_entailed(at) || s.state.is_inconsistent(at))
+      continue;
+    ++probes;
+    push_level(&s);
+    enqueue(s, at, reason());
+    bool ok = propagate(s);
+    bt_to_level(&s, 0);
+    if(ok)
+      continue;
+    s.infer.confl.clear();
+    s.stats.failed_lits++;
+    fixed = true;
+    if(!enqueue(s, ~at, reason()) || !propagate(s)) {
+      s.solver_is_consistent = false;
+      return false;
+    }
+  }
+  return !fixed;
+}
+
 // Retrieve a model
 // precondition: last call to solver::solve returned SAT
 // actually, we should just save the last incumbent.
@@ -1414,6 +2194,112 @@ model solver::get_model(void) {
   return data->incumbent;
 }
 
+// The Luby sequence: 1 1 2 1 1 2 4 1 1 2 1 1 2 4 8 ...
+static int luby(int x) {
+  int size = 1;
+  int seq = 0;
+  for(; size < x+1; ++seq)
+    size = 2*size + 1;
+  while(size-1 != x) {
+    size = (size-1)>>1;
+    --seq;
+    x = x % size;
+  }
+  return 1 << seq;
+}
+
+// Decides when solve restarts, following opts.restart_policy.
+// A restart_limit of 0 disables restarts under every policy.
+class restart_sched {
+  // Glucose: restart once the mean LBD of the last lbd_window
+  // learnts, times lbd_margin, exceeds the mean over the whole run.
+  enum { lbd_window = 50 };
+  static constexpr double lbd_margin = 0.8;
+public:
+  restart_sched(solver_data& s)
+    : kind(s.opts.restart_policy),
+      base(s.opts.restart_limit), growth(s.opts.restart_growthrate),
+      limit(base), inner(base), outer(base),
+      luby_idx(0),
+      lbd_total(0), lbd_count(0), lbd_recent(0), lbd_head(0), lbd_size(0) {
+    if(kind == RESTART_AUTO) {
+      // Once there is a solution (or an objective), we are
+      // most likely optimizing.
+      kind = (s.stats.solutions > 0 || s.obj_bound != at_Undef)
+        ? RESTART_GEOMETRIC : RESTART_GLUCOSE;
+    }
+  }
+
+  // Conflicts until the first restart.
+  int first(void) const {
+    if(!base || kind == RESTART_GLUCOSE)
+      return INT_MAX;
+    return base;
+  }
+
+  // Called at each restart; returns conflicts until the next.
+  int next(void) {
+    switch(kind) {
+      case RESTART_GLUCOSE:
+        lbd_recent = 0;
+        lbd_head = lbd_size = 0;
+        return INT_MAX;
+      case RESTART_LUBY:
+        return base * luby(++luby_idx);
+      case RESTART_INNER_OUTER:
+        if(inner >= outer) {
+          outer *= growth;
+          inner = base;
+        } else {
+          inner *= growth;
+        }
+        return inner;
+      default:
+        limit = limit * growth;
+        return limit;
+    }
+  }
+
+  // Called with the LBD of each new learnt. Returns
+  // true if we should restart now.
+  bool learnt(int lbd) {
+    if(!base || kind != RESTART_GLUCOSE)
+      return false;
+    lbd_total += lbd;
+    ++lbd_count;
+    if(lbd_size == lbd_window)
+      lbd_recent -= lbd_queue[lbd_head];
+    else
+      ++lbd_size;
+    lbd_queue[lbd_head] = lbd;
+    lbd_recent += lbd;
+    lbd_head = (lbd_head + 1) % lbd_window;
+    return lbd_size == lbd_window
+      && lbd_margin * lbd_recent / lbd_window > ((double) lbd_total) / lbd_count;
+  }
+
+protected:
+  restart_kind kind;
+  int base;
+  double growth;
+
+  // Geometric and inner/outer
+  int limit;
+  double inner;
+  double outer;
+
+  // Luby
+  int luby_idx;
+
+  // Glucose
+  long long lbd_total;
+  long long lbd_count;
+  int lbd_recent;
+  int lbd_queue[lbd_window];
+  int lbd_head;
+  int lbd_size;
+};
+
 void bump_touched(solver_data& s,
   double mult, double alpha, int confl_num, int touched_start) {
   for(int ti = touched_start; ti < s.persist.touched_preds.size(); ti++) {
@@ -1425,6 +2311,8 @@ void bump_touched(solver_data& s,
     if(s.pred_heap.inHeap(p))
       s.pred_heap.decrease(p);
   }
+  if(s.atom_act)
+    bump_atoms(&s, mult, touched_start);
 }
 
 void save_touched(solver_data& s, int touched_start) {
@@ -1458,13 +2346,80 @@ void solver::abort(void) {
   data->abort_solve = 1;
 }
 
-bool solver::is_aborted(void) const { return global_abort || data->abort_solve; }
+bool solver::is_aborted(void) const {
+  return (!data->is_worker && global_abort) || data->abort_solve;
+}
+
+// The objective bound follows from the incumbent rather than
+// from anything on the trail, so its explanation is empty:
+// conflict analysis and core extraction drop it.
+static void ex_obj_bound(void* ptr, int xi, pval_t pval, vec<clause_elt>& expl) { }
+
+// (Re-)establish the pending objective bound after backtracking.
+// If we've backjumped into a state which violates it, we keep
+// going back. Returns false if the bound is unsatisfiable.
+static bool post_obj_bound(solver_data& s) {
+  patom_t b(s.obj_bound);
+  if(is_inconsistent(s, b)) {
+    int l = atom_level(&s, ~b);
+    if(l == 0)
+      return false;
+    prop_cleanup(s);
+    bt_to_level(&s, l-1);
+    process_initializers(s);
+  }
+  if(!is_entailed(s, b))
+    enqueue(s, b, expl_thunk { ex_obj_bound, nullptr, 0 });
+  if(decision_level(s) == 0)
+    s.obj_bound = at_Undef;
+  return true;
+}
 
 // Solving
+// Re-rank the propagators by what they did since the last call.
+// Yield is atoms set (with conflicts weighted heavier) per
+// execution; well below the average, a propagator drops a level
+// under its own priority, so it only runs once the others are at
+// fixpoint; well above, it moves up a level. Only deterministic
+// counters are used, so the search doesn't depend on timing.
+static void reprioritize(solver_data& s) {
+  enum { Min_Execs = 8, Confl_Weight = 10 };
+  double useful = 0;
+  double execs = 0;
+  for(propagator* p : s.propagators) {
+    useful += (p->prof.prunings - p->prof_mark.prunings)
+      + Confl_Weight * (p->prof.conflicts - p->prof_mark.conflicts);
+    execs += p->prof.execs - p->prof_mark.execs;
+  }
+  if(execs == 0)
+    return;
+  double avg = useful / execs;
+
+  for(propagator* p : s.propagators) {
+    uint64_t p_execs = p->prof.execs - p->prof_mark.execs;
+    // Leave anything queued where it is.
+    if(p->is_queued || p_execs < Min_Execs)
+      continue;
+    double p_useful = (p->prof.prunings - p->prof_mark.prunings)
+      + Confl_Weight * (p->prof.conflicts - p->prof_mark.conflicts);
+    double eff = p_useful / p_execs;
+    if(eff < avg/2)
+      p->priority = min(p->base_priority+1, PRIO_LEVELS-1);
+    else if(eff > 2*avg)
+      p->priority = max(p->base_priority-1, 0);
+    else
+      p->priority = p->base_priority;
+    p->prof_mark = p->prof;
+  }
+}
+
 solver::result solver::solve(limits l) {
   // Top-level failure
   sdata& s(*data);
-  s.abort_solve = 0;
+  // A parallel_solver clears this itself, so an abort
+  // which races the start of the search isn't lost.
+  if(!s.is_worker)
+    s.abort_solve = 0;
   int confl_num = 0;
   s.infer.confl.clear();
 
@@ -1472,11 +2427,13 @@ solver::result solver::solve(limits l) {
     return UNSAT;
 
   /* Establish a handler for SIGINT and SIGTERM signals. */
-  set_handlers();
+  if(!s.is_worker)
+    set_handlers();
 
 #ifdef REPORT_INTERNAL_STATS
   stat_reporter rep(data);
 #endif
+  prof_reporter prof(*this);
 //  int max_conflicts = 200000;
   int max_conflicts = l.conflicts;
   double max_time = INFINITY;
@@ -1489,22 +2446,27 @@ solver::result solver::solve(limits l) {
 //  for(double& act : s.infer.pred_act)
 //    act = 0;
 
-  int restart_lim = s.opts.restart_limit;
-#ifdef RESTART_LUBY
-  unsigned int luby_m = 1;
-  unsigned int luby_r = 0;
-#endif
+  restart_sched restarts(s);
 
   // FIXME: On successive runs, this may be smaller than
   // the existing database
   int gc_lim = s.learnt_dbmax;
 
-  int next_restart = restart_lim ? restart_lim : INT_MAX;
-  int next_gc = max(1, gc_lim - s.infer.learnts.size());
+  int next_restart = restarts.first();
+  int next_gc = max(1, gc_lim - s.infer.num_reducible());
   // int next_gc = gc_lim - s.infer.learnts.size();
   int budget = max_conflicts;
 
   int next_pause = min(next_restart, next_gc);
+  // Set at a restart, until the first non-assumption decision.
+  double replay_start = -1;
+  // Restarts go back to the root for inprocessing every
+  // Inprocess_Conflicts conflicts, or whenever they would anyway.
+  enum { Inprocess_Conflicts = 2000 };
+  int next_inprocess = s.stats.conflicts + Inprocess_Conflicts;
+  bool inprocess_due = false;
+  double last_inprocess = start_time;
+  bool equiv_due = s.opts.bin_equiv;
   if(budget)
     next_pause = min(next_pause, budget);
 
@@ -1520,20 +2482,34 @@ solver::result solver::solve(limits l) {
 
   while(true) {
     // Signal handler
-    if(global_abort || s.abort_solve) {
+    if((!s.is_worker && global_abort) || s.abort_solve) {
       // fprintf(stderr, "%% Aborting solve.\n");
-      global_abort = 0;
+      if(!s.is_worker)
+        global_abort = 0;
       s.abort_solve = 0;
 
-      clear_handlers();
+      release_handlers(s);
       prop_cleanup(s);
       s.stats.conflicts += confl_num;
       s.stats.time += getTime() - start_time;
       return UNKNOWN;
     }
 
+    if(s.obj_bound != at_Undef && !post_obj_bound(s)) {
+      s.stats.conflicts += confl_num;
+      s.stats.time += getTime() - start_time;
+      s.last_confl = { C_Infer, 0 };
+      release_handlers(s);
+      s.solver_is_consistent = false;
+      return UNSAT;
+    }
+
     int touched_start = s.persist.touched_preds.size();
     if(!propagate(s)) {
+      if(replay_start >= 0) {
+        s.stats.replay_time += getTime() - replay_start;
+        replay_start = -1;
+      }
       // bump_touched(s, 1.0, alpha, /* s.stats.conflicts + */ confl_num, touched_start);
       bump_touched(s, 1.0, alpha, s.stats.conflicts + confl_num, touched_start);
       save_touched(s, touched_start);
@@ -1555,7 +2531,7 @@ solver::result solver::solve(limits l) {
         s.stats.time += getTime() - start_time;
         s.infer.confl.clear();
         s.last_confl = { C_Infer, 0 };
-        clear_handlers();
+        release_handlers(s);
         s.solver_is_consistent = false;
         return UNSAT;
       }
@@ -1568,15 +2544,15 @@ solver::result solver::solve(limits l) {
 #endif
 #ifdef CHECK_STATE
       for(int ei = 1; ei < s.infer.confl.size(); ei++)
-        assert(s.state.is_inconsistent(s.infer.confl[ei].atom));
+        assert(s.state.is_inconsistent(s.infer.confl[ei].atom()));
 #endif
       if(bt_level < s.infer.trail_lim.size())
         bt_to_level(&s, bt_level);
       process_initializers(s);
 #ifdef CHECK_STATE
-      assert(s.infer.confl[0].atom.ub(s.state.p_vals));
+      assert(s.infer.confl[0].atom().ub(s.state.p_vals));
       for(int ei = 1; ei < s.infer.confl.size(); ei++)
-        assert(s.state.is_inconsistent(s.infer.confl[ei].atom));
+        assert(s.state.is_inconsistent(s.infer.confl[ei].atom()));
 #endif
 #ifdef CHECK_STATE
       for(pid_t p : s.persist.touched_preds)
@@ -1600,6 +2576,11 @@ solver::result solver::solve(limits l) {
       add_learnt(&s, s.infer.confl, s.opts.one_watch);
       s.infer.confl.clear();
 
+      if(restarts.learnt(s.confl.learnt_lbd)) {
+        // Pause now, and restart.
+        next_restart = next_pause = confl_num;
+      }
+
       if(confl_num == next_pause) {
         s.stats.conflicts += confl_num;
         next_restart -= confl_num;
@@ -1609,7 +2590,7 @@ solver::result solver::solve(limits l) {
           // cout << budget << ", " << confl_num << endl;
           budget -= confl_num;
           if(!budget) {
-            clear_handlers();
+            release_handlers(s);
             s.stats.time += getTime() - start_time;
             return UNKNOWN;
           }
@@ -1623,40 +2604,48 @@ solver::result solver::solve(limits l) {
 #endif
           s.stats.restarts++;
   
-#ifdef RESTART_LUBY
-          if(luby_r & luby_m) {
-            luby_r ^= luby_m;
-            luby_m <<= 1;
-          } else {
-            luby_r |= luby_m;
+          next_restart = restarts.next();
+          // Restart callbacks expect to run at the root.
+          int restart_level = 0;
+          if(s.opts.inprocess_effort > 0
+             && (!s.opts.restart_reuse || s.stats.conflicts >= next_inprocess)) {
+            inprocess_due = true;
+            next_inprocess = s.stats.conflicts + Inprocess_Conflicts;
           }
-          next_restart = restart_lim * luby_m;
-#else
-          next_restart = restart_lim = restart_lim * s.opts.restart_growthrate;
-#endif
-          if(decision_level(s) > 0) {
+          // Not under assumptions: the search would seldom get back
+          // to the root, where simplification and GC happen.
+          if(s.opts.restart_reuse && s.on_restart.size() == 0 && !inprocess_due
+             && s.assumptions.size() == 0)
+            restart_level = reusable_level(&s, 0);
+          s.stats.reused_levels += restart_level;
+          replay_start = getTime();
+          if(restart_level < decision_level(s)) {
             prop_cleanup(s);
-            bt_to_level(&s, 0);
+            bt_to_level(&s, restart_level);
             process_initializers(s);
           }
           run_callbacks(s.on_restart);
+          if(s.opts.adaptive_priority)
+            reprioritize(s);
 #ifdef LOG_ALL
       log_state(s.state);
 #endif
 #ifdef CHECK_STATE
-          for(int pi = 0; pi < s.state.p_vals.size(); pi++)
-            assert(s.state.p_vals[pi] == s.state.p_root[pi]);
+          if(decision_level(s) == 0) {
+            for(int pi = 0; pi < s.state.p_vals.size(); pi++)
+              assert(s.state.p_vals[pi] == s.state.p_root[pi]);
+          }
 #endif
         }
         if(next_gc == 0) {
 #ifdef LOG_GC
           cout << "[| GC : " << s.infer.learnts.size() << "|]";
 #endif
-          if(s.infer.learnts.size() >= gc_lim) {
+          if(s.infer.num_reducible() >= gc_lim) {
             reduce_db(&s);
             gc_lim = gc_lim * s.opts.learnt_growthrate;
           }
-          next_gc = gc_lim - s.infer.learnts.size();
+          next_gc = gc_lim - s.infer.num_reducible();
 #ifdef LOG_GC
           cout << " ~~> " << s.infer.learnts.size()
             << " {" << s.infer.trail.size() << " trail}" << endl;
@@ -1668,7 +2657,7 @@ solver::result solver::solve(limits l) {
           next_pause = min(next_pause, budget);
         if(isfinite(max_time)) {
           if(getTime() > max_time) {
-            clear_handlers();
+            release_handlers(s);
             s.stats.time += getTime() - start_time;
             return UNKNOWN;
           }
@@ -1702,8 +2691,30 @@ solver::result solver::solve(limits l) {
     */
 #endif
 
-    if(decision_level(s) == 0)
+    if(decision_level(s) == 0) {
       simplify_at_root(s);
+      if(equiv_due) {
+        equiv_due = false;
+        if(!bin_equiv(s)) {
+          if(!s.solver_is_consistent) {
+            s.stats.conflicts += confl_num;
+            s.stats.time += getTime() - start_time;
+            s.last_confl = { C_Infer, 0 };
+            release_handlers(s);
+            return UNSAT;
+          }
+          continue;
+        }
+      }
+      if(inprocess_due) {
+        inprocess_due = false;
+        double now = getTime();
+        bool ok = inprocess(s, now + s.opts.inprocess_effort * (now - last_inprocess));
+        last_inprocess = getTime();
+        if(!ok)
+          continue;
+      }
+    }
 
     patom_t dec = at_Undef;
     
@@ -1719,7 +2730,7 @@ solver::result solver::solve(limits l) {
           s.last_confl = { C_Assump, assump_idx };
           s.stats.conflicts += confl_num;
           s.stats.time += getTime() - start_time;
-          clear_handlers();
+          release_handlers(s);
           return UNSAT; 
         }
 
@@ -1731,15 +2742,20 @@ solver::result solver::solve(limits l) {
       // trail_change(s.persist, s.assump_end, idx);
     }
     
-    if(dec == at_Undef)
+    if(dec == at_Undef) {
+      if(replay_start >= 0) {
+        s.stats.replay_time += getTime() - replay_start;
+        replay_start = -1;
+      }
       dec = branch(&s);
+    }
 
     if(dec == at_Undef) {
       save_model(data);
       s.stats.conflicts += confl_num;
       s.stats.solutions++;
       s.stats.time += getTime() - start_time;
-      clear_handlers();
+      release_handlers(s);
 
       run_callbacks(s.on_solution);
 
@@ -1780,10 +2796,106 @@ solver::result solver::solve(limits l) {
 
   // Unreachable
   GEAS_ERROR;
-  clear_handlers();
+  release_handlers(s);
   return SAT;
 }
 
+
+// Limits for the next call to solve, given we started with l
+// at stats st.
+limits limits_remaining(const limits& l, const statistics& st0, const statistics& st) {
+  limits r = l;
+  if(l.time > 0)
+    r.time = max(0.001, l.time - (st.time - st0.time));
+  if(l.conflicts > 0)
+    r.conflicts = max(1, l.conflicts - (st.conflicts - st0.conflicts));
+  return r;
+}
+
+bool limits_exhausted(const limits& l, const statistics& st0, const statistics& st) {
+  return (l.time > 0 && st.time - st0.time >= l.time)
+    || (l.conflicts > 0 && st.conflicts - st0.conflicts >= l.conflicts);
+}
+
+// The pending objective bound only lasts for the call
+// which set it.
+struct obj_bound_reset {
+  obj_bound_reset(solver_data& _s)
+    : s(_s) { }
+
+  ~obj_bound_reset(void) { s.obj_bound = at_Undef; }
+  solver_data& s;
+};
+
+solver::result solver::minimize(intvar obj, limits l, int probe_limit,
+                                solution_fn on_sol, void* ptr) {
+  solver_data& s(*data);
+  statistics st0(s.stats);
+  obj_bound_reset reset(s);
+
+  result r = solve(l);
+  if(r != SAT)
+    return r;
+
+  intvar::val_t best = s.incumbent[obj];
+  if(on_sol)
+    on_sol(ptr, s.incumbent, best);
+
+  while(true) {
+    if(probe_limit > 0) {
+      // Look for much better solutions, doubling the step
+      // while we keep finding them.
+      intvar::val_t lb = obj.lb(s.ctx0());
+      intvar::val_t step = 1;
+      while(lb < best && !limits_exhausted(l, st0, s.stats)) {
+        intvar::val_t mid = max(lb, best - step);
+        if(!assume(obj <= mid)) {
+          retract();
+          break;
+        }
+        limits pl = limits_remaining(l, st0, s.stats);
+        if(pl.conflicts == 0 || pl.conflicts > probe_limit)
+          pl.conflicts = probe_limit;
+        result pr = solve(pl);
+        retract();
+        if(pr == SAT) {
+          best = s.incumbent[obj];
+          if(on_sol)
+            on_sol(ptr, s.incumbent, best);
+          step *= 2;
+        } else if(pr == UNSAT) {
+          if(!s.solver_is_consistent)
+            return SAT;
+          lb = mid+1;
+          step = 1;
+        } else {
+          break;
+        }
+      }
+      if(lb >= best)
+        return SAT;
+    }
+
+    // Post the new bound, keeping whatever part of
+    // the search state is consistent with it.
+    s.obj_bound = obj < best;
+    if(!post_obj_bound(s)) {
+      s.solver_is_consistent = false;
+      return SAT;
+    }
+    if(limits_exhausted(l, st0, s.stats))
+      return UNKNOWN;
+
+    r = solve(limits_remaining(l, st0, s.stats));
+    if(r == UNSAT)
+      return SAT;
+    if(r == UNKNOWN)
+      return UNKNOWN;
+    best = s.incumbent[obj];
+    if(on_sol)
+      on_sol(ptr, s.incumbent, best);
+  }
+}
  
 // For incremental solving; any constraints
 // added after a push are paired with an activation
@@ -1805,9 +2917,9 @@ void solver::get_conflict(vec<patom_t>& confl) {
 // For subsumption detection
 struct {
   bool operator()(const clause_elt& x, const clause_elt& y) const {
-    if(x.atom.pid == y.atom.pid)
-      return x.atom.val < y.atom.val; 
-    return x.atom.pid < y.atom.pid;
+    if(x.atom().pid == y.atom().pid)
+      return x.atom().val < y.atom().val; 
+    return x.atom().pid < y.atom().pid;
   }
 } cmp_clause_elt;
 
@@ -1815,9 +2927,9 @@ struct {
 bool add_clause(solver_data& s, vec<clause_elt>& elts) {
   int jj = 0;
   for(clause_elt e : elts) {
-    if(s.state.is_entailed(e.atom))
+    if(s.state.is_entailed(e.atom()))
       return true;
-    if(s.state.is_inconsistent(e.atom))
+    if(s.state.is_inconsistent(e.atom()))
       continue;
     elts[jj++] = e;
   }
@@ -1833,7 +2945,7 @@ bool add_clause(solver_data& s, vec<clause_elt>& elts) {
   sort(elts.begin(), elts.end(), cmp_clause_elt);
   jj = 1;
   for(int ii = 1; ii < elts.size(); ++ii) {
-    if(elts[ii-1].atom.pid != elts[ii].atom.pid) {
+    if(elts[ii-1].atom().pid != elts[ii].atom().pid) {
       elts[jj++] = elts[ii];
     }
   }
@@ -1841,29 +2953,33 @@ bool add_clause(solver_data& s, vec<clause_elt>& elts) {
 
   // Unit at root level
   if(elts.size() == 1)
-    return enqueue(s, elts[0].atom, reason()); 
+    return enqueue(s, elts[0].atom(), reason()); 
   
   // Binary clause; embed the -other- literal
   // in the head;
   if(elts.size() == 2) {
     /*
-    clause_head h0(elts[0].atom);
-    clause_head h1(elts[1].atom);
+    clause_head h0(elts[0].atom());
+    clause_head h1(elts[1].atom());
 
     find_watchlist(s, elts[0]).push(h1);
     find_watchlist(s, elts[1]).push(h0); 
     */
-    find_bin_watchlist(s, elts[0]).push(elts[1].atom);
-    find_bin_watchlist(s, elts[1]).push(elts[0].atom);
+    attach_binary(s, elts[0], elts[1]);
   } else {
     // Normal clause
-    clause* c(clause_new(elts));
-    // Any two watches should be fine
-    clause_head h(elts.last().atom, c);
+    cref cr(s.infer.alloc_clause(elts));
+    clause* c(s.infer.arena.lea(cr));
+    if(elts.size() == 3) {
+      attach_ternary(s, cr);
+    } else {
+      // Any two watches should be fine
+      clause_head h(elts.last().atom(), cr);
 
-    find_watchlist(s, (*c)[0]).push(h);
-    find_watchlist(s, (*c)[1]).push(h); 
-    s.infer.clauses.push(c);
+      find_watchlist(s, (*c)[0]).push_long(h);
+      find_watchlist(s, (*c)[1]).push_long(h); 
+    }
+    s.infer.clauses.push(cr);
   }
   return true;
 }
@@ -1873,12 +2989,12 @@ bool add_clause_(solver_data& s, vec<clause_elt>& elts) {
   int jj = 0;
   int kk = 0;
   for(clause_elt e : elts) {
-    if(s.state.is_entailed_l0(e.atom))
+    if(s.state.is_entailed_l0(e.atom()))
       return true;
-    if(s.state.is_inconsistent_l0(e.atom))
+    if(s.state.is_inconsistent_l0(e.atom()))
       continue;
-    // if(s.state.is_inconsistent_prev(e.atom)) {
-    if(s.state.is_inconsistent(e.atom)) {
+    // if(s.state.is_inconsistent_prev(e.atom())) {
+    if(s.state.is_inconsistent(e.atom())) {
       elts[jj++] = e;
     } else {
       elts[jj++] = elts[kk];
@@ -1893,7 +3009,7 @@ bool add_clause_(solver_data& s, vec<clause_elt>& elts) {
   // Unit at root level
   /*
   if(elts.size() == 1)
-    return enqueue(s, elts[0].atom, reason()); 
+    return enqueue(s, elts[0].atom(), reason()); 
     */
   if(elts.size() == 1)
     return true;
@@ -1901,31 +3017,35 @@ bool add_clause_(solver_data& s, vec<clause_elt>& elts) {
   // in the head;
   if(elts.size() == 2) {
     /*
-    clause_head h0(elts[0].atom);
-    clause_head h1(elts[1].atom);
+    clause_head h0(elts[0].atom());
+    clause_head h1(elts[1].atom());
 
     find_watchlist(s, elts[0]).push(h1);
     find_watchlist(s, elts[1]).push(h0); 
     */
-    find_bin_watchlist(s, elts[0]).push(elts[1].atom);
-    find_bin_watchlist(s, elts[1]).push(elts[0].atom);
+    attach_binary(s, elts[0], elts[1]);
     return true;
     /*
-    if(s.state.is_inconsistent(elts[1].atom))
-      return enqueue(s, elts[0].atom, elts[1].atom);
+    if(s.state.is_inconsistent(elts[1].atom()))
+      return enqueue(s, elts[0].atom(), elts[1].atom());
       */
   } else {
     // Normal clause
-    clause* c(clause_new(elts));
-    clause_head h(elts.last().atom, c);
+    cref cr(s.infer.alloc_clause(elts));
+    clause* c(s.infer.arena.lea(cr));
+    if(elts.size() == 3) {
+      attach_ternary(s, cr);
+    } else {
+      clause_head h(elts.last().atom(), cr);
 
-    find_watchlist(s, (*c)[0]).push(h);
-    find_watchlist(s, (*c)[1]).push(h); 
+      find_watchlist(s, (*c)[0]).push_long(h);
+      find_watchlist(s, (*c)[1]).push_long(h); 
+    }
     /*
-    if(s.state.is_inconsistent(elts[1].atom))
-      return enqueue(s, elts[0].atom, c);
+    if(s.state.is_inconsistent(elts[1].atom()))
+      return enqueue(s, elts[0].atom(), c);
       */
-    s.infer.clauses.push(c);
+    s.infer.clauses.push(cr);
     return true;
   }
   return true;
@@ -47,6 +47,17 @@ void intvar::attach(solver_data* s, intvar_event e, watch_callback c) {
   attach(e, c);
 }
 
+void intvar::attach_batch(intvar_event e, batch_set& b, int id) {
+  assert(!(e&E_FIX));
+  b.add(id);
+  if(e&E_LB) {
+    ext->b_batches[p&1].push(batch_watch { &b, id });
+  }
+  if(e&E_UB) {
+    ext->b_batches[(p&1)^1].push(batch_watch { &b, id });
+  }
+}
+
 void intvar::attach_rem(val_callback<int64_t> c) {
   // man->attach(idx, e, c);
   ext->rem_callbacks.push(ivar_ext::rem_info { c, off });
@@ -104,6 +115,8 @@ static watch_result wakeup(void* ptr, int idx) {
     run_watches(man->var_exts[vi]->fix_callbacks, origin);
   }
   run_watches(man->var_exts[vi]->b_callbacks[idx&1], origin);
+  for(batch_watch& w : man->var_exts[vi]->b_batches[idx&1])
+    w.set->mark(w.id, origin);
 
   return Wt_Keep;
 }
@@ -377,8 +390,7 @@ bool ivar_ext::make_sparse(vec<pval_t>& _vs) {
 
   kind = IV_Strict;
 
-  // Make the watch-maps sparse.
-// #if 0
+  // Narrow the watch-maps, if the remaining range is small.
   s->infer.make_sparse(p, vs);
   vec<pval_t> inv_vs;
   for(int ii = vs.size()-1; ii >= 0; --ii)
@@ -388,15 +400,12 @@ bool ivar_ext::make_sparse(vec<pval_t>& _vs) {
   // Set global bounds and gaps
   if(!enqueue(*s, ge_atom(p, vs[0]), reason()))
     return false;
-#ifndef SPARSE_WATCHES
-  // Now done in make_sparse.
   for(int vi = 1; vi < vs.size(); vi++) {
     if(vs[vi-1]+1 == vs[vi])
       continue;
     if(!add_clause(s, le_atom(p, vs[vi-1]), ge_atom(p, vs[vi])))
       return false;
   }
-#endif
   if(!enqueue(*s, le_atom(p, vs.last()), reason()))
     return false;
 
@@ -527,9 +536,24 @@ patom_t ivar_ext::get_eqatom(pval_t val) {
 
   // eqtable.insert(std::make_pair(val, at));
   ADD(eqtable, val, at);
+  get_ivar_man(s)->lazy_eqs[at.pid&~1] = intvar_manager::eq_key { idx, val };
   return at;
 }
 
+bool intvar_manager::lazy_eq_key(pid_t p, eq_key& k) const {
+  auto it = lazy_eqs.find(p&~1);
+  if(it == lazy_eqs.end())
+    return false;
+  k = (*it).second;
+  return true;
+}
+
+patom_t intvar_manager::find_eqatom(eq_key k) {
+  if(k.var_idx >= var_exts.size())
+    return at_Undef;
+  return var_exts[k.var_idx]->get_eqatom(k.val);
+}
+
 intvar new_intvar(solver_data* s, intvar::val_t lb, intvar::val_t ub) {
   return get_ivar_man(s)->new_var(lb, ub);
 }
@@ -5,6 +5,8 @@
 
 #include <geas/constraints/builtins.h>
 
+#include "solutions.h"
+
 using namespace geas;
 
 std::ostream& operator<<(std::ostream& o, const solver::result& r) {
@@ -50,7 +52,65 @@ void test1(void) {
   }
 }
 
+// Count the solutions of sum_i ks[i] * xs[i] <= k, xs[i] in [0, 2],
+// both by enumeration and by brute force.
+void check_count(vec<int>& ks, int k) {
+  int n = ks.size();
+  int expected = 0;
+  int total = 1;
+  for(int ii = 0; ii < n; ++ii)
+    total *= 3;
+  for(int code = 0; code < total; ++code) {
+    int sum = 0;
+    for(int ii = 0, c = code; ii < n; ++ii, c /= 3)
+      sum += ks[ii] * (c % 3);
+    if(sum <= k)
+      ++expected;
+  }
+
+  solver s;
+  vec<intvar> xs;
+  for(int ii = 0; ii < n; ++ii)
+    xs.push(s.new_intvar(0, 2));
+  vec<int> cs(ks);
+  vec<intvar> vs(xs);
+  if(!linear_le(s.data, cs, vs, k))
+    GEAS_ERROR;
+  int count = count_solutions(s, xs, [&](const model& m) {
+      int sum = 0;
+      for(int ii = 0; ii < n; ++ii)
+        sum += ks[ii] * m[xs[ii]];
+      if(sum > k)
+        GEAS_ERROR;
+    });
+  fprintf(stdout, "%d solutions (expected %d)\n", count, expected);
+  if(count != expected)
+    GEAS_ERROR;
+}
+
+void test2(void) {
+  std::cout << "Testing long linear (batched wakeups)." << std::endl;
+  vec<int> ks { 1, 3, -2, 5, 2, -1, 4 };
+  check_count(ks, 7);
+}
+
+void test3(void) {
+  std::cout << "Testing short linear with a fixed term. Expected: SAT" << std::endl;
+  solver s;
+  intvar x = s.new_intvar(-1, 0);
+  intvar y = s.new_intvar(-5, 8);
+  intvar z = s.new_intvar(3, 3);
+  vec<int> ks { 1, 1, -1 };
+  vec<intvar> xs { x, y, z };
+  linear_le(s.data, ks, xs, 0);
+  vec<patom_t> as { x <= -1, y >= 4 };
+  if(!s.assume(as.begin(), as.end()) || s.solve() != solver::SAT)
+    GEAS_ERROR;
+}
+
 int main(int argc, char** argv) {
   test1();
+  test2();
+  test3();
   return 0;
 }
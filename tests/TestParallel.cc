@@ -0,0 +1,137 @@
+#include <iostream>
+#include <cstdio>
+#include <csignal>
+#include <thread>
+#include <chrono>
+#include <geas/solver/solver.h>
+#include <geas/solver/solver_data.h>
+#include <geas/solver/parallel.h>
+
+#include <geas/constraints/builtins.h>
+
+using namespace geas;
+
+std::ostream& operator<<(std::ostream& o, const solver::result& r) {
+  switch(r) {
+    case solver::SAT:
+      o << "SAT";
+      break;
+    case solver::UNSAT:
+      o << "UNSAT";
+      break;
+    default:
+      o << "UNKNOWN";
+  }
+  return o;
+}
+
+// Pigeonhole: p pigeons, h holes.
+struct php_data { int p; int h; };
+
+bool build_php(solver& s, int worker_id, void* ptr) {
+  php_data* d(static_cast<php_data*>(ptr));
+  vec< vec<patom_t> > x(d->p);
+  for(int ii = 0; ii < d->p; ++ii) {
+    for(int jj = 0; jj < d->h; ++jj)
+      x[ii].push(s.new_boolvar());
+  }
+  for(int ii = 0; ii < d->p; ++ii) {
+    vec<clause_elt> cl;
+    for(int jj = 0; jj < d->h; ++jj)
+      cl.push(x[ii][jj]);
+    if(!add_clause(*s.data, cl))
+      return false;
+  }
+  for(int jj = 0; jj < d->h; ++jj) {
+    for(int ii = 0; ii < d->p; ++ii) {
+      for(int kk = ii+1; kk < d->p; ++kk) {
+        if(!add_clause(s.data, ~x[ii][jj], ~x[kk][jj]))
+          return false;
+      }
+    }
+  }
+  return true;
+}
+
+// n-queens; each worker's variables are kept for checking.
+struct queens_data { int n; vec< vec<intvar> > xs; };
+
+bool build_queens(solver& s, int worker_id, void* ptr) {
+  queens_data* d(static_cast<queens_data*>(ptr));
+  int n = d->n;
+  d->xs.growTo(worker_id+1);
+  vec<intvar>& xs(d->xs[worker_id]);
+  for(int ii = 0; ii < n; ++ii)
+    xs.push(s.new_intvar(0, n-1));
+  for(int ii = 0; ii < n; ++ii) {
+    for(int jj = ii+1; jj < n; ++jj) {
+      if(!int_ne(s.data, xs[ii], xs[jj])
+         || !int_ne(s.data, xs[ii] + ii, xs[jj] + jj)
+         || !int_ne(s.data, xs[ii] - ii, xs[jj] - jj))
+        return false;
+    }
+  }
+  return true;
+}
+
+void test1(void) {
+  std::cout << "Testing parallel pigeonhole 8/7. Expected: UNSAT" << std::endl;
+  php_data d = { 8, 7 };
+  parallel_solver ps(build_php, &d);
+  solver::result r = ps.solve();
+  std::cout << "Result: " << r << " (worker " << ps.winner() << ")" << std::endl;
+  statistics st(ps.get_statistics());
+  fprintf(stdout, "%d conflicts, %d restarts, %d learnts exported, %d imported\n",
+    st.conflicts, st.restarts, ps.num_exported(), ps.num_imported());
+  if(r != solver::UNSAT)
+    exit(1);
+  if(ps.num_exported() == 0 || ps.num_imported() == 0)
+    exit(1);
+}
+
+void test2(void) {
+  std::cout << "Testing parallel 12-queens. Expected: SAT" << std::endl;
+  queens_data d;
+  d.n = 12;
+  parallel_solver ps(build_queens, &d);
+  solver::result r = ps.solve();
+  std::cout << "Result: " << r << " (worker " << ps.winner() << ")" << std::endl;
+  if(r != solver::SAT)
+    exit(1);
+
+  // Check the model against the winning worker's variables.
+  model m(ps.get_model());
+  vec<int> q;
+  for(intvar x : d.xs[ps.winner()])
+    q.push(m[x]);
+  for(int ii = 0; ii < d.n; ++ii) {
+    for(int jj = ii+1; jj < d.n; ++jj) {
+      if(q[ii] == q[jj] || q[ii] + ii == q[jj] + jj || q[ii] - ii == q[jj] - jj) {
+        std::cout << "Invalid model." << std::endl;
+        exit(1);
+      }
+    }
+  }
+}
+
+void test3(void) {
+  std::cout << "Testing SIGINT during parallel pigeonhole 12/11. Expected: UNKNOWN" << std::endl;
+  php_data d = { 12, 11 };
+  parallel_solver ps(build_php, &d);
+  std::thread t([](void) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    raise(SIGINT);
+  });
+  solver::result r = ps.solve();
+  t.join();
+  std::cout << "Result: " << r << std::endl;
+  if(r != solver::UNKNOWN)
+    exit(1);
+}
+
+int main(int argc, char** argv) {
+  test1();
+  test2();
+  test3();
+  return 0;
+}
@@ -1,9 +1,15 @@
 #include <iostream>
 #include <cstdio>
+#include <cstring>
 #include <geas/solver/solver.h>
 #include <geas/solver/solver_data.h>
+#include <geas/solver/core_opt.h>
+#include <geas/solver/lns.h>
 
 #include <geas/constraints/builtins.h>
+#include <geas/constraints/mdd.h>
+
+#include "solutions.h"
 
 using namespace geas;
 
@@ -159,12 +165,896 @@ void test5(void) {
   }
 }
 
+// Pigeonhole under an assumption, with frequent restarts.
+solver::result pigeons(int n, bool reuse, statistics& st) {
+  options opts(default_options);
+  opts.restart_limit = 5;
+  opts.restart_growthrate = 1.0;
+  opts.restart_policy = RESTART_GEOMETRIC;
+  opts.restart_reuse = reuse;
+  solver s(opts);
+
+  patom_t b = s.new_boolvar();
+  vec<intvar> xs;
+  for(int ii = 0; ii < n; ++ii)
+    xs.push(s.new_intvar(0, n-2));
+  for(int ii = 0; ii < n; ++ii) {
+    for(int jj = ii+1; jj < n; ++jj)
+      int_ne(s.data, xs[ii], xs[jj], b);
+  }
+  s.assume(b);
+  s.assume(xs[0] <= n/2);
+  solver::result r = s.solve();
+  st = s.data->stats;
+  return r;
+}
+
+static void set_act(solver_data* s, patom_t p, double act) {
+  s->infer.pred_act[p.pid>>1] = act;
+  if(s->pred_heap.inHeap(p.pid>>1))
+    s->pred_heap.update(p.pid>>1);
+}
+
+void test6(void) {
+  std::cout << "Testing partial restarts. Expected: UNSAT" << std::endl;
+  // Decisions on preds more active than the best unfixed pred
+  // are kept.
+  {
+    solver s;
+    patom_t x = s.new_boolvar();
+    patom_t y = s.new_boolvar();
+    patom_t z = s.new_boolvar();
+    push_level(s.data);
+    if(!enqueue(*s.data, x, reason()))
+      GEAS_ERROR;
+    push_level(s.data);
+    if(!enqueue(*s.data, y, reason()))
+      GEAS_ERROR;
+    set_act(s.data, x, 4.0);
+    set_act(s.data, y, 4.0);
+    set_act(s.data, z, 1.0);
+    if(reusable_level(s.data, 0) != 2)
+      GEAS_ERROR;
+    set_act(s.data, y, 0.5);
+    if(reusable_level(s.data, 0) != 1)
+      GEAS_ERROR;
+    if(reusable_level(s.data, 2) != 2)
+      GEAS_ERROR;
+  }
+  // Under assumptions, restarts go back to the root.
+  statistics st_full, st_reuse;
+  solver::result r_full = pigeons(7, false, st_full);
+  solver::result r_reuse = pigeons(7, true, st_reuse);
+  std::cout << "Result: " << r_reuse << std::endl;
+  if(r_full != solver::UNSAT || r_reuse != solver::UNSAT)
+    GEAS_ERROR;
+  if(st_full.reused_levels != 0 || st_reuse.reused_levels != 0)
+    GEAS_ERROR;
+}
+
+static void record_obj(void* ptr, const model& m, intvar::val_t obj) {
+  vec<intvar::val_t>* objs(static_cast<vec<intvar::val_t>*>(ptr));
+  objs->push(obj);
+}
+
+// Weighted assignment; the optimum pairs the largest
+// weights with the smallest values.
+solver::result assign_min(int probe_limit, vec<intvar::val_t>& objs) {
+  solver s;
+  int ws[] = { 7, 3, 5, 2, 8, 6 };
+  vec<intvar> xs;
+  vec<int> ks;
+  for(int ii = 0; ii < 6; ++ii) {
+    xs.push(s.new_intvar(0, 9));
+    ks.push(ws[ii]);
+  }
+  for(int ii = 0; ii < 6; ++ii) {
+    for(int jj = ii+1; jj < 6; ++jj)
+      int_ne(s.data, xs[ii], xs[jj]);
+  }
+  intvar obj = s.new_intvar(0, 500);
+  xs.push(obj);
+  ks.push(-1);
+  linear_le(s.data, ks, xs, 0);
+
+  return s.minimize(obj, no_limit, probe_limit, record_obj, &objs);
+}
+
+void test7(void) {
+  std::cout << "Testing minimize. Expected: 56" << std::endl;
+  for(int probe : { 0, 10 }) {
+    vec<intvar::val_t> objs;
+    if(assign_min(probe, objs) != solver::SAT)
+      GEAS_ERROR;
+    for(int ii = 1; ii < objs.size(); ++ii) {
+      if(objs[ii] >= objs[ii-1])
+        GEAS_ERROR;
+    }
+    fprintf(stdout, "Optimum: %lld (%d solutions, probing %d)\n",
+      (long long) objs.last(), objs.size(), probe);
+    if(objs.last() != 56)
+      GEAS_ERROR;
+  }
+}
+
+// The same problem, with the objective handed to the
+// core-guided engine as a sum of terms.
+solver::result assign_core(const core_options& o, vec<intvar::val_t>& objs,
+                           intvar::val_t& model_obj) {
+  solver s;
+  int ws[] = { 7, 3, 5, 2, 8, 6 };
+  vec<intvar> xs;
+  vec<int> ks;
+  for(int ii = 0; ii < 6; ++ii) {
+    xs.push(s.new_intvar(0, 9));
+    ks.push(ws[ii]);
+  }
+  for(int ii = 0; ii < 6; ++ii) {
+    for(int jj = ii+1; jj < 6; ++jj)
+      int_ne(s.data, xs[ii], xs[jj]);
+  }
+  solver::result r = minimize_core(s, ks, xs, 0, no_limit, o, record_obj, &objs);
+  model m(s.get_model());
+  model_obj = 0;
+  for(int ii = 0; ii < 6; ++ii)
+    model_obj += ws[ii] * m[xs[ii]];
+  return r;
+}
+
+void test8(void) {
+  std::cout << "Testing core-guided minimize. Expected: 56" << std::endl;
+  core_options plain = { 1.0, 0, 0, 0, 0 };
+  core_options harden = default_core_options;
+  harden.harden = 1;
+  core_options bb = default_core_options;
+  bb.core_ratio = 0;
+  for(core_options o : { default_core_options, plain, harden, bb }) {
+    vec<intvar::val_t> objs;
+    intvar::val_t model_obj;
+    if(assign_core(o, objs, model_obj) != solver::SAT)
+      GEAS_ERROR;
+    for(int ii = 1; ii < objs.size(); ++ii) {
+      if(objs[ii] >= objs[ii-1])
+        GEAS_ERROR;
+    }
+    fprintf(stdout, "Optimum: %lld (%d solutions)\n",
+      (long long) objs.last(), objs.size());
+    if(objs.last() != 56 || model_obj != 56)
+      GEAS_ERROR;
+  }
+}
+
+void test9(void) {
+  std::cout << "Testing propagator profile." << std::endl;
+  options opts(default_options);
+  opts.prop_profile = 1;
+  solver s(opts);
+  vec<intvar> xs;
+  for(int ii = 0; ii < 10; ++ii)
+    xs.push(s.new_intvar(0, 9));
+  all_different_int(s.data, xs);
+  for(int ii = 0; ii < 10; ++ii) {
+    for(int jj = ii+1; jj < 10; ++jj) {
+      int_ne(s.data, xs[ii] + ii, xs[jj] + jj);
+      int_ne(s.data, xs[ii] - ii, xs[jj] - jj);
+    }
+  }
+  if(s.solve() != solver::SAT)
+    GEAS_ERROR;
+
+  vec<prop_profile> ps;
+  s.get_propagator_profile(ps);
+  int count = 0;
+  long long execs = 0;
+  long long explains = 0;
+  for(const prop_profile& p : ps) {
+    fprintf(stdout, "  %s: %d props, %lld wakeups, %lld execs, %lld prunings, %lld conflicts, %lld explains\n",
+      p.kind, p.count, p.wakeups, p.execs, p.prunings, p.conflicts, p.explains);
+    if(p.execs > p.wakeups || p.conflicts > p.execs)
+      GEAS_ERROR;
+    if(strcmp(p.kind, "alldiff_dc") && strcmp(p.kind, "diff_manager"))
+      GEAS_ERROR;
+    count += p.count;
+    execs += p.execs;
+    explains += p.explains;
+  }
+  if(count != s.data->propagators.size() || execs == 0 || explains == 0)
+    GEAS_ERROR;
+  for(int ii = 1; ii < ps.size(); ++ii) {
+    if(ps[ii-1].cycles < ps[ii].cycles)
+      GEAS_ERROR;
+  }
+  print_propagator_profile(s, stdout);
+}
+
+// n-queens, as three alldiffs.
+vec<intvar> post_queens(solver& s, int n) {
+  vec<intvar> xs, us, ds;
+  for(int ii = 0; ii < n; ++ii) {
+    xs.push(s.new_intvar(0, n-1));
+    us.push(xs[ii] + ii);
+    ds.push(xs[ii] - ii);
+  }
+  all_different_int(s.data, xs);
+  all_different_int(s.data, us);
+  all_different_int(s.data, ds);
+  return xs;
+}
+
+// Priority shifts of two propagators as of the second restart;
+// that is, after the first re-ranking.
+struct prio_watch {
+  propagator* slow;
+  propagator* fast;
+  int restarts;
+  int slow_shift;
+  int fast_shift;
+};
+
+void record_priorities(void* ptr) {
+  prio_watch* w(static_cast<prio_watch*>(ptr));
+  if(++w->restarts != 2)
+    return;
+  w->slow_shift = w->slow->priority - w->slow->base_priority;
+  w->fast_shift = w->fast->priority - w->fast->base_priority;
+}
+
+// All solutions of n-queens, restarting often.
+int count_queens(int n, int adaptive, int atom_branch = 0,
+                 prio_watch* w = nullptr) {
+  options o(default_options);
+  o.restart_limit = 5;
+  o.restart_growthrate = 1.0;
+  o.restart_policy = RESTART_GEOMETRIC;
+  o.adaptive_priority = adaptive;
+  o.atom_branch = atom_branch;
+  solver s(o);
+  vec<intvar> xs(post_queens(s, n));
+  if(w) {
+    // Skew the counters: the first alldiff looks busy and
+    // useless, the last productive.
+    w->slow = s.data->propagators[0];
+    w->fast = s.data->propagators.last();
+    w->slow->prof.execs += 1000;
+    w->fast->prof.execs += 100;
+    w->fast->prof.prunings += 1000000;
+    s.data->on_restart.push(event_callback(record_priorities, w));
+  }
+  int count = count_solutions(s, xs);
+  for(propagator* p : s.data->propagators) {
+    if(p->priority + 1 < p->base_priority || p->priority > p->base_priority + 1)
+      GEAS_ERROR;
+  }
+  return count;
+}
+
+// Conflicts to find the first sols solutions of n-queens,
+// with the default options.
+long long queens_conflicts(int n, int sols) {
+  options o(default_options);
+  o.restart_limit = 50;
+  o.restart_policy = RESTART_GEOMETRIC;
+  solver s(o);
+  vec<intvar> xs(post_queens(s, n));
+  count_solutions(s, xs, sols);
+  return s.data->stats.conflicts;
+}
+
+void test10(void) {
+  std::cout << "Testing adaptive priorities. Expected: 92 solutions" << std::endl;
+  int fixed = count_queens(8, 0);
+  int adaptive = count_queens(8, 1);
+  fprintf(stdout, "Solutions: %d fixed, %d adaptive\n", fixed, adaptive);
+  if(fixed != 92 || adaptive != 92)
+    GEAS_ERROR;
+
+  // With skewed activity, the first re-ranking must demote the
+  // slow propagator and promote the fast one (both alldiff_dc,
+  // at PRIO_LOW, so there is room either way).
+  prio_watch w { nullptr, nullptr, 0, 0, 0 };
+  if(count_queens(8, 1, 0, &w) != 92 || w.restarts < 2)
+    GEAS_ERROR;
+  fprintf(stdout, "Priority shifts: %d slow, %d fast\n", w.slow_shift, w.fast_shift);
+  if(w.slow_shift != 1 || w.fast_shift != -1)
+    GEAS_ERROR;
+
+  // Re-ranking must not make the search depend on timing.
+  long long c0 = queens_conflicts(30, 200);
+  long long c1 = queens_conflicts(30, 200);
+  fprintf(stdout, "Conflicts: %lld, %lld\n", c0, c1);
+  if(c0 != c1)
+    GEAS_ERROR;
+}
+
+void test11(void) {
+  std::cout << "Testing atom activity branching. Expected: 4, 92 solutions" << std::endl;
+  int n6 = count_queens(6, 1, 1);
+  int n8 = count_queens(8, 1, 1);
+  fprintf(stdout, "Solutions: %d, %d\n", n6, n8);
+  if(n6 != 4 || n8 != 92)
+    GEAS_ERROR;
+}
+
+// Pigeonhole: p pigeons into p-1 holes.
+solver::result php(int p, restart_kind policy, int& restarts) {
+  options o(default_options);
+  o.restart_limit = 20;
+  o.restart_policy = policy;
+  solver s(o);
+  vec< vec<patom_t> > xs(p);
+  for(int ii = 0; ii < p; ++ii) {
+    vec<clause_elt> cl;
+    for(int jj = 0; jj < p-1; ++jj) {
+      xs[ii].push(s.new_boolvar());
+      cl.push(xs[ii][jj]);
+    }
+    add_clause(*s.data, cl);
+  }
+  for(int jj = 0; jj < p-1; ++jj) {
+    for(int ii = 0; ii < p; ++ii) {
+      for(int kk = ii+1; kk < p; ++kk)
+        add_clause(s.data, ~xs[ii][jj], ~xs[kk][jj]);
+    }
+  }
+  solver::result r = s.solve();
+  restarts = s.data->stats.restarts;
+  return r;
+}
+
+void test12(void) {
+  std::cout << "Testing restart policies. Expected: UNSAT" << std::endl;
+  restart_kind policies[] = { RESTART_AUTO, RESTART_GEOMETRIC, RESTART_LUBY,
+                              RESTART_GLUCOSE, RESTART_INNER_OUTER };
+  for(restart_kind k : policies) {
+    int restarts;
+    solver::result r = php(7, k, restarts);
+    std::cout << "Policy " << k << ": " << r << " (" << restarts << " restarts)" << std::endl;
+    if(r != solver::UNSAT || restarts == 0)
+      GEAS_ERROR;
+  }
+}
+
+static void count_sol(void* ptr, const model& m, intvar::val_t obj) {
+  ++*static_cast<int*>(ptr);
+}
+
+// Makespan of a random single-resource schedule, by
+// branch-and-bound (lns = 0), or LNS with a conflict limit
+// (0 for none). LNS starts from a poor solution (makespan
+// at least 8n), so has something to improve; improvements
+// counts the solutions it finds.
+int schedule(int n, bool lns, int conflicts, solver::result& r, int& improvements) {
+  srand(7);
+  solver s;
+  vec<intvar> xs;
+  vec<int> du, rs;
+  intvar mk = s.new_intvar(0, 10*n);
+  for(int ii = 0; ii < n; ++ii) {
+    xs.push(s.new_intvar(0, 10*n));
+    du.push(1 + rand()%6);
+    rs.push(1 + rand()%3);
+    int_le(s.data, xs[ii], mk, -du[ii]);
+  }
+  cumulative(s.data, xs, du, rs, 4);
+  limits l = no_limit;
+  l.conflicts = conflicts;
+  improvements = 0;
+  if(lns) {
+    s.assume(mk >= 8*n);
+    if(s.solve() != solver::SAT)
+      GEAS_ERROR;
+    s.clear_assumptions();
+    lns_options o = default_lns_options;
+    o.conflicts = 50;
+    r = minimize_lns(s, mk, xs, l, o, count_sol, &improvements);
+  } else {
+    r = s.minimize(mk, l);
+  }
+  // The bound doesn't outlive the call.
+  if(s.data->obj_bound != at_Undef)
+    GEAS_ERROR;
+  if(r != solver::SAT && r != solver::UNKNOWN)
+    return -1;
+  model m(s.get_model());
+  // Check the solution.
+  for(int t = 0; t < m[mk]; ++t) {
+    int load = 0;
+    for(int ii = 0; ii < n; ++ii) {
+      if(m[xs[ii]] <= t && t < m[xs[ii]] + du[ii])
+        load += rs[ii];
+    }
+    if(load > 4)
+      GEAS_ERROR;
+  }
+  for(int ii = 0; ii < n; ++ii) {
+    if(m[xs[ii]] + du[ii] > m[mk])
+      GEAS_ERROR;
+  }
+  return m[mk];
+}
+
+void test13(void) {
+  std::cout << "Testing LNS. Expected: same optimum" << std::endl;
+  solver::result r_bb, r_lns, r_lim;
+  int i_bb, i_lns, i_lim;
+  int opt = schedule(12, false, 0, r_bb, i_bb);
+  int lns = schedule(12, true, 0, r_lns, i_lns);
+  int lim = schedule(12, true, 300, r_lim, i_lim);
+  fprintf(stdout, "Makespan: %d (B&B), %d (LNS, %d improvements), %d (LNS, 300 conflicts)\n",
+    opt, lns, i_lns, lim);
+  if(r_bb != solver::SAT || r_lns != solver::SAT || opt != lns)
+    GEAS_ERROR;
+  if(i_lns == 0 || i_lim == 0)
+    GEAS_ERROR;
+  if(lim < opt || (r_lim == solver::SAT && lim != opt))
+    GEAS_ERROR;
+}
+
+// Pigeonhole over integer holes, so learnts are over bounds;
+// inprocessing at every restart.
+void test14(void) {
+  std::cout << "Testing inprocessing. Expected: UNSAT" << std::endl;
+  options o(default_options);
+  o.restart_limit = 20;
+  o.restart_policy = RESTART_GEOMETRIC;
+  o.restart_reuse = 0;
+  o.inprocess_effort = 1.0;
+  solver s(o);
+  int p = 8;
+  vec<intvar> xs;
+  for(int ii = 0; ii < p; ++ii)
+    xs.push(s.new_intvar(0, p-2));
+  for(int ii = 0; ii < p; ++ii) {
+    for(int jj = ii+1; jj < p; ++jj)
+      int_ne(s.data, xs[ii], xs[jj]);
+  }
+  solver::result r = s.solve();
+  statistics& st(s.data->stats);
+  fprintf(stdout, "%d restarts; %d literals removed, %d learnts subsumed\n",
+    st.restarts, st.inprocess_lits, st.inprocess_subsumed);
+  if(r != solver::UNSAT || st.inprocess_lits + st.inprocess_subsumed == 0)
+    GEAS_ERROR;
+}
+
+// Integer pigeonhole with and without learnt minimization.
+void test15(void) {
+  std::cout << "Testing learnt minimization. Expected: UNSAT, UNSAT" << std::endl;
+  for(int min = 0; min < 2; ++min) {
+    options o(default_options);
+    o.learnt_minimize = min;
+    solver s(o);
+    int p = 7;
+    vec<intvar> xs;
+    for(int ii = 0; ii < p; ++ii)
+      xs.push(s.new_intvar(0, p-2));
+    for(int ii = 0; ii < p; ++ii) {
+      for(int jj = ii+1; jj < p; ++jj)
+        int_ne(s.data, xs[ii], xs[jj]);
+    }
+    solver::result r = s.solve();
+    statistics& st(s.data->stats);
+    fprintf(stdout, "%d conflicts, %d literals removed\n", st.conflicts, st.minimized_lits);
+    if(r != solver::UNSAT || (st.minimized_lits > 0) != (min > 0))
+      GEAS_ERROR;
+  }
+}
+
+// The schedule from test13, minimized by hand: each improvement
+// is posted at the root, fixing more watched bounds. Then a
+// case where collection is certain.
+void test16(void) {
+  std::cout << "Testing watch collection. Expected: same optimum" << std::endl;
+  solver::result r_bb;
+  int i_bb;
+  int opt = schedule(12, false, 0, r_bb, i_bb);
+
+  srand(7);
+  solver s;
+  vec<intvar> xs;
+  vec<int> du, rs;
+  int n = 12;
+  intvar mk = s.new_intvar(0, 10*n);
+  for(int ii = 0; ii < n; ++ii) {
+    xs.push(s.new_intvar(0, 10*n));
+    du.push(1 + rand()%6);
+    rs.push(1 + rand()%3);
+    int_le(s.data, xs[ii], mk, -du[ii]);
+  }
+  cumulative(s.data, xs, du, rs, 4);
+  int best = -1;
+  while(s.solve() == solver::SAT) {
+    best = s.get_model()[mk];
+    s.restart();
+    vec<clause_elt> cl;
+    cl.push(mk < best);
+    if(!add_clause(*s.data, cl))
+      break;
+  }
+  statistics& st(s.data->stats);
+  fprintf(stdout, "Makespan: %d (B&B), %d (by hand); %d watch nodes freed (%.03f MB)\n",
+    opt, best, st.watches_freed, st.watch_mem_freed);
+  if(best != opt)
+    GEAS_ERROR;
+
+  // Clauses watching [x >= 1000k]; raising lb(x) at the
+  // root fixes the first 25 of those atoms. All their watch
+  // nodes go, except the last, which becomes the current watch.
+  solver t;
+  intvar x = t.new_intvar(0, 100000);
+  for(int k = 1; k <= 50; ++k)
+    add_clause(t.data, x < 1000*k, t.new_boolvar());
+  if(!t.post(x >= 25500) || t.solve() != solver::SAT)
+    GEAS_ERROR;
+  fprintf(stdout, "%d watch nodes freed\n", t.data->stats.watches_freed);
+  if(t.data->stats.watches_freed < 24)
+    GEAS_ERROR;
+}
+
+// Equivalent booleans (a ring of implications) and variables
+// (x0 <= x1 <= x0 + 0), and a boolean c whose assertion fails.
+// Counts the solutions by enumeration, with and without merging.
+void test17(void) {
+  std::cout << "Testing equivalence detection. Expected: same solution count" << std::endl;
+  int counts[2];
+  for(int eq = 0; eq < 2; ++eq) {
+    options o(default_options);
+    o.bin_equiv = eq;
+    solver s(o);
+    int n = 5;
+    vec<patom_t> bs;
+    vec<intvar> xs;
+    for(int ii = 0; ii < n; ++ii) {
+      bs.push(s.new_boolvar());
+      xs.push(s.new_intvar(0, 3));
+    }
+    for(int ii = 0; ii < n; ++ii)
+      add_clause(s.data, ~bs[ii], bs[(ii+1)%n]);
+    int_le(s.data, xs[0], xs[1], 0);
+    int_le(s.data, xs[1], xs[0], 0);
+    patom_t c = s.new_boolvar();
+    patom_t d = s.new_boolvar();
+    add_clause(s.data, ~c, d);
+    add_clause(s.data, ~c, ~d);
+    add_clause(s.data, c, bs[1], xs[0] >= 2, xs[2] <= 1);
+    add_clause(s.data, ~bs[3], xs[1] <= 2, xs[3] >= 1);
+    add_clause(s.data, bs[0], ~bs[4], xs[4] >= 3, xs[0] <= 0);
+    add_clause(s.data, c, ~bs[2], xs[1] >= 1, xs[2] >= 1, xs[4] <= 1);
+
+    vec<patom_t> vs(bs);
+    vs.push(d);
+    int count = count_solutions(s, xs, vs, no_check());
+    statistics& st(s.data->stats);
+    fprintf(stdout, "%d solutions; %d equivalent atoms, %d equivalent preds, %d failed literals\n",
+      count, st.equiv_atoms, st.equiv_preds, st.failed_lits);
+    if(eq && (st.equiv_atoms == 0 || st.equiv_preds == 0 || st.failed_lits == 0))
+      GEAS_ERROR;
+    counts[eq] = count;
+  }
+  if(counts[0] != counts[1])
+    GEAS_ERROR;
+}
+
+// Strings of 8 bits with three ones, no two adjacent: C(6, 3)
+// of them. Enumerated with the MDD propagator, and as a table.
+void test18(void) {
+  std::cout << "Testing MDD propagation. Expected: 20, 20" << std::endl;
+  int n = 8;
+  vec< vec<int> > tuples;
+  for(int b = 0; b < (1<<n); ++b) {
+    if(__builtin_popcount(b) != 3 || (b & (b>>1)))
+      continue;
+    tuples.push();
+    for(int ii = 0; ii < n; ++ii)
+      tuples.last().push((b>>ii)&1);
+  }
+  for(int use_mdd = 0; use_mdd < 2; ++use_mdd) {
+    solver s;
+    vec<intvar> xs;
+    for(int ii = 0; ii < n; ++ii)
+      xs.push(s.new_intvar(0, 1));
+    if(use_mdd)
+      mdd::post(s.data, mdd::of_tuples(s.data, tuples), xs);
+    else
+      table::post(s.data, table::build(s.data, tuples), xs);
+    int count = count_solutions(s, xs);
+    fprintf(stdout, "%d solutions\n", count);
+    if(count != 20)
+      GEAS_ERROR;
+  }
+}
+
+void test19(void) {
+  std::cout << "Testing regular propagation. Expected: 55" << std::endl;
+  // No two consecutive 2s.
+  int n = 8;
+  regular::dfa d;
+  d.num_states = 2;
+  d.num_syms = 2;
+  d.start = 1;
+  d.trans.push(1); d.trans.push(2);
+  d.trans.push(1); d.trans.push(0);
+  d.accepts.push(2); d.accepts.push(1); d.accepts.push(2);
+
+  solver s;
+  regular_id r(regular::build(s.data, d));
+  d.accepts.clear();
+  d.accepts.push(1); d.accepts.push(2);
+  if(regular::build(s.data, d) != r)
+    GEAS_ERROR;
+
+  vec<intvar> xs;
+  for(int ii = 0; ii < n; ++ii)
+    xs.push(s.new_intvar(0, 3));
+  if(!regular::post(s.data, r, xs))
+    GEAS_ERROR;
+  int count = count_solutions(s, xs, [&](const model& m) {
+      for(int ii = 0; ii < n; ++ii) {
+        if(m[xs[ii]] < 1 || m[xs[ii]] > 2)
+          GEAS_ERROR;
+      }
+    });
+  fprintf(stdout, "%d solutions\n", count);
+  if(count != 55)
+    GEAS_ERROR;
+}
+
+void test20(void) {
+  std::cout << "Testing disjunctive with variable durations and optional tasks." << std::endl;
+  // Starts in [0, 5], durations in [1, 2]; task 3 is optional.
+  int n = 4;
+  int expected = 0;
+  for(int c = 0; c < (6*6*6*6)*16*2; ++c) {
+    int r = c;
+    int st[4], du[4];
+    for(int ii = 0; ii < n; ++ii) { st[ii] = r % 6; r /= 6; }
+    for(int ii = 0; ii < n; ++ii) { du[ii] = 1 + r % 2; r /= 2; }
+    int m = r ? n : n-1;
+    bool ok = true;
+    for(int ii = 0; ii < m; ++ii) {
+      for(int jj = ii+1; jj < m; ++jj)
+        ok = ok && (st[ii] + du[ii] <= st[jj] || st[jj] + du[jj] <= st[ii]);
+    }
+    if(ok)
+      ++expected;
+  }
+
+  solver s;
+  vec<intvar> xs;
+  vec<intvar> ds;
+  vec<patom_t> ps;
+  for(int ii = 0; ii < n; ++ii) {
+    xs.push(s.new_intvar(0, 5));
+    ds.push(s.new_intvar(1, 2));
+    ps.push(ii < n-1 ? at_True : s.new_boolvar());
+  }
+  if(!disjunctive_opt(s.data, xs, ds, ps))
+    GEAS_ERROR;
+  vec<intvar> vs(xs);
+  for(intvar d : ds)
+    vs.push(d);
+  vec<patom_t> opt { ps[n-1] };
+  int count = count_solutions(s, vs, opt, no_check());
+  fprintf(stdout, "%d solutions, expected %d\n", count, expected);
+  if(count != expected)
+    GEAS_ERROR;
+}
+
+void test21(void) {
+  std::cout << "Testing cumulative." << std::endl;
+  // Starts in [0, 5], capacity 3.
+  int n = 5;
+  int du[5] = { 2, 3, 2, 1, 3 };
+  int rq[5] = { 2, 1, 2, 3, 1 };
+  int expected = 0;
+  for(int c = 0; c < 6*6*6*6*6; ++c) {
+    int r = c;
+    int st[5];
+    for(int ii = 0; ii < n; ++ii) { st[ii] = r % 6; r /= 6; }
+    bool ok = true;
+    for(int t = 0; t < 8; ++t) {
+      int usage = 0;
+      for(int ii = 0; ii < n; ++ii) {
+        if(st[ii] <= t && t < st[ii] + du[ii])
+          usage += rq[ii];
+      }
+      ok = ok && usage <= 3;
+    }
+    if(ok)
+      ++expected;
+  }
+
+  solver s;
+  vec<intvar> xs;
+  vec<int> ds;
+  vec<int> rs;
+  for(int ii = 0; ii < n; ++ii) {
+    xs.push(s.new_intvar(0, 5));
+    ds.push(du[ii]);
+    rs.push(rq[ii]);
+  }
+  if(!cumulative(s.data, xs, ds, rs, 3))
+    GEAS_ERROR;
+  int count = count_solutions(s, xs);
+  fprintf(stdout, "%d solutions, expected %d\n", count, expected);
+  if(count != expected)
+    GEAS_ERROR;
+
+  // A task which can never fit fails at posting.
+  solver f;
+  vec<intvar> fs { f.new_intvar(0, 5), f.new_intvar(0, 5) };
+  vec<int> fd { 2, 1 };
+  vec<int> fr { 1, 4 };
+  if(cumulative(f.data, fs, fd, fr, 3) || f.solve() != solver::UNSAT)
+    GEAS_ERROR;
+}
+
+void test22(void) {
+  std::cout << "Testing global cardinality." << std::endl;
+  // Values in [0, 3], x0 != 2; 3 is uncovered, and 0 appears twice.
+  int n = 6;
+  int cover[4] = { 0, 1, 2, 0 };
+  int c_lb[4] = { 1, 0, 1, 0 };
+  int c_ub[4] = { 2, 3, 1, 5 };
+  int expected = 0;
+  for(int c = 0; c < 4*4*4*4*4*4; ++c) {
+    int r = c;
+    int occ[4] = { 0, 0, 0, 0 };
+    int x0 = r % 4;
+    for(int ii = 0; ii < n; ++ii) { occ[r % 4]++; r /= 4; }
+    bool ok = x0 != 2;
+    for(int ii = 0; ii < 4; ++ii)
+      ok = ok && c_lb[ii] <= occ[cover[ii]] && occ[cover[ii]] <= c_ub[ii];
+    if(ok)
+      ++expected;
+  }
+
+  solver s;
+  vec<intvar> xs;
+  vec<int> vals;
+  vec<intvar> cs;
+  for(int ii = 0; ii < n; ++ii)
+    xs.push(s.new_intvar(0, 3));
+  for(int ii = 0; ii < 4; ++ii) {
+    vals.push(cover[ii]);
+    cs.push(s.new_intvar(c_lb[ii], c_ub[ii]));
+  }
+  vec<clause_elt> hole;
+  hole.push(xs[0] != 2);
+  if(!add_clause(*s.data, hole))
+    GEAS_ERROR;
+  if(!global_cardinality(s.data, xs, vals, cs))
+    GEAS_ERROR;
+  int count = count_solutions(s, xs, [&](const model& m) {
+      for(int ii = 0; ii < 4; ++ii) {
+        int occ = 0;
+        for(int jj = 0; jj < n; ++jj)
+          occ += m[xs[jj]] == cover[ii];
+        if(m[cs[ii]] != occ)
+          GEAS_ERROR;
+      }
+    });
+  fprintf(stdout, "%d solutions, expected %d\n", count, expected);
+  if(count != expected)
+    GEAS_ERROR;
+}
+
+// The binary, ternary and long watches of clauses containing at.
+void count_watches(solver_data& s, patom_t at, int* counts) {
+  patom_t w(~at);
+  watch_buf& ws(s.infer.lookup_watch(w.pid, w.val)->ws);
+  counts[0] = ws.bin().end() - ws.bin().begin();
+  counts[1] = ws.tern().end() - ws.tern().begin();
+  counts[2] = ws.longs().end() - ws.longs().begin();
+}
+
+void test23(void) {
+  std::cout << "Testing ternary clauses." << std::endl;
+  // Many clauses a \/ b_i \/ c_i, so a's watches grow well
+  // past their initial size, interleaved with binary and long
+  // clauses on a to shift the sections around.
+  enum { N = 40 };
+  solver s;
+  solver_data& sd(*s.data);
+  patom_t a(s.new_boolvar());
+  patom_t b[N], c[N], d[N/8];
+  for(int ii = 0; ii < N; ++ii) {
+    b[ii] = s.new_boolvar();
+    c[ii] = s.new_boolvar();
+    if(!add_clause(&sd, a, b[ii], c[ii]))
+      GEAS_ERROR;
+    if(ii % 8 == 0) {
+      d[ii/8] = s.new_boolvar();
+      if(!add_clause(&sd, a, d[ii/8]))
+        GEAS_ERROR;
+      if(!add_clause(&sd, a, b[ii], c[ii], d[ii/8]))
+        GEAS_ERROR;
+    }
+  }
+  patom_t x(s.new_boolvar()), y(s.new_boolvar()), z(s.new_boolvar());
+  if(!add_clause(&sd, x, y, z) || !add_clause(&sd, x, y, ~z))
+    GEAS_ERROR;
+  int counts[3];
+  count_watches(sd, a, counts);
+  if(counts[0] != N/8 || counts[1] != N || counts[2] != N/8)
+    GEAS_ERROR;
+
+  // Propagation through the ternary watches.
+  for(int ii : { 0, N/2, N-1 }) {
+    push_level(&sd);
+    if(!enqueue(sd, ~a, reason()) || !propagate(sd))
+      GEAS_ERROR;
+    for(int jj = 0; jj < N/8; ++jj) {
+      if(!sd.state.is_entailed(d[jj]))
+        GEAS_ERROR;
+    }
+    if(!enqueue(sd, ~b[ii], reason()) || !propagate(sd))
+      GEAS_ERROR;
+    if(!sd.state.is_entailed(c[ii]) || sd.state.is_entailed(c[(ii+1) % N]))
+      GEAS_ERROR;
+    bt_to_level(&sd, 0);
+  }
+  // ...and conflict.
+  push_level(&sd);
+  if(!enqueue(sd, ~x, reason()) || !enqueue(sd, ~y, reason()))
+    GEAS_ERROR;
+  if(propagate(sd))
+    GEAS_ERROR;
+  bt_to_level(&sd, 0);
+
+  // Satisfied at the root, even clauses are removed; clause 1
+  // loses c_1, and becomes binary.
+  for(int ii = 0; ii < N; ii += 2) {
+    if(!s.post(b[ii]))
+      GEAS_ERROR;
+  }
+  if(!s.post(~c[1]))
+    GEAS_ERROR;
+  if(s.solve() != solver::SAT)
+    GEAS_ERROR;
+  s.restart();
+  count_watches(sd, a, counts);
+  fprintf(stdout, "Watches on a: %d binary, %d ternary, %d long\n",
+    counts[0], counts[1], counts[2]);
+  if(counts[0] != N/8 + 1 || counts[1] != N/2 - 1 || counts[2] != 0)
+    GEAS_ERROR;
+
+  // The remaining watches still propagate.
+  push_level(&sd);
+  if(!enqueue(sd, ~a, reason()) || !propagate(sd))
+    GEAS_ERROR;
+  if(!sd.state.is_entailed(b[1]) || !sd.state.is_entailed(d[0]))
+    GEAS_ERROR;
+  if(!enqueue(sd, ~c[N-1], reason()) || !propagate(sd))
+    GEAS_ERROR;
+  if(!sd.state.is_entailed(b[N-1]))
+    GEAS_ERROR;
+  bt_to_level(&sd, 0);
+}
+
 int main(int argc, char** argv) {
 //  test1();
   test2();
   test3();
   test4();
   test5();
+  test6();
+  test7();
+  test8();
+  test9();
+  test10();
+  test11();
+  test12();
+  test13();
+  test14();
+  test15();
+  test16();
+  test17();
+  test18();
+  test19();
+  test20();
+  test21();
+  test22();
+  test23();
 
   return 0;
 }
@@ -1,42 +1,116 @@
 #include <iostream>
 #include <cstdio>
-#if 0
-#include <geas/engine/trail.h>
+#include <cstdlib>
+#include <sys/time.h>
 
-int main(int argc, char** argv)
-{
-  Trail t;
+#include <geas/solver/solver.h>
+#include <geas/solver/solver_data.h>
+#include <geas/engine/persist.h>
 
-  Trailed<int> i(&t, 0);
+using namespace geas;
 
-  fprintf(stdout, "Level: %d, i = %d\n\n", t.level(), (int) i);
-  i = 7;
+static double now(void) {
+  timeval t;
+  gettimeofday(&t, nullptr);
+  return t.tv_sec + 1e-6 * t.tv_usec;
+}
+
+// A mix of widths, as in the propagators.
+struct cell {
+  uint64_t w;
+  int i;
+  short h;
+  char c;
+  double d;
+};
+
+void check(bool b, const char* msg) {
+  if(!b) {
+    std::cout << "Failed: " << msg << std::endl;
+    exit(1);
+  }
+}
 
-  fprintf(stdout, "Level: %d, i = %d\n\n", t.level(), (int) i);
-  t.push_level();
+void test_restore(void) {
+  std::cout << "Testing data trail restoration." << std::endl;
+  solver s;
+  solver_data* sd(s.data);
+  persistence& p(sd->persist);
 
-  i = 18;
-  fprintf(stdout, "Level: %d, i = %d\n", t.level(), (int) i);
+  cell x = { 1, 2, 3, 4, 0.5 };
+  Tint t(7);
+  Tdouble td(1.25);
 
-  t.tick();
+  push_level(sd);
+  trail_change(p, x.w, (uint64_t) 10);
+  trail_change(p, x.i, 20);
+  trail_change(p, x.h, (short) 30);
+  trail_change(p, x.c, (char) 40);
+  trail_change(p, x.d, 1.5);
+  t.set(p, 8);
+  td.set(p, 2.75);
 
-  i = 22;
-  fprintf(stdout, "Level: %d, i = %d\n", t.level(), (int) i);
+  push_level(sd);
+  trail_change(p, x.i, -1);
+  trail_change(p, x.i, -2);
+  trail_change(p, x.d, -3.0);
+  t.set(p, 9);
+  t.set(p, 10);
+  check(x.i == -2 && t == 10, "update");
 
-  t.push_level();
-  i = 120;
-  fprintf(stdout, "Level: %d, i = %d\n", t.level(), (int) i);
+  bt_to_level(sd, 1);
+  check(x.w == 10 && x.i == 20 && x.h == 30 && x.c == 40 && x.d == 1.5, "level 1");
+  check(t == 8 && td == 2.75, "level 1 trailed");
 
-  t.restore_level();
-  fprintf(stdout, "Level: %d, i = %d\n", t.level(), (int) i);
+  bt_to_level(sd, 0);
+  check(x.w == 1 && x.i == 2 && x.h == 3 && x.c == 4 && x.d == 0.5, "level 0");
+  check(t == 7 && td == 1.25, "level 0 trailed");
+}
+
+// Deep search-like pattern: a few thousand cells, each level
+// changes a random subset, then we backtrack a random distance.
+void bench(int cells, int iters) {
+  solver s;
+  solver_data* sd(s.data);
+  persistence& p(sd->persist);
 
-  i = 77;
-  fprintf(stdout, "Level: %d, i = %d\n", t.level(), (int) i);
+  vec<cell> xs;
+  for(int ii = 0; ii < cells; ++ii)
+    xs.push(cell { (uint64_t) ii, ii, (short) ii, (char) ii, (double) ii });
 
-  t.restore_level();
-  fprintf(stdout, "Level: %d, i = %d\n", t.level(), (int) i);
+  srand(42);
+  long entries = 0;
+  double t0 = now();
+  for(int it = 0; it < iters; ++it) {
+    push_level(sd);
+    for(int k = 0; k < 64; ++k) {
+      cell& c(xs[rand() % cells]);
+      trail_change(p, c.w, c.w+1);
+      trail_change(p, c.i, c.i+1);
+      trail_change(p, c.h, (short) (c.h+1));
+      trail_change(p, c.c, (char) (c.c+1));
+      trail_change(p, c.d, c.d+1);
+      entries += 5;
+    }
+    int lev = sd->infer.trail_lim.size();
+    if(lev > 32 || (lev > 0 && rand() % 4 == 0))
+      bt_to_level(sd, rand() % lev);
+  }
+  bt_to_level(sd, 0);
+  double t1 = now();
+
+  for(int ii = 0; ii < cells; ++ii) {
+    cell& c(xs[ii]);
+    check(c.w == (uint64_t) ii && c.i == ii && c.h == (short) ii
+          && c.c == (char) ii && c.d == ii, "bench restore");
+  }
+  fprintf(stdout, "%ld entries trailed and restored in %.3fs (%.1f ns/entry)\n",
+    entries, t1 - t0, 1e9 * (t1 - t0) / entries);
+}
 
+int main(int argc, char** argv) {
+  if(argc < 3) test_restore();
+  int iters = argc > 1 ? atoi(argv[1]) : 50000;
+  bench(4096, iters);
   return 0;
 }
-#endif
-int main(int argc, char** argv) { return 0; }
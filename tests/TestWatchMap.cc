@@ -0,0 +1,117 @@
+#include <iostream>
+
+#include <geas/solver/solver.h>
+#include <geas/solver/solver_data.h>
+#include <geas/engine/persist.h>
+#include <geas/constraints/builtins.h>
+
+using namespace geas;
+
+// Nodes reachable from the head must have strictly increasing values.
+void check_list(solver_data& s, geas::pid_t p) {
+  pval_t val = s.infer.pred_watch_heads[p].val;
+  for(watch_node* w = s.infer.pred_watch_heads[p].ptr; w->succ; w = w->succ) {
+    if(w->succ_val <= val)
+      GEAS_ERROR;
+    val = w->succ_val;
+  }
+}
+
+void test_kinds(void) {
+  std::cout << "Testing watch map kinds." << std::endl;
+  solver s;
+  solver_data& sd(*s.data);
+  intvar x = s.new_intvar(0, 10);
+  intvar y = s.new_intvar(0, 1000);
+
+  if(sd.infer.watch_maps[x.p].kind != watch_map::W_DENSE)
+    GEAS_ERROR;
+  if(sd.infer.watch_maps[y.p].kind != watch_map::W_TRIE)
+    GEAS_ERROR;
+
+  for(int v = -2; v < 14; ++v) {
+    patom_t at(x >= v);
+    if(sd.infer.get_watch(at.pid, at.val) != sd.infer.get_watch(at.pid, at.val))
+      GEAS_ERROR;
+  }
+  // Values above the bound share the sentinel.
+  patom_t a(x >= 11), b(x >= 13);
+  if(sd.infer.get_watch(a.pid, a.val) != sd.infer.get_watch(b.pid, b.val))
+    GEAS_ERROR;
+  patom_t c(y >= 500);
+  if(sd.infer.get_watch(c.pid, c.val) != sd.infer.lookup_watch(c.pid, c.val))
+    GEAS_ERROR;
+  check_list(sd, x.p);
+  check_list(sd, x.p^1);
+  check_list(sd, y.p);
+}
+
+void test_sparse(void) {
+  std::cout << "Testing make_sparse rebuild." << std::endl;
+  solver s;
+  solver_data& sd(*s.data);
+  intvar x = s.new_intvar(0, 1000);
+  patom_t b = s.new_boolvar();
+
+  // Watches created before the rebuild must survive it.
+  add_clause(&sd, ~b, x >= 500);
+  add_clause(&sd, x <= 502, b);
+
+  vec<int> vals;
+  vals.push(500); vals.push(502); vals.push(505);
+  if(!make_sparse(x, vals))
+    GEAS_ERROR;
+  if(sd.infer.watch_maps[x.p].kind != watch_map::W_DENSE)
+    GEAS_ERROR;
+  check_list(sd, x.p);
+  check_list(sd, x.p^1);
+
+  if(!propagate(sd))
+    GEAS_ERROR;
+  push_level(&sd);
+  if(!enqueue(sd, x >= 503, reason()) || !propagate(sd))
+    GEAS_ERROR;
+  if(!sd.state.is_entailed(b) || !sd.state.is_entailed(x >= 505))
+    GEAS_ERROR;
+  bt_to_level(&sd, 0);
+
+  if(s.solve() != solver::SAT)
+    GEAS_ERROR;
+  model m(s.get_model());
+  int xv = m[x];
+  if(xv != 500 && xv != 502 && xv != 505)
+    GEAS_ERROR;
+}
+
+void test_solve(void) {
+  std::cout << "Testing 8-queens over dense watches. Expected: SAT" << std::endl;
+  solver s;
+  vec<intvar> xs;
+  for(int ii = 0; ii < 8; ++ii)
+    xs.push(s.new_intvar(0, 7));
+  for(int ii = 0; ii < 8; ++ii) {
+    for(int jj = ii+1; jj < 8; ++jj) {
+      if(!int_ne(s.data, xs[ii], xs[jj])
+         || !int_ne(s.data, xs[ii] + ii, xs[jj] + jj)
+         || !int_ne(s.data, xs[ii] - ii, xs[jj] - jj))
+        GEAS_ERROR;
+    }
+  }
+  if(s.solve() != solver::SAT)
+    GEAS_ERROR;
+  model m(s.get_model());
+  for(int ii = 0; ii < 8; ++ii) {
+    for(int jj = ii+1; jj < 8; ++jj) {
+      int qi = m[xs[ii]], qj = m[xs[jj]];
+      if(qi == qj || qi + ii == qj + jj || qi - ii == qj - jj)
+        GEAS_ERROR;
+    }
+  }
+}
+
+int main(int argc, char** argv) {
+  test_kinds();
+  test_sparse();
+  test_solve();
+  return 0;
+}
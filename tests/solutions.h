@@ -0,0 +1,48 @@
+#ifndef GEAS_TEST_SOLUTIONS_H
+#define GEAS_TEST_SOLUTIONS_H
+// Solution enumeration, shared by the tests.
+#include <geas/solver/solver.h>
+#include <geas/solver/solver_data.h>
+
+namespace geas {
+
+struct no_check {
+  void operator()(const model& m) const { }
+};
+
+// Enumerate the solutions of s, projected onto xs and bs: each is
+// passed to check, then excluded by a nogood. Stops after limit
+// solutions, if limit > 0. Returns the number found.
+template<class F>
+int count_solutions(solver& s, vec<intvar>& xs, vec<patom_t>& bs,
+                    F check, int limit = 0) {
+  int count = 0;
+  while((limit <= 0 || count < limit) && s.solve() == solver::SAT) {
+    ++count;
+    model m(s.get_model());
+    check(m);
+    s.restart();
+    vec<clause_elt> cl;
+    for(intvar& x : xs)
+      cl.push(x != m[x]);
+    for(patom_t b : bs)
+      cl.push(m.value(b) ? ~b : b);
+    if(!add_clause(*s.data, cl))
+      break;
+  }
+  return count;
+}
+
+template<class F>
+int count_solutions(solver& s, vec<intvar>& xs, F check, int limit = 0) {
+  vec<patom_t> bs;
+  return count_solutions(s, xs, bs, check, limit);
+}
+
+inline int count_solutions(solver& s, vec<intvar>& xs, int limit = 0) {
+  return count_solutions(s, xs, no_check(), limit);
+}
+
+}
+
+#endif